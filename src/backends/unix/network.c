@@ -24,6 +24,10 @@
  * =======================================================================
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+ #define _GNU_SOURCE /* recvmmsg() and sendmmsg() */
+#endif
+
 #include "../../common/header/common.h"
 
 #include <unistd.h>
@@ -43,6 +47,15 @@
 #include <errno.h>
 #include <arpa/inet.h>
 #include <net/if.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
+/* __FreeBSD_version is defined in sys/param.h */
+#if defined(__linux__) || (defined(__FreeBSD__) && __FreeBSD_version >= 1100000)
+#define HAVE_MMSG
+#endif
 
 netadr_t net_local_adr;
 
@@ -71,6 +84,49 @@ char *multicast_interface = NULL;
 int NET_Socket(char *net_interface, int port, netsrc_t type, int family);
 char *NET_ErrorString(void);
 
+static cvar_t *net_batch;
+
+#ifdef HAVE_MMSG
+/*
+ * With net_batch set the server socket is drained with one
+ * recvmmsg() into a queue that NET_GetPacket() hands out, and
+ * the datagrams sent between NET_BeginSendBatch() and
+ * NET_FlushSendBatch() leave with one sendmmsg(). That's one
+ * system call per direction and frame instead of one per client.
+ */
+#define NET_BATCH 64
+
+typedef struct
+{
+	struct mmsghdr hdrs[NET_BATCH];
+	struct iovec iovs[NET_BATCH];
+	struct sockaddr_storage addrs[NET_BATCH];
+	byte data[NET_BATCH][MAX_MSGLEN];
+	int sockets[NET_BATCH];
+	int count, next;
+} netbatch_t;
+
+static netbatch_t net_recvbatch;
+static netbatch_t net_sendbatch;
+static qboolean net_sending;
+#endif
+
+#ifdef __linux__
+/*
+ * The dedicated server waits for the next frame with
+ * epoll on stdin, the server sockets and a timerfd. The
+ * timer has nanosecond resolution, so frames start on
+ * time instead of up to a millisecond late like with
+ * select(). The descriptors are created on first use.
+ */
+static struct
+{
+	int epoll;
+	int timer;
+	int fds[3]; /* stdin, IPv4 and IPv6 server socket */
+} net_waiter = {-1, -1, {-1, -1, -1}};
+#endif
+
 static void
 NetadrToSockadr(netadr_t *a, struct sockaddr_storage *s)
 {
@@ -187,6 +243,7 @@ SockadrToNetadr(struct sockaddr_storage *s, netadr_t *a)
 void
 NET_Init()
 {
+	net_batch = Cvar_Get("net_batch", "1", CVAR_ARCHIVE);
 }
 
 qboolean
@@ -497,9 +554,9 @@ NET_GetLoopPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 }
 
 static void
-NET_SendLoopPacket(netsrc_t sock, int length, void *data, netadr_t to)
+NET_SendLoopPacket(netsrc_t sock, const netiov_t *iov, int count)
 {
-	int i;
+	int i, j;
 	loopback_t *loop;
 
 	loop = &loopbacks[sock ^ 1];
@@ -507,10 +564,108 @@ NET_SendLoopPacket(netsrc_t sock, int length, void *data, netadr_t to)
 	i = loop->send & (MAX_LOOPBACK - 1);
 	loop->send++;
 
-	memcpy(loop->msgs[i].data, data, length);
-	loop->msgs[i].datalen = length;
+	loop->msgs[i].datalen = 0;
+
+	for (j = 0; j < count; j++)
+	{
+		memcpy(loop->msgs[i].data + loop->msgs[i].datalen, iov[j].data,
+				iov[j].length);
+		loop->msgs[i].datalen += iov[j].length;
+	}
 }
 
+#ifdef HAVE_MMSG
+/*
+ * Receives as many packets as there are waiting
+ * on the server sockets, up to NET_BATCH.
+ */
+static void
+NET_FillRecvBatch(void)
+{
+	netbatch_t *b = &net_recvbatch;
+	int sockets[2];
+	int i, j, ret;
+
+	sockets[0] = ip_sockets[NS_SERVER];
+	sockets[1] = ip6_sockets[NS_SERVER];
+
+	b->count = b->next = 0;
+
+	for (i = 0; i < 2; i++)
+	{
+		if (!sockets[i] || (b->count == NET_BATCH))
+		{
+			continue;
+		}
+
+		for (j = b->count; j < NET_BATCH; j++)
+		{
+			b->iovs[j].iov_base = b->data[j];
+			b->iovs[j].iov_len = sizeof(b->data[j]);
+
+			memset(&b->hdrs[j], 0, sizeof(b->hdrs[j]));
+			b->hdrs[j].msg_hdr.msg_name = &b->addrs[j];
+			b->hdrs[j].msg_hdr.msg_namelen = sizeof(b->addrs[j]);
+			b->hdrs[j].msg_hdr.msg_iov = &b->iovs[j];
+			b->hdrs[j].msg_hdr.msg_iovlen = 1;
+		}
+
+		ret = recvmmsg(sockets[i], &b->hdrs[b->count], NET_BATCH - b->count,
+				0, NULL);
+
+		if (ret == -1)
+		{
+			if ((errno != EWOULDBLOCK) && (errno != ECONNREFUSED))
+			{
+				Com_Printf("NET_GetPacket: %s\n", NET_ErrorString());
+			}
+
+			continue;
+		}
+
+		b->count += ret;
+	}
+}
+
+static qboolean
+NET_GetBatchedPacket(netadr_t *net_from, sizebuf_t *net_message)
+{
+	netbatch_t *b = &net_recvbatch;
+
+	for (;;)
+	{
+		unsigned int len;
+		int i;
+
+		if (b->next == b->count)
+		{
+			NET_FillRecvBatch();
+
+			if (!b->count)
+			{
+				return false;
+			}
+		}
+
+		i = b->next++;
+		len = b->hdrs[i].msg_len;
+
+		SockadrToNetadr(&b->addrs[i], net_from);
+
+		if (len >= net_message->maxsize)
+		{
+			Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
+			continue;
+		}
+
+		memcpy(net_message->data, b->data[i], len);
+		net_message->cursize = len;
+
+		return true;
+	}
+}
+#endif
+
 qboolean
 NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 {
@@ -526,6 +681,14 @@ NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 		return true;
 	}
 
+#ifdef HAVE_MMSG
+	if ((sock == NS_SERVER) && (net_recvbatch.next < net_recvbatch.count ||
+		(net_batch && net_batch->value)))
+	{
+		return NET_GetBatchedPacket(net_from, net_message);
+	}
+#endif
+
 	for (protocol = 0; protocol < 3; protocol++)
 	{
 		if (protocol == 0)
@@ -579,10 +742,141 @@ NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 	return false;
 }
 
+#ifdef HAVE_MMSG
+/*
+ * Copies the datagram into the send batch. Returns false
+ * if it doesn't fit into a batch slot, it must then be
+ * sent right away.
+ */
+static qboolean
+NET_QueuePacket(int net_socket, const netiov_t *iov, int count,
+		struct sockaddr_storage *addr, int addr_size)
+{
+	netbatch_t *b = &net_sendbatch;
+	int i, j, length;
+
+	for (j = 0, length = 0; j < count; j++)
+	{
+		length += iov[j].length;
+	}
+
+	if (length > MAX_MSGLEN)
+	{
+		return false;
+	}
+
+	if (b->count == NET_BATCH)
+	{
+		NET_FlushSendBatch();
+	}
+
+	i = b->count++;
+
+	/* the parts may not live until the flush */
+	for (j = 0, length = 0; j < count; j++)
+	{
+		memcpy(b->data[i] + length, iov[j].data, iov[j].length);
+		length += iov[j].length;
+	}
+
+	memcpy(&b->addrs[i], addr, addr_size);
+	b->sockets[i] = net_socket;
+
+	b->iovs[i].iov_base = b->data[i];
+	b->iovs[i].iov_len = length;
+
+	memset(&b->hdrs[i], 0, sizeof(b->hdrs[i]));
+	b->hdrs[i].msg_hdr.msg_name = &b->addrs[i];
+	b->hdrs[i].msg_hdr.msg_namelen = addr_size;
+	b->hdrs[i].msg_hdr.msg_iov = &b->iovs[i];
+	b->hdrs[i].msg_hdr.msg_iovlen = 1;
+
+	return true;
+}
+#endif
+
+/*
+ * Server datagrams sent after this are queued until
+ * NET_FlushSendBatch(), if net_batch is enabled.
+ */
+void
+NET_BeginSendBatch(void)
+{
+#ifdef HAVE_MMSG
+	net_sending = net_batch && net_batch->value;
+#endif
+}
+
+void
+NET_FlushSendBatch(void)
+{
+#ifdef HAVE_MMSG
+	netbatch_t *b = &net_sendbatch;
+	int first, last, ret;
+
+	/* one sendmmsg() per run of datagrams for the same socket */
+	for (first = 0; first < b->count; first = last)
+	{
+		for (last = first + 1; last < b->count; last++)
+		{
+			if (b->sockets[last] != b->sockets[first])
+			{
+				break;
+			}
+		}
+
+		while (first < last)
+		{
+			ret = sendmmsg(b->sockets[first], &b->hdrs[first], last - first, 0);
+
+			if ((ret == -1) && ((errno == EWOULDBLOCK) || (errno == EAGAIN)))
+			{
+				/* the socket buffer is full, drop the rest
+				   of the run instead of retrying each one */
+				break;
+			}
+			else if (ret == -1)
+			{
+				netadr_t to;
+
+				/* skip the datagram that failed */
+				SockadrToNetadr(&b->addrs[first], &to);
+				Com_Printf("NET_SendPacket ERROR: %s to %s\n",
+						NET_ErrorString(), NET_AdrToString(to));
+
+				ret = 1;
+			}
+
+			first += ret;
+		}
+	}
+
+	b->count = 0;
+	net_sending = false;
+#endif
+}
+
 void
 NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 {
-	int ret;
+	netiov_t iov;
+
+	iov.data = data;
+	iov.length = length;
+
+	NET_SendPacketv(sock, &iov, 1, to);
+}
+
+/*
+ * Sends the parts as one datagram,
+ * the kernel gathers them.
+ */
+void
+NET_SendPacketv(netsrc_t sock, const netiov_t *iov, int count, netadr_t to)
+{
+	struct iovec iovs[NET_MAXIOV];
+	struct msghdr msg;
+	int i, ret;
 	struct sockaddr_storage addr;
 	int net_socket;
 	int addr_size = sizeof(struct sockaddr_in);
@@ -590,7 +884,7 @@ NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 	switch (to.type)
 	{
 		case NA_LOOPBACK:
-			NET_SendLoopPacket(sock, length, data, to);
+			NET_SendLoopPacket(sock, iov, count);
 			return;
 			break;
 
@@ -720,12 +1014,27 @@ NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 		}
 	}
 
-	ret = sendto(net_socket,
-			data,
-			length,
-			0,
-			(struct sockaddr *)&addr,
-			addr_size);
+#ifdef HAVE_MMSG
+	if (net_sending && (sock == NS_SERVER) &&
+		NET_QueuePacket(net_socket, iov, count, &addr, addr_size))
+	{
+		return;
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+	{
+		iovs[i].iov_base = (void *)iov[i].data;
+		iovs[i].iov_len = iov[i].length;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_name = &addr;
+	msg.msg_namelen = addr_size;
+	msg.msg_iov = iovs;
+	msg.msg_iovlen = count;
+
+	ret = sendmsg(net_socket, &msg, 0);
 
 	if (ret == -1)
 	{
@@ -777,6 +1086,18 @@ NET_Config(qboolean multiplayer)
 	{
 		int i;
 
+#ifdef HAVE_MMSG
+		/* the queued packets belong to the closed sockets */
+		net_recvbatch.count = net_recvbatch.next = 0;
+		net_sendbatch.count = 0;
+		net_sending = false;
+#endif
+
+#ifdef __linux__
+		/* new sockets may get the same descriptors */
+		net_waiter.fds[1] = net_waiter.fds[2] = -1;
+#endif
+
 		/* shut down any existing sockets */
 		for (i = 0; i < 2; i++)
 		{
@@ -991,23 +1312,136 @@ NET_ErrorString(void)
 	return strerror(code);
 }
 
+#ifdef __linux__
+static void
+NET_WaitWatch(int slot, int fd)
+{
+	struct epoll_event ev;
+
+	if (net_waiter.fds[slot] == fd)
+	{
+		return;
+	}
+
+	/* fails if the old descriptor was closed, closing
+	   removes it from the set anyways */
+	if (net_waiter.fds[slot] != -1)
+	{
+		epoll_ctl(net_waiter.epoll, EPOLL_CTL_DEL, net_waiter.fds[slot], NULL);
+	}
+
+	net_waiter.fds[slot] = fd;
+
+	if (fd != -1)
+	{
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+
+		/* stdin may be a file, which can't be watched */
+		epoll_ctl(net_waiter.epoll, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+static qboolean
+NET_WaitInit(void)
+{
+	struct epoll_event ev;
+
+	if (net_waiter.epoll != -1)
+	{
+		return net_waiter.timer != -1;
+	}
+
+	net_waiter.epoll = epoll_create1(EPOLL_CLOEXEC);
+	net_waiter.timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = net_waiter.timer;
+
+	if ((net_waiter.epoll == -1) || (net_waiter.timer == -1) ||
+		(epoll_ctl(net_waiter.epoll, EPOLL_CTL_ADD, net_waiter.timer, &ev) == -1))
+	{
+		Com_Printf("NET_Sleep: %s, falling back to select()\n", NET_ErrorString());
+
+		if (net_waiter.timer != -1)
+		{
+			close(net_waiter.timer);
+			net_waiter.timer = -1;
+		}
+
+		/* keep epoll != -1 to not try again */
+		return false;
+	}
+
+	return true;
+}
+
+static qboolean
+NET_WaitEpoll(int usec)
+{
+	extern qboolean stdin_active;
+	struct epoll_event events[4];
+	struct itimerspec its;
+
+	if (!NET_WaitInit())
+	{
+		return false;
+	}
+
+	NET_WaitWatch(0, stdin_active ? 0 : -1);
+	NET_WaitWatch(1, ip_sockets[NS_SERVER] ? ip_sockets[NS_SERVER] : -1);
+	NET_WaitWatch(2, ip6_sockets[NS_SERVER] ? ip6_sockets[NS_SERVER] : -1);
+
+	/* setting the timer also resets an expiration
+	   left over from an earlier wait */
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = usec / 1000000;
+	its.it_value.tv_nsec = (usec % 1000000) * 1000;
+
+	if (timerfd_settime(net_waiter.timer, 0, &its, NULL) == -1)
+	{
+		return false;
+	}
+
+	while ((epoll_wait(net_waiter.epoll, events, 4, -1) == -1) && (errno == EINTR))
+	{
+	}
+
+	return true;
+}
+#endif
+
 /*
- * sleeps msec or until net socket is ready
+ * Dedicated server only, sleeps usec microseconds
+ * or until a packet or console input arrives
  */
 void
-NET_Sleep(int msec)
+NET_Sleep(int usec)
 {
 	struct timeval timeout;
 	fd_set fdset;
 	extern cvar_t *dedicated;
 	extern qboolean stdin_active;
 
-	if ((!ip_sockets[NS_SERVER] &&
-		 !ip6_sockets[NS_SERVER]) || (dedicated && !dedicated->value))
+	if (!dedicated || !dedicated->value)
 	{
 		return; /* we're not a server, just run full speed */
 	}
 
+	if (usec <= 0)
+	{
+		return;
+	}
+
+#ifdef __linux__
+	if (NET_WaitEpoll(usec))
+	{
+		return;
+	}
+#endif
+
 	FD_ZERO(&fdset);
 
 	if (stdin_active)
@@ -1015,11 +1449,18 @@ NET_Sleep(int msec)
 		FD_SET(0, &fdset); /* stdin is processed too */
 	}
 
-	FD_SET(ip_sockets[NS_SERVER], &fdset); /* IPv4 network socket */
-	FD_SET(ip6_sockets[NS_SERVER], &fdset); /* IPv6 network socket */
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = (msec % 1000) * 1000;
+	if (ip_sockets[NS_SERVER])
+	{
+		FD_SET(ip_sockets[NS_SERVER], &fdset); /* IPv4 network socket */
+	}
+
+	if (ip6_sockets[NS_SERVER])
+	{
+		FD_SET(ip6_sockets[NS_SERVER], &fdset); /* IPv6 network socket */
+	}
+
+	timeout.tv_sec = usec / 1000000;
+	timeout.tv_usec = usec % 1000000;
 	select(MAX(ip_sockets[NS_SERVER],
 					ip6_sockets[NS_SERVER]) + 1, &fdset, NULL, NULL, &timeout);
 }
-
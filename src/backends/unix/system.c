@@ -33,6 +33,7 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/select.h> /* for fd_set */
 #ifndef FNDELAY
@@ -536,6 +537,58 @@ Sys_IsFile(const char *path)
 	return false;
 }
 
+/*
+ * Maps length bytes at offset of the file read only into memory.
+ * Fails if the file is shorter than offset + length, touching
+ * pages past its end would raise SIGBUS. Returns the requested
+ * data or NULL. base and maplength must be passed to
+ * Sys_UnmapFile().
+ */
+void *
+Sys_MapFile(const char *path, size_t offset, size_t length,
+		void **base, size_t *maplength)
+{
+	size_t pagesize, delta;
+	struct stat sb;
+	void *map;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) == -1)
+	{
+		return NULL;
+	}
+
+	if ((fstat(fd, &sb) == -1) || (sb.st_size < 0) ||
+		((size_t)sb.st_size < offset) || ((size_t)sb.st_size - offset < length))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	pagesize = sysconf(_SC_PAGESIZE);
+	delta = offset % pagesize;
+
+	map = mmap(NULL, length + delta, PROT_READ, MAP_PRIVATE,
+			fd, offset - delta);
+	close(fd);
+
+	if (map == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	*base = map;
+	*maplength = length + delta;
+
+	return (byte *)map + delta;
+}
+
+void
+Sys_UnmapFile(void *base, size_t maplength)
+{
+	munmap(base, maplength);
+}
+
 char *
 Sys_GetHomeDir(void)
 {
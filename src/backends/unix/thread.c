@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * A small pool of worker threads. The main thread hands out a batch of
+ * independent jobs with Sys_RunParallel(), works on it itself and
+ * returns after all jobs are finished. There's only ever one batch in
+ * flight, so no queue is necessary.
+ *
+ * =======================================================================
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../common/header/common.h"
+
+typedef struct
+{
+	pthread_t thread;
+	int index;
+	unsigned generation;
+} worker_t;
+
+static struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t done;
+
+	worker_t threads[SYS_MAX_WORKERS];
+	int numthreads;
+
+	/* workers wanted by each SYS_WORKERS_* user */
+	int requested[SYS_WORKERS_NUMUSERS];
+
+	/* the current batch, protected by lock */
+	unsigned generation;
+	qboolean quit;
+	int busy;
+	sysjob_t func;
+	void *data;
+	int count;
+
+	/* next job of the current batch, atomic */
+	int next;
+} pool = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	PTHREAD_COND_INITIALIZER
+};
+
+/* 0 on the main thread */
+static __thread int sys_threadindex;
+
+static void
+Sys_WorkOnBatch(int thread)
+{
+	int i;
+
+	while ((i = __atomic_fetch_add(&pool.next, 1, __ATOMIC_RELAXED)) < pool.count)
+	{
+		pool.func(pool.data, i, thread);
+	}
+}
+
+static void *
+Sys_WorkerMain(void *arg)
+{
+	worker_t *self = arg;
+
+	sys_threadindex = self->index;
+
+	pthread_mutex_lock(&pool.lock);
+
+	for (;;)
+	{
+		while ((pool.generation == self->generation) && !pool.quit)
+		{
+			pthread_cond_wait(&pool.wake, &pool.lock);
+		}
+
+		if (pool.quit)
+		{
+			break;
+		}
+
+		self->generation = pool.generation;
+		pthread_mutex_unlock(&pool.lock);
+
+		Sys_WorkOnBatch(self->index);
+
+		pthread_mutex_lock(&pool.lock);
+
+		if (--pool.busy == 0)
+		{
+			pthread_cond_signal(&pool.done);
+		}
+	}
+
+	pthread_mutex_unlock(&pool.lock);
+
+	return NULL;
+}
+
+int
+Sys_NumCores(void)
+{
+	long cores = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	return (cores > 0) ? (int)cores : 1;
+}
+
+int
+Sys_NumWorkers(void)
+{
+	return pool.numthreads;
+}
+
+int
+Sys_ThreadIndex(void)
+{
+	return sys_threadindex;
+}
+
+static void
+Sys_ResizeWorkers(int count)
+{
+	int i;
+
+	if (count > SYS_MAX_WORKERS)
+	{
+		count = SYS_MAX_WORKERS;
+	}
+
+	if (count == pool.numthreads)
+	{
+		return;
+	}
+
+	/* stop the old ones */
+	if (pool.numthreads)
+	{
+		pthread_mutex_lock(&pool.lock);
+		pool.quit = true;
+		pthread_cond_broadcast(&pool.wake);
+		pthread_mutex_unlock(&pool.lock);
+
+		for (i = 0; i < pool.numthreads; i++)
+		{
+			pthread_join(pool.threads[i].thread, NULL);
+		}
+
+		pool.numthreads = 0;
+		pool.quit = false;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		worker_t *worker = &pool.threads[pool.numthreads];
+
+		/* thread 0 is the caller of Sys_RunParallel() */
+		worker->index = pool.numthreads + 1;
+		worker->generation = pool.generation;
+
+		if (pthread_create(&worker->thread, NULL, Sys_WorkerMain, worker) != 0)
+		{
+			Com_Printf("%s: Couldn't start worker thread %i\n", __func__, i);
+			break;
+		}
+
+		pool.numthreads++;
+	}
+}
+
+/*
+ * The server and the renderer ask for the
+ * number of workers they want, the pool
+ * is sized for the larger one.
+ */
+void
+Sys_StartWorkers(int user, int count)
+{
+	int i, max;
+
+	pool.requested[user] = (count > 0) ? count : 0;
+
+	for (i = 0, max = 0; i < SYS_WORKERS_NUMUSERS; i++)
+	{
+		if (pool.requested[i] > max)
+		{
+			max = pool.requested[i];
+		}
+	}
+
+	Sys_ResizeWorkers(max);
+}
+
+void
+Sys_RunParallel(sysjob_t func, void *data, int count)
+{
+	int i;
+
+	if (!pool.numthreads || (count < 2))
+	{
+		for (i = 0; i < count; i++)
+		{
+			func(data, i, 0);
+		}
+
+		return;
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	pool.func = func;
+	pool.data = data;
+	pool.count = count;
+	pool.next = 0;
+	pool.busy = pool.numthreads;
+	pool.generation++;
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	Sys_WorkOnBatch(0);
+
+	pthread_mutex_lock(&pool.lock);
+
+	while (pool.busy)
+	{
+		pthread_cond_wait(&pool.done, &pool.lock);
+	}
+
+	pthread_mutex_unlock(&pool.lock);
+}
@@ -521,9 +521,9 @@ NET_GetLoopPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 }
 
 static void
-NET_SendLoopPacket(netsrc_t sock, int length, void *data, netadr_t to)
+NET_SendLoopPacket(netsrc_t sock, const netiov_t *iov, int count)
 {
-	int i;
+	int i, j;
 	loopback_t *loop;
 
 	loop = &loopbacks[sock ^ 1];
@@ -531,8 +531,14 @@ NET_SendLoopPacket(netsrc_t sock, int length, void *data, netadr_t to)
 	i = loop->send & (MAX_LOOPBACK - 1);
 	loop->send++;
 
-	memcpy(loop->msgs[i].data, data, length);
-	loop->msgs[i].datalen = length;
+	loop->msgs[i].datalen = 0;
+
+	for (j = 0; j < count; j++)
+	{
+		memcpy(loop->msgs[i].data + loop->msgs[i].datalen, iov[j].data,
+				iov[j].length);
+		loop->msgs[i].datalen += iov[j].length;
+	}
 }
 
 /* ============================================================================= */
@@ -624,10 +630,38 @@ NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 
 /* ============================================================================= */
 
+/* no sendmmsg() here, datagrams are sent right away */
+void
+NET_BeginSendBatch(void)
+{
+}
+
+void
+NET_FlushSendBatch(void)
+{
+}
+
 void
 NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 {
-	int ret;
+	netiov_t iov;
+
+	iov.data = data;
+	iov.length = length;
+
+	NET_SendPacketv(sock, &iov, 1, to);
+}
+
+/*
+ * Sends the parts as one datagram,
+ * the kernel gathers them.
+ */
+void
+NET_SendPacketv(netsrc_t sock, const netiov_t *iov, int count, netadr_t to)
+{
+	WSABUF bufs[NET_MAXIOV];
+	DWORD sent;
+	int i, ret;
 	struct sockaddr_storage addr;
 	int net_socket;
 	int addr_size = sizeof(struct sockaddr_in);
@@ -635,7 +669,7 @@ NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 	switch (to.type)
 	{
 		case NA_LOOPBACK:
-			NET_SendLoopPacket(sock, length, data, to);
+			NET_SendLoopPacket(sock, iov, count);
 			return;
 			break;
 		case NA_BROADCAST:
@@ -756,8 +790,14 @@ NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 		}
 	}
 
-	ret = sendto(net_socket, data, length, 0,
-			(struct sockaddr *)&addr, addr_size);
+	for (i = 0; i < count; i++)
+	{
+		bufs[i].buf = (char *)iov[i].data;
+		bufs[i].len = iov[i].length;
+	}
+
+	ret = WSASendTo(net_socket, bufs, count, &sent, 0,
+			(struct sockaddr *)&addr, addr_size, NULL, NULL);
 
 	if (ret == -1)
 	{
@@ -1212,11 +1252,11 @@ NET_Config(qboolean multiplayer)
 }
 
 /*
- * sleeps msec or until
- * net socket is ready
+ * sleeps usec microseconds or
+ * until net socket is ready
  */
 void
-NET_Sleep(int msec)
+NET_Sleep(int usec)
 {
 	struct timeval timeout;
 	fd_set fdset;
@@ -1253,8 +1293,15 @@ NET_Sleep(int msec)
 		}
 	}
 
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = (msec % 1000) * 1000;
+	/* select() fails without any socket */
+	if (!i)
+	{
+		Sys_Nanosleep(usec * 1000);
+		return;
+	}
+
+	timeout.tv_sec = usec / 1000000;
+	timeout.tv_usec = usec % 1000000;
 	i = Q_max(ip_sockets[NS_SERVER], ip6_sockets[NS_SERVER]);
 	i = Q_max(i, ipx_sockets[NS_SERVER]);
 	select(i + 1, &fdset, NULL, NULL, &timeout);
@@ -507,6 +507,76 @@ Sys_IsFile(const char *path)
 	return (fileAttributes & (FILE_ATTRIBUTE_DIRECTORY|FILE_ATTRIBUTE_DEVICE)) == 0;
 }
 
+/*
+ * Maps length bytes at offset of the file read only into memory.
+ * Fails if the file is shorter than offset + length. Returns the
+ * requested data or NULL. base and maplength must be passed to
+ * Sys_UnmapFile().
+ */
+void *
+Sys_MapFile(const char *path, size_t offset, size_t length,
+		void **base, size_t *maplength)
+{
+	SYSTEM_INFO info;
+	WCHAR wpath[MAX_OSPATH] = {0};
+	HANDLE file, mapping;
+	LARGE_INTEGER filesize;
+	unsigned long long start;
+	size_t delta;
+	void *map;
+
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, MAX_OSPATH);
+
+	file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return NULL;
+	}
+
+	if (!GetFileSizeEx(file, &filesize) ||
+		((unsigned long long)filesize.QuadPart < offset) ||
+		((unsigned long long)filesize.QuadPart - offset < length))
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+
+	mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+
+	if (!mapping)
+	{
+		return NULL;
+	}
+
+	/* views must start at the allocation granularity */
+	GetSystemInfo(&info);
+	delta = offset % info.dwAllocationGranularity;
+	start = offset - delta;
+
+	map = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(start >> 32),
+			(DWORD)(start & 0xFFFFFFFF), length + delta);
+	CloseHandle(mapping);
+
+	if (!map)
+	{
+		return NULL;
+	}
+
+	*base = map;
+	*maplength = length + delta;
+
+	return (byte *)map + delta;
+}
+
+void
+Sys_UnmapFile(void *base, size_t maplength)
+{
+	UnmapViewOfFile(base);
+}
+
 char *
 Sys_GetHomeDir(void)
 {
@@ -0,0 +1,431 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Client benchmark. Plays a demo as timedemo, optionally with another
+ * renderer and resolution, and records for every frame how long it
+ * took, and how much of that was spent parsing server messages,
+ * building the entities and effects of the scene and drawing the
+ * screen. Timedemo shows one frame per demo frame, so every run of
+ * the same demo measures the same frames. When the demo ends the
+ * statistics are printed, the frames are written as CSV and the
+ * video settings are restored.
+ *
+ * =======================================================================
+ */
+
+#include "header/client.h"
+
+#define BENCH_INITIALFRAMES 4096
+
+typedef struct
+{
+	int time[CLB_NUMPHASES];
+} benchframe_t;
+
+/* settings changed for the run */
+typedef struct
+{
+	const char *name;
+	char value[64];
+	qboolean changed;
+} benchsetting_t;
+
+enum
+{
+	BS_TIMEDEMO,
+	BS_RENDERER,
+	BS_MODE,
+	BS_WIDTH,
+	BS_HEIGHT,
+	BS_VSYNC,
+	BS_NUMSETTINGS
+};
+
+static struct
+{
+	/* set by cl_bench, measuring starts with
+	   the first frame of the demo */
+	qboolean pending;
+	qboolean running;
+	qboolean restart;
+
+	char csv[MAX_OSPATH];
+	benchsetting_t settings[BS_NUMSETTINGS];
+
+	/* end of the last measured frame */
+	long long lastframe;
+	long long start[CLB_NUMPHASES];
+	int current[CLB_NUMPHASES];
+
+	benchframe_t *frames;
+	int numframes;
+	int maxframes;
+} bench;
+
+static const char *bench_phasenames[CLB_NUMPHASES] = {
+	"frame",
+	"parse",
+	"entities",
+	"render"
+};
+
+static const char *bench_settingnames[BS_NUMSETTINGS] = {
+	"timedemo",
+	"vid_renderer",
+	"r_mode",
+	"r_customwidth",
+	"r_customheight",
+	"r_vsync"
+};
+
+static cvar_t *cl_bench_renderer;
+static cvar_t *cl_bench_width;
+static cvar_t *cl_bench_height;
+
+void
+CL_BenchBegin(int phase)
+{
+	if (bench.running)
+	{
+		bench.start[phase] = Sys_Microseconds();
+	}
+}
+
+void
+CL_BenchEnd(int phase)
+{
+	if (bench.running)
+	{
+		bench.current[phase] += (int)(Sys_Microseconds() - bench.start[phase]);
+	}
+}
+
+/*
+ * Sets a cvar for the run, the old
+ * value is restored afterwards.
+ */
+static void
+CL_BenchSet(int setting, const char *value)
+{
+	benchsetting_t *s = &bench.settings[setting];
+
+	if (!strcmp(Cvar_VariableString(s->name), value))
+	{
+		return;
+	}
+
+	if (!s->changed)
+	{
+		Q_strlcpy(s->value, Cvar_VariableString(s->name), sizeof(s->value));
+		s->changed = true;
+	}
+
+	Cvar_Set((char *)s->name, (char *)value);
+
+	if (setting != BS_TIMEDEMO)
+	{
+		bench.restart = true;
+	}
+}
+
+/*
+ * Restores the settings and
+ * frees everything.
+ */
+static void
+CL_BenchShutdown(void)
+{
+	int i;
+
+	for (i = 0; i < BS_NUMSETTINGS; i++)
+	{
+		if (bench.settings[i].changed)
+		{
+			Cvar_Set((char *)bench.settings[i].name, bench.settings[i].value);
+		}
+	}
+
+	if (bench.restart)
+	{
+		Cbuf_AddText("vid_restart\n");
+	}
+
+	if (bench.frames)
+	{
+		Z_Free(bench.frames);
+	}
+
+	memset(&bench, 0, sizeof(bench));
+}
+
+/*
+ * Called at the end of every render frame.
+ */
+void
+CL_BenchFrame(void)
+{
+	long long now;
+	benchframe_t *f;
+
+	if (!bench.pending && !bench.running)
+	{
+		return;
+	}
+
+	if (bench.pending && (cls.state == ca_disconnected) && !Com_ServerState())
+	{
+		/* demomap failed, there won't
+		   be a disconnect to clean up */
+		Com_Printf("cl_bench: couldn't start the demo.\n");
+		CL_BenchShutdown();
+		return;
+	}
+
+	now = Sys_Microseconds();
+
+	if ((cls.state != ca_active) || !cl.refresh_prepped || cls.disable_screen)
+	{
+		/* still loading */
+		bench.lastframe = 0;
+		memset(bench.current, 0, sizeof(bench.current));
+		return;
+	}
+
+	if (bench.pending)
+	{
+		bench.pending = false;
+		bench.running = true;
+	}
+	else if (bench.lastframe)
+	{
+		if (bench.numframes == bench.maxframes)
+		{
+			benchframe_t *frames;
+
+			bench.maxframes *= 2;
+			frames = Z_Malloc(bench.maxframes * sizeof(benchframe_t));
+			memcpy(frames, bench.frames, bench.numframes * sizeof(benchframe_t));
+			Z_Free(bench.frames);
+			bench.frames = frames;
+		}
+
+		f = &bench.frames[bench.numframes++];
+		f->time[CLB_FRAME] = (int)(now - bench.lastframe);
+		f->time[CLB_PARSE] = bench.current[CLB_PARSE];
+		f->time[CLB_ENTITIES] = bench.current[CLB_ENTITIES];
+
+		/* entities are built while the screen is drawn */
+		f->time[CLB_RENDER] = bench.current[CLB_RENDER] - bench.current[CLB_ENTITIES];
+	}
+
+	bench.lastframe = now;
+	memset(bench.current, 0, sizeof(bench.current));
+}
+
+static int
+CL_BenchCompare(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static void
+CL_BenchReport(void)
+{
+	int i, j, n;
+	double mean;
+	int *s;
+
+	n = bench.numframes;
+	s = Z_Malloc(n * sizeof(int));
+
+	Com_Printf("%i frames, %s renderer, %ix%i\n", n, Cvar_VariableString("vid_renderer"),
+			viddef.width, viddef.height);
+	Com_Printf("phase          mean    min    p50    p90    p99    max usec\n");
+
+	for (i = 0; i < CLB_NUMPHASES; i++)
+	{
+		for (j = 0, mean = 0; j < n; j++)
+		{
+			s[j] = bench.frames[j].time[i];
+			mean += s[j];
+		}
+
+		qsort(s, n, sizeof(s[0]), CL_BenchCompare);
+
+		Com_Printf("%-12s %6.0f %6i %6i %6i %6i %6i\n", bench_phasenames[i],
+				mean / n, s[0], s[n * 50 / 100], s[n * 90 / 100], s[n * 99 / 100],
+				s[n - 1]);
+
+		if (i == CLB_FRAME)
+		{
+			Com_Printf("%.1f fps average, %.1f fps at p99\n", n * 1000000.0 / mean,
+					1000000.0 / (s[n * 99 / 100] ? s[n * 99 / 100] : 1));
+		}
+	}
+
+	Z_Free(s);
+}
+
+static void
+CL_BenchWriteCSV(void)
+{
+	char name[MAX_OSPATH];
+	FILE *f;
+	int i, j;
+
+	Com_sprintf(name, sizeof(name), "%s/%s", FS_Gamedir(), bench.csv);
+
+	if ((f = Q_fopen(name, "w")) == NULL)
+	{
+		Com_Printf("Couldn't open %s for writing.\n", name);
+		return;
+	}
+
+	fprintf(f, "frame");
+
+	for (i = 0; i < CLB_NUMPHASES; i++)
+	{
+		fprintf(f, ",%s_usec", bench_phasenames[i]);
+	}
+
+	fprintf(f, "\n");
+
+	for (i = 0; i < bench.numframes; i++)
+	{
+		fprintf(f, "%i", i);
+
+		for (j = 0; j < CLB_NUMPHASES; j++)
+		{
+			fprintf(f, ",%i", bench.frames[i].time[j]);
+		}
+
+		fprintf(f, "\n");
+	}
+
+	fclose(f);
+
+	Com_Printf("Wrote %s.\n", name);
+}
+
+/*
+ * Called by CL_Disconnect(), ends
+ * the run when the demo is over.
+ */
+void
+CL_BenchDisconnect(void)
+{
+	if (!bench.running)
+	{
+		return;
+	}
+
+	bench.running = false;
+
+	if (bench.numframes > 0)
+	{
+		CL_BenchReport();
+
+		if (bench.csv[0])
+		{
+			CL_BenchWriteCSV();
+		}
+	}
+	else
+	{
+		Com_Printf("cl_bench: no frames measured.\n");
+	}
+
+	CL_BenchShutdown();
+}
+
+/*
+ * cl_bench <demo> [csvfile]
+ */
+static void
+CL_Bench_f(void)
+{
+	char value[16];
+	int i;
+
+	if ((Cmd_Argc() < 2) || (Cmd_Argc() > 3))
+	{
+		Com_Printf("Usage: cl_bench <demo> [csvfile]\n");
+		return;
+	}
+
+	if (bench.pending || bench.running)
+	{
+		Com_Printf("cl_bench is already running.\n");
+		return;
+	}
+
+	memset(&bench, 0, sizeof(bench));
+
+	for (i = 0; i < BS_NUMSETTINGS; i++)
+	{
+		bench.settings[i].name = bench_settingnames[i];
+	}
+
+	if (Cmd_Argc() == 3)
+	{
+		Q_strlcpy(bench.csv, Cmd_Argv(2), sizeof(bench.csv));
+	}
+
+	CL_BenchSet(BS_TIMEDEMO, "1");
+
+	if (cl_bench_renderer->string[0])
+	{
+		CL_BenchSet(BS_RENDERER, cl_bench_renderer->string);
+	}
+
+	if ((cl_bench_width->value > 0) && (cl_bench_height->value > 0))
+	{
+		CL_BenchSet(BS_MODE, "-1");
+		Com_sprintf(value, sizeof(value), "%i", (int)cl_bench_width->value);
+		CL_BenchSet(BS_WIDTH, value);
+		Com_sprintf(value, sizeof(value), "%i", (int)cl_bench_height->value);
+		CL_BenchSet(BS_HEIGHT, value);
+	}
+
+	/* vsync would measure the display */
+	CL_BenchSet(BS_VSYNC, "0");
+
+	bench.maxframes = BENCH_INITIALFRAMES;
+	bench.frames = Z_Malloc(bench.maxframes * sizeof(benchframe_t));
+	bench.pending = true;
+
+	if (bench.restart)
+	{
+		Cbuf_AddText("vid_restart\n");
+	}
+
+	Cbuf_AddText(va("demomap %s\n", Cmd_Argv(1)));
+}
+
+void
+CL_BenchInit(void)
+{
+	cl_bench_renderer = Cvar_Get("cl_bench_renderer", "", 0);
+	cl_bench_width = Cvar_Get("cl_bench_width", "0", 0);
+	cl_bench_height = Cvar_Get("cl_bench_height", "0", 0);
+
+	Cmd_AddCommand("cl_bench", CL_Bench_f);
+}
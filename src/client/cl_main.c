@@ -45,6 +45,7 @@ cvar_t *cl_predict;
 cvar_t *cl_showfps;
 cvar_t *cl_gun;
 cvar_t *cl_add_particles;
+cvar_t *cl_maxparticles;
 cvar_t *cl_add_lights;
 cvar_t *cl_add_entities;
 cvar_t *cl_add_blend;
@@ -507,6 +508,7 @@ CL_InitLocal(void)
 	cl_add_blend = Cvar_Get("cl_blend", "1", 0);
 	cl_add_lights = Cvar_Get("cl_lights", "1", 0);
 	cl_add_particles = Cvar_Get("cl_particles", "1", 0);
+	cl_maxparticles = Cvar_Get("cl_maxparticles", "4096", CVAR_ARCHIVE);
 	cl_add_entities = Cvar_Get("cl_entities", "1", 0);
 	cl_kickangles = Cvar_Get("cl_kickangles", "1", 0);
 	cl_gun = Cvar_Get("cl_gun", "2", CVAR_ARCHIVE);
@@ -809,7 +811,9 @@ CL_Frame(int packetdelta, int renderdelta, int timedelta, qboolean packetframe,
 	// Update input stuff.
 	if (packetframe || renderframe)
 	{
+		CL_BenchBegin(CLB_PARSE);
 		CL_ReadPackets();
+		CL_BenchEnd(CLB_PARSE);
 		CL_UpdateWindowedMouse();
 		IN_Update();
 		Cbuf_Execute();
@@ -844,6 +848,8 @@ CL_Frame(int packetdelta, int renderdelta, int timedelta, qboolean packetframe,
 
 	if (renderframe)
 	{
+		long long profstart;
+
 		VID_CheckChanges();
 		CL_PredictMovement();
 
@@ -858,7 +864,9 @@ CL_Frame(int packetdelta, int renderdelta, int timedelta, qboolean packetframe,
 			time_before_ref = Sys_Milliseconds();
 		}
 
+		CL_BenchBegin(CLB_RENDER);
 		SCR_UpdateScreen();
+		CL_BenchEnd(CLB_RENDER);
 
 		if (host_speeds->value)
 		{
@@ -866,7 +874,9 @@ CL_Frame(int packetdelta, int renderdelta, int timedelta, qboolean packetframe,
 		}
 
 		/* update audio */
+		profstart = Prof_Begin();
 		S_Update(cl.refdef.vieworg, cl.v_forward, cl.v_right, cl.v_up);
+		Prof_End(PROF_S_UPDATE, profstart);
 
 		/* advance local effects for next frame */
 		CL_RunDLights();
@@ -877,6 +887,8 @@ CL_Frame(int packetdelta, int renderdelta, int timedelta, qboolean packetframe,
 		/* Update framecounter */
 		cls.framecount++;
 
+		CL_BenchFrame();
+
 		if (log_stats->value)
 		{
 			if (cls.state == ca_active)
@@ -941,6 +953,7 @@ CL_Init(void)
 	cls.disable_screen = true; /* don't draw yet */
 
 	CL_InitLocal();
+	CL_BenchInit();
 
 	Cbuf_Execute();
 
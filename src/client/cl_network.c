@@ -306,6 +306,8 @@ CL_Disconnect(void)
 		}
 	}
 
+	CL_BenchDisconnect();
+
 	VectorClear(cl.refdef.blend);
 
 	R_SetPalette(NULL);
@@ -26,24 +26,262 @@
 
 #include "header/client.h"
 
-cparticle_t *active_particles, *free_particles;
-cparticle_t particles[MAX_PARTICLES];
-int cl_numparticles = MAX_PARTICLES;
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CL_PARTICLES_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CL_PARTICLES_NEON
+#endif
+
+/* particles spawned by the effects are collected
+   here and moved into the pool in one go */
+#define MAX_SPAWNED_PARTICLES 1024
+
+/*
+ * All live particles as structure of arrays. The
+ * first num entries are live, a particle that fades
+ * out is replaced by the last one. MAX_CL_PARTICLES
+ * is a multiple of 4, so the SIMD code can always
+ * load 4 entries.
+ */
+typedef struct
+{
+	int num;
+	float time[MAX_CL_PARTICLES];
+	float org[3][MAX_CL_PARTICLES];
+	float vel[3][MAX_CL_PARTICLES];
+	float accel[3][MAX_CL_PARTICLES];
+	float alpha[MAX_CL_PARTICLES];
+	float alphavel[MAX_CL_PARTICLES];
+	int color[MAX_CL_PARTICLES];
+
+	/* position and alpha at cl.time,
+	   written by CL_UpdateParticles() */
+	float curorg[3][MAX_CL_PARTICLES];
+	float curalpha[MAX_CL_PARTICLES];
+} cparticlepool_t;
+
+static cparticlepool_t pool;
+static cparticle_t spawned[MAX_SPAWNED_PARTICLES];
+static int num_spawned;
+static int particle_limit;
+
+/*
+ * Updates particle_limit from cl_maxparticles.
+ */
+static void
+CL_UpdateParticleLimit(void)
+{
+	particle_limit = (int)cl_maxparticles->value;
+
+	if (particle_limit < 1)
+	{
+		particle_limit = 1;
+	}
+	else if (particle_limit > MAX_CL_PARTICLES)
+	{
+		particle_limit = MAX_CL_PARTICLES;
+	}
+
+	if (particle_limit != cl_maxparticles->value)
+	{
+		Cvar_SetValue("cl_maxparticles", particle_limit);
+	}
+
+	cl_maxparticles->modified = false;
+}
 
 void
 CL_ClearParticles(void)
+{
+	CL_UpdateParticleLimit();
+
+	pool.num = 0;
+	num_spawned = 0;
+}
+
+/*
+ * Moves the spawned particles into the pool.
+ */
+static void
+CL_FlushParticles(void)
+{
+	int i, j;
+
+	for (i = 0; (i < num_spawned) && (pool.num < particle_limit); i++)
+	{
+		const cparticle_t *p = &spawned[i];
+		int n = pool.num++;
+
+		pool.time[n] = p->time;
+
+		for (j = 0; j < 3; j++)
+		{
+			pool.org[j][n] = p->org[j];
+			pool.vel[j][n] = p->vel[j];
+			pool.accel[j][n] = p->accel[j];
+		}
+
+		pool.alpha[n] = p->alpha;
+		pool.alphavel[n] = p->alphavel;
+		pool.color[n] = (int)p->color;
+	}
+
+	num_spawned = 0;
+}
+
+/*
+ * Returns true if no more
+ * particles can be spawned.
+ */
+qboolean
+CL_ParticlesFull(void)
+{
+	return pool.num + num_spawned >= particle_limit;
+}
+
+/*
+ * Returns a cleared particle to be filled
+ * in by the caller, or NULL if the pool is
+ * full. The particle is only valid until
+ * the next call.
+ */
+cparticle_t *
+CL_AllocParticle(void)
+{
+	cparticle_t *p;
+
+	if (CL_ParticlesFull())
+	{
+		return NULL;
+	}
+
+	if (num_spawned == MAX_SPAWNED_PARTICLES)
+	{
+		CL_FlushParticles();
+	}
+
+	p = &spawned[num_spawned++];
+	memset(p, 0, sizeof(*p));
+
+	return p;
+}
+
+/*
+ * Moves particle from into the slot of to.
+ */
+static void
+CL_MoveParticle(int from, int to)
+{
+	int j;
+
+	pool.time[to] = pool.time[from];
+
+	for (j = 0; j < 3; j++)
+	{
+		pool.org[j][to] = pool.org[j][from];
+		pool.vel[j][to] = pool.vel[j][from];
+		pool.accel[j][to] = pool.accel[j][from];
+		pool.curorg[j][to] = pool.curorg[j][from];
+	}
+
+	pool.alpha[to] = pool.alpha[from];
+	pool.alphavel[to] = pool.alphavel[from];
+	pool.color[to] = pool.color[from];
+	pool.curalpha[to] = pool.curalpha[from];
+}
+
+/*
+ * Computes the position and alpha of all
+ * particles at the given time. Instant
+ * particles are shown as spawned.
+ */
+static void
+CL_UpdateParticles(float now)
 {
 	int i;
 
-	free_particles = &particles[0];
-	active_particles = NULL;
+#if defined(CL_PARTICLES_SSE2)
+	const __m128 vnow = _mm_set1_ps(now);
+	const __m128 scale = _mm_set1_ps(0.001f);
+	const __m128 instant = _mm_set1_ps((float)INSTANT_PARTICLE);
 
-	for (i = 0; i < cl_numparticles; i++)
+	for (i = 0; i < pool.num; i += 4)
 	{
-		particles[i].next = &particles[i + 1];
+		__m128 alphavel = _mm_loadu_ps(pool.alphavel + i);
+		__m128 time, time2;
+		int j;
+
+		time = _mm_mul_ps(_mm_sub_ps(vnow, _mm_loadu_ps(pool.time + i)), scale);
+		time = _mm_andnot_ps(_mm_cmpeq_ps(alphavel, instant), time);
+		time2 = _mm_mul_ps(time, time);
+
+		_mm_storeu_ps(pool.curalpha + i, _mm_add_ps(_mm_loadu_ps(pool.alpha + i),
+				_mm_mul_ps(time, alphavel)));
+
+		for (j = 0; j < 3; j++)
+		{
+			__m128 org = _mm_add_ps(_mm_loadu_ps(pool.org[j] + i),
+					_mm_mul_ps(_mm_loadu_ps(pool.vel[j] + i), time));
+
+			org = _mm_add_ps(org, _mm_mul_ps(_mm_loadu_ps(pool.accel[j] + i), time2));
+			_mm_storeu_ps(pool.curorg[j] + i, org);
+		}
 	}
+#elif defined(CL_PARTICLES_NEON)
+	const float32x4_t vnow = vdupq_n_f32(now);
+	const float32x4_t scale = vdupq_n_f32(0.001f);
+	const float32x4_t instant = vdupq_n_f32((float)INSTANT_PARTICLE);
+
+	/* no vmlaq_f32(), it may fuse */
+	for (i = 0; i < pool.num; i += 4)
+	{
+		float32x4_t alphavel = vld1q_f32(pool.alphavel + i);
+		float32x4_t time, time2;
+		int j;
+
+		time = vmulq_f32(vsubq_f32(vnow, vld1q_f32(pool.time + i)), scale);
+		time = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(time),
+				vceqq_f32(alphavel, instant)));
+		time2 = vmulq_f32(time, time);
+
+		vst1q_f32(pool.curalpha + i, vaddq_f32(vld1q_f32(pool.alpha + i),
+				vmulq_f32(time, alphavel)));
+
+		for (j = 0; j < 3; j++)
+		{
+			float32x4_t org = vaddq_f32(vld1q_f32(pool.org[j] + i),
+					vmulq_f32(vld1q_f32(pool.vel[j] + i), time));
+
+			org = vaddq_f32(org, vmulq_f32(vld1q_f32(pool.accel[j] + i), time2));
+			vst1q_f32(pool.curorg[j] + i, org);
+		}
+	}
+#else
+	for (i = 0; i < pool.num; i++)
+	{
+		float time, time2;
+		int j;
+
+		time = (now - pool.time[i]) * 0.001f;
+
+		if (pool.alphavel[i] == INSTANT_PARTICLE)
+		{
+			time = 0.0f;
+		}
 
-	particles[cl_numparticles - 1].next = NULL;
+		time2 = time * time;
+
+		pool.curalpha[i] = pool.alpha[i] + time * pool.alphavel[i];
+
+		for (j = 0; j < 3; j++)
+		{
+			pool.curorg[j][i] = pool.org[j][i] + pool.vel[j][i] * time +
+				pool.accel[j][i] * time2;
+		}
+	}
+#endif
 }
 
 void
@@ -55,16 +293,11 @@ CL_ParticleEffect(vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = cl.time;
 		p->color = color + (randk() & 7);
 		d = randk() & 31;
@@ -95,16 +328,11 @@ CL_ParticleEffect2(vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color + (randk() & 7);
 
@@ -136,16 +364,11 @@ CL_ParticleEffect3(vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 		p->color = color;
 
@@ -168,74 +391,51 @@ CL_ParticleEffect3(vec3_t org, vec3_t dir, int color, int count)
 void
 CL_AddParticles(void)
 {
-	cparticle_t *p, *next;
-	float alpha;
-	float time, time2;
-	vec3_t org;
-	int color;
-	cparticle_t *active, *tail;
+	particle_t *p;
+	int i, count;
 
-	active = NULL;
-	tail = NULL;
-
-	for (p = active_particles; p; p = next)
+	if (cl_maxparticles->modified)
 	{
-		next = p->next;
+		CL_UpdateParticleLimit();
 
-		if (p->alphavel != INSTANT_PARTICLE)
+		if (pool.num > particle_limit)
 		{
-			time = (cl.time - p->time) * 0.001;
-			alpha = p->alpha + time * p->alphavel;
-
-			if (alpha <= 0)
-			{
-				/* faded out */
-				p->next = free_particles;
-				free_particles = p;
-				continue;
-			}
-		}
-		else
-		{
-			time = 0.0f;
-			alpha = p->alpha;
+			pool.num = particle_limit;
 		}
+	}
 
-		p->next = NULL;
-
-		if (!tail)
-		{
-			active = tail = p;
-		}
+	CL_FlushParticles();
+	CL_UpdateParticles((float)cl.time);
 
-		else
+	for (i = 0; i < pool.num; )
+	{
+		if (pool.alphavel[i] == INSTANT_PARTICLE)
 		{
-			tail->next = p;
-			tail = p;
+			/* shown once, faded out next frame */
+			pool.alphavel[i] = 0.0f;
+			pool.alpha[i] = 0.0f;
 		}
-
-		if (alpha > 1.0f)
+		else if (pool.curalpha[i] <= 0)
 		{
-			alpha = 1;
+			/* faded out */
+			CL_MoveParticle(--pool.num, i);
+			continue;
 		}
 
-		color = p->color;
-		time2 = time * time;
-
-		org[0] = p->org[0] + p->vel[0] * time + p->accel[0] * time2;
-		org[1] = p->org[1] + p->vel[1] * time + p->accel[1] * time2;
-		org[2] = p->org[2] + p->vel[2] * time + p->accel[2] * time2;
+		i++;
+	}
 
-		V_AddParticle(org, color, alpha);
+	count = pool.num;
+	p = V_ReserveParticles(&count);
 
-		if (p->alphavel == INSTANT_PARTICLE)
-		{
-			p->alphavel = 0.0;
-			p->alpha = 0.0;
-		}
+	for (i = 0; i < count; i++, p++)
+	{
+		p->origin[0] = pool.curorg[0][i];
+		p->origin[1] = pool.curorg[1][i];
+		p->origin[2] = pool.curorg[2][i];
+		p->color = pool.color[i];
+		p->alpha = (pool.curalpha[i] > 1.0f) ? 1.0f : pool.curalpha[i];
 	}
-
-	active_particles = active;
 }
 
 void
@@ -251,16 +451,11 @@ CL_GenericParticleEffect(vec3_t org, vec3_t dir, int color,
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = CL_AllocParticle()))
 		{
 			return;
 		}
 
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
 		p->time = time;
 
 		if (numcolors > 1)
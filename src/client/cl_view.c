@@ -53,7 +53,7 @@ static int r_numentities;
 static entity_t r_entities[MAX_ENTITIES];
 
 static int r_numparticles;
-static particle_t r_particles[MAX_PARTICLES];
+static particle_t r_particles[MAX_CL_PARTICLES];
 
 static lightstyle_t r_lightstyles[MAX_LIGHTSTYLES];
 
@@ -87,7 +87,7 @@ V_AddParticle(vec3_t org, unsigned int color, float alpha)
 {
 	particle_t *p;
 
-	if (r_numparticles >= MAX_PARTICLES)
+	if (r_numparticles >= MAX_CL_PARTICLES)
 	{
 		return;
 	}
@@ -98,6 +98,27 @@ V_AddParticle(vec3_t org, unsigned int color, float alpha)
 	p->alpha = alpha;
 }
 
+/*
+ * Reserves up to *count particles at the end
+ * of the scene and returns the first. *count
+ * is set to the number actually reserved.
+ */
+particle_t *
+V_ReserveParticles(int *count)
+{
+	particle_t *p;
+
+	if (*count > MAX_CL_PARTICLES - r_numparticles)
+	{
+		*count = MAX_CL_PARTICLES - r_numparticles;
+	}
+
+	p = &r_particles[r_numparticles];
+	r_numparticles += *count;
+
+	return p;
+}
+
 void
 V_AddLight(vec3_t org, float intensity, float r, float g, float b)
 {
@@ -597,7 +618,9 @@ V_RenderView(float stereo_separation)
 		/* build a refresh entity list and calc cl.sim*
 		   this also calls CL_CalcViewValues which loads
 		   v_forward, etc. */
+		CL_BenchBegin(CLB_ENTITIES);
 		CL_AddEntities();
+		CL_BenchEnd(CLB_ENTITIES);
 
 		// before changing viewport we should trace the crosshair position
 		V_Render3dCrosshair();
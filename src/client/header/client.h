@@ -39,6 +39,7 @@
 #define	PARTICLE_GRAVITY 40
 #define BLASTER_PARTICLE_COLOR 0xe0
 #define INSTANT_PARTICLE -10000.0
+#define MAX_CL_PARTICLES 16384 /* upper bound of cl_maxparticles */
 
 #include <math.h>
 #include <string.h>
@@ -279,6 +280,7 @@ extern	cvar_t	*cl_gun;
 extern	cvar_t	*cl_add_blend;
 extern	cvar_t	*cl_add_lights;
 extern	cvar_t	*cl_add_particles;
+extern	cvar_t	*cl_maxparticles;
 extern	cvar_t	*cl_add_entities;
 extern	cvar_t	*cl_predict;
 extern	cvar_t	*cl_footsteps;
@@ -369,11 +371,11 @@ void CL_ParticleEffect2 (vec3_t org, vec3_t dir, int color, int count);
 void CL_ParticleEffect3 (vec3_t org, vec3_t dir, int color, int count);
 
 
+/* A particle as filled in by the effects. They
+   are moved into the particle pool (see
+   cl_particles.c) by CL_AddParticles(). */
 typedef struct particle_s
 {
-
-	struct particle_s	*next;
-
 	float		time;
 
 	vec3_t		org;
@@ -451,6 +453,22 @@ void CL_ParseLayout (void);
 
 void CL_Init (void);
 
+/* cl_bench.c */
+enum
+{
+	CLB_FRAME,
+	CLB_PARSE,
+	CLB_ENTITIES,
+	CLB_RENDER,
+	CLB_NUMPHASES
+};
+
+void CL_BenchInit(void);
+void CL_BenchBegin(int phase);
+void CL_BenchEnd(int phase);
+void CL_BenchFrame(void);
+void CL_BenchDisconnect(void);
+
 void CL_FixUpGender(void);
 void CL_Disconnect (void);
 void CL_Disconnect_f (void);
@@ -511,6 +529,7 @@ void V_Init (void);
 void V_RenderView( float stereo_separation );
 void V_AddEntity (entity_t *ent);
 void V_AddParticle (vec3_t org, unsigned int color, float alpha);
+particle_t *V_ReserveParticles (int *count);
 void V_AddLight (vec3_t org, float intensity, float r, float g, float b);
 void V_AddLightStyle (int style, float r, float g, float b);
 
@@ -530,6 +549,8 @@ void CL_DiminishingTrail (vec3_t start, vec3_t end, centity_t *old, int flags);
 void CL_FlyEffect (centity_t *ent, vec3_t origin);
 void CL_BfgParticles (entity_t *ent);
 void CL_AddParticles (void);
+cparticle_t *CL_AllocParticle (void);
+qboolean CL_ParticlesFull (void);
 void CL_EntityEvent (entity_state_t *ent);
 void CL_TrapParticles (entity_t *ent);
 
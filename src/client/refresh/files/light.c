@@ -26,9 +26,21 @@
 
 #include "../ref_shared.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LM_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+/* 32 bit NEON isn't IEEE compliant, the results could differ */
+#include <arm_neon.h>
+#define LM_NEON
+#endif
+
 static float *s_blocklights = NULL, *s_blocklights_max = NULL;
 static byte *s_bufferlights = NULL, *s_bufferlights_max = NULL;
 
+/* false builds lightmaps with the scalar reference code */
+qboolean r_lightmapsimd = true;
+
 
 static int
 BSPX_LightGridSingleValue(const bspxlightgrid_t *grid, const lightstyle_t *lightstyles, int x, int y, int z, vec3_t res_diffuse)
@@ -294,6 +306,110 @@ R_SetCacheState(msurface_t *surf, const refdef_t *refdef)
 	}
 }
 
+#if defined(LM_SSE2) || defined(LM_NEON)
+/*
+ * SIMD version of the inner loop of R_AddDynamicLights(), 4 luxels
+ * of a row at once. Returns the number of luxels done, the scalar
+ * loop does the rest. The float operations are the same as in the
+ * scalar loop, in the same order, so the results are identical.
+ */
+static int
+R_AddDynamicLightRow(float *bl, int smax, int step, float lmvlen, float local,
+	int td, float frad, float fminlight, const float *color)
+{
+	int s;
+
+#if defined(LM_SSE2)
+	const __m128i vtd = _mm_set1_epi32(td);
+	const __m128i vtdhalf = _mm_set1_epi32(td >> 1);
+	const __m128 vlocal = _mm_set1_ps(local);
+	const __m128 vlmvlen = _mm_set1_ps(lmvlen);
+	const __m128 vrad = _mm_set1_ps(frad);
+	const __m128 vminlight = _mm_set1_ps(fminlight);
+	const __m128 vstep = _mm_set1_ps(4 * step);
+	/* the colors of 4 interleaved rgb luxels */
+	const __m128 c0 = _mm_setr_ps(color[0], color[1], color[2], color[0]);
+	const __m128 c1 = _mm_setr_ps(color[1], color[2], color[0], color[1]);
+	const __m128 c2 = _mm_setr_ps(color[2], color[0], color[1], color[2]);
+	__m128 fsacc = _mm_setr_ps(0, step, 2 * step, 3 * step);
+
+	for (s = 0; s + 4 <= smax; s += 4, bl += 12)
+	{
+		__m128i sd, sign, far, dist;
+		__m128 fdist, diff;
+
+		sd = _mm_cvttps_epi32(_mm_sub_ps(vlocal, fsacc));
+		sign = _mm_srai_epi32(sd, 31);
+		sd = _mm_sub_epi32(_mm_xor_si128(sd, sign), sign);
+		sd = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(sd), vlmvlen));
+
+		far = _mm_cmpgt_epi32(sd, vtd);
+		dist = _mm_or_si128(
+			_mm_and_si128(far, _mm_add_epi32(sd, vtdhalf)),
+			_mm_andnot_si128(far, _mm_add_epi32(vtd, _mm_srai_epi32(sd, 1))));
+		fdist = _mm_cvtepi32_ps(dist);
+
+		/* luxels out of reach add 0 */
+		diff = _mm_and_ps(_mm_cmplt_ps(fdist, vminlight),
+			_mm_sub_ps(vrad, fdist));
+
+		_mm_storeu_ps(bl, _mm_add_ps(_mm_loadu_ps(bl), _mm_mul_ps(
+			_mm_shuffle_ps(diff, diff, _MM_SHUFFLE(1, 0, 0, 0)), c0)));
+		_mm_storeu_ps(bl + 4, _mm_add_ps(_mm_loadu_ps(bl + 4), _mm_mul_ps(
+			_mm_shuffle_ps(diff, diff, _MM_SHUFFLE(2, 2, 1, 1)), c1)));
+		_mm_storeu_ps(bl + 8, _mm_add_ps(_mm_loadu_ps(bl + 8), _mm_mul_ps(
+			_mm_shuffle_ps(diff, diff, _MM_SHUFFLE(3, 3, 3, 2)), c2)));
+
+		fsacc = _mm_add_ps(fsacc, vstep);
+	}
+#else
+	const int32x4_t vtd = vdupq_n_s32(td);
+	const int32x4_t vtdhalf = vdupq_n_s32(td >> 1);
+	const float32x4_t vlocal = vdupq_n_f32(local);
+	const float32x4_t vlmvlen = vdupq_n_f32(lmvlen);
+	const float32x4_t vrad = vdupq_n_f32(frad);
+	const float32x4_t vminlight = vdupq_n_f32(fminlight);
+	const float32x4_t vstep = vdupq_n_f32(4 * step);
+	const float fsinit[4] = {0, step, 2 * step, 3 * step};
+	float32x4_t fsacc = vld1q_f32(fsinit);
+
+	for (s = 0; s + 4 <= smax; s += 4, bl += 12)
+	{
+		int32x4_t sd, dist;
+		uint32x4_t far;
+		float32x4_t fdist, diff;
+		float32x4x3_t rgb;
+		int i;
+
+		sd = vabsq_s32(vcvtq_s32_f32(vsubq_f32(vlocal, fsacc)));
+		sd = vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(sd), vlmvlen));
+
+		far = vcgtq_s32(sd, vtd);
+		dist = vbslq_s32(far, vaddq_s32(sd, vtdhalf),
+			vaddq_s32(vtd, vshrq_n_s32(sd, 1)));
+		fdist = vcvtq_f32_s32(dist);
+
+		/* luxels out of reach add 0 */
+		diff = vreinterpretq_f32_u32(vandq_u32(vcltq_f32(fdist, vminlight),
+			vreinterpretq_u32_f32(vsubq_f32(vrad, fdist))));
+
+		rgb = vld3q_f32(bl);
+
+		for (i = 0; i < 3; i++)
+		{
+			rgb.val[i] = vaddq_f32(rgb.val[i], vmulq_f32(diff, vdupq_n_f32(color[i])));
+		}
+
+		vst3q_f32(bl, rgb);
+
+		fsacc = vaddq_f32(fsacc, vstep);
+	}
+#endif
+
+	return s;
+}
+#endif
+
 static void
 R_AddDynamicLights(const msurface_t *surf, const refdef_t *r_newrefdef,
 	float *s_blocklights, const float *s_blocklights_max)
@@ -360,7 +476,21 @@ R_AddDynamicLights(const msurface_t *surf, const refdef_t *r_newrefdef,
 
 			td *= surf->lmvlen[1];
 
-			for (s = 0, fsacc = 0; s < smax; s++, fsacc += (1 << surf->lmshift), plightdest += 3)
+			s = 0;
+			fsacc = 0;
+
+#if defined(LM_SSE2) || defined(LM_NEON)
+			/* R_BuildLightMap() checked the size of the blocklights */
+			if (r_lightmapsimd)
+			{
+				s = R_AddDynamicLightRow(plightdest, smax, 1 << surf->lmshift,
+					surf->lmvlen[0], local[0], td, frad, fminlight, dl->color);
+				fsacc = s * (1 << surf->lmshift);
+				plightdest += s * 3;
+			}
+#endif
+
+			for (; s < smax; s++, fsacc += (1 << surf->lmshift), plightdest += 3)
 			{
 				int sd;
 
@@ -486,6 +616,237 @@ R_GetTemporaryLMBuffer(size_t size)
 	return s_bufferlights;
 }
 
+/*
+ * Adds a light style scaled per color to count luxels
+ * of the blocklights, or sets them if add is false.
+ */
+static void
+R_AddLightStyle(float *bl, const byte *lightmap, int count, const float *scale,
+	qboolean add)
+{
+	int i = 0;
+
+#if defined(LM_SSE2)
+	if (r_lightmapsimd)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128 s[3];
+
+		/* the scales of 4 interleaved rgb luxels, 16 luxels are
+		   12 vectors and the pattern repeats every 3 vectors */
+		s[0] = _mm_setr_ps(scale[0], scale[1], scale[2], scale[0]);
+		s[1] = _mm_setr_ps(scale[1], scale[2], scale[0], scale[1]);
+		s[2] = _mm_setr_ps(scale[2], scale[0], scale[1], scale[2]);
+
+		for (; i + 16 <= count; i += 16, bl += 48, lightmap += 48)
+		{
+			int j, k;
+
+			for (j = 0; j < 3; j++)
+			{
+				__m128i bytes, lo, hi;
+				__m128 f[4];
+
+				bytes = _mm_loadu_si128((const __m128i *)(lightmap + j * 16));
+				lo = _mm_unpacklo_epi8(bytes, zero);
+				hi = _mm_unpackhi_epi8(bytes, zero);
+
+				f[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+				f[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+				f[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+				f[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+
+				for (k = 0; k < 4; k++)
+				{
+					float *dst = bl + j * 16 + k * 4;
+					__m128 v;
+
+					v = _mm_mul_ps(f[k], s[(j * 4 + k) % 3]);
+
+					if (add)
+					{
+						v = _mm_add_ps(_mm_loadu_ps(dst), v);
+					}
+
+					_mm_storeu_ps(dst, v);
+				}
+			}
+		}
+	}
+#elif defined(LM_NEON)
+	if (r_lightmapsimd)
+	{
+		for (; i + 16 <= count; i += 16, bl += 48, lightmap += 48)
+		{
+			uint8x16x3_t bytes;
+			int c, k;
+
+			bytes = vld3q_u8(lightmap);
+
+			for (k = 0; k < 4; k++)
+			{
+				float32x4x3_t v;
+
+				if (add)
+				{
+					v = vld3q_f32(bl + k * 12);
+				}
+
+				for (c = 0; c < 3; c++)
+				{
+					uint16x8_t half;
+					uint32x4_t quarter;
+					float32x4_t f;
+
+					half = vmovl_u8((k < 2) ? vget_low_u8(bytes.val[c]) :
+						vget_high_u8(bytes.val[c]));
+					quarter = vmovl_u16((k & 1) ? vget_high_u16(half) :
+						vget_low_u16(half));
+					f = vmulq_f32(vcvtq_f32_u32(quarter), vdupq_n_f32(scale[c]));
+
+					v.val[c] = add ? vaddq_f32(v.val[c], f) : f;
+				}
+
+				vst3q_f32(bl + k * 12, v);
+			}
+		}
+	}
+#endif
+
+	for (; i < count; i++, bl += 3, lightmap += 3)
+	{
+		if (add)
+		{
+			bl[0] += lightmap[0] * scale[0];
+			bl[1] += lightmap[1] * scale[1];
+			bl[2] += lightmap[2] * scale[2];
+		}
+		else
+		{
+			bl[0] = lightmap[0] * scale[0];
+			bl[1] = lightmap[1] * scale[1];
+			bl[2] = lightmap[2] * scale[2];
+		}
+	}
+}
+
+#if defined(LM_SSE2) || defined(LM_NEON)
+/*
+ * SIMD version of the store loop of R_BuildLightMap(), 4 luxels
+ * of a row at once. Returns the number of luxels done.
+ */
+static int
+R_StoreLightRow(byte *dest, const float *bl, int smax)
+{
+	int j;
+
+#if defined(LM_SSE2)
+	const __m128i v255 = _mm_set1_epi32(255);
+	const __m128 f255 = _mm_set1_ps(255.0F);
+
+	for (j = 0; j + 4 <= smax; j += 4, bl += 12, dest += 4 * LIGHTMAP_BYTES)
+	{
+		__m128 a, b, c, t;
+		__m128i rgb[3], max, over;
+		int k;
+
+		/* deinterleave the rgb of 4 luxels */
+		a = _mm_loadu_ps(bl);
+		b = _mm_loadu_ps(bl + 4);
+		c = _mm_loadu_ps(bl + 8);
+
+		rgb[0] = _mm_cvttps_epi32(_mm_shuffle_ps(
+			_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 0)),
+			_mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 1, 0)));
+		rgb[1] = _mm_cvttps_epi32(_mm_shuffle_ps(
+			_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+			_mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+		rgb[2] = _mm_cvttps_epi32(_mm_shuffle_ps(
+			_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+			_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+
+		/* catch negative lights, find the brightest component */
+		for (k = 0; k < 3; k++)
+		{
+			rgb[k] = _mm_andnot_si128(_mm_srai_epi32(rgb[k], 31), rgb[k]);
+		}
+
+		over = _mm_cmpgt_epi32(rgb[1], rgb[0]);
+		max = _mm_or_si128(_mm_and_si128(over, rgb[1]), _mm_andnot_si128(over, rgb[0]));
+		over = _mm_cmpgt_epi32(rgb[2], max);
+		max = _mm_or_si128(_mm_and_si128(over, rgb[2]), _mm_andnot_si128(over, max));
+
+		/* rescale where max > 255, the division of the
+		   other luxels is thrown away */
+		over = _mm_cmpgt_epi32(max, v255);
+		t = _mm_div_ps(f255, _mm_cvtepi32_ps(max));
+
+		for (k = 0; k < 3; k++)
+		{
+			rgb[k] = _mm_or_si128(_mm_andnot_si128(over, rgb[k]), _mm_and_si128(over,
+				_mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(rgb[k]), t))));
+		}
+
+		max = _mm_or_si128(_mm_andnot_si128(over, max), _mm_and_si128(over,
+			_mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(max), t))));
+
+		/* every component is in 0..255, alpha is the brightest */
+		_mm_storeu_si128((__m128i *)dest, _mm_or_si128(
+			_mm_or_si128(rgb[0], _mm_slli_epi32(rgb[1], 8)),
+			_mm_or_si128(_mm_slli_epi32(rgb[2], 16), _mm_slli_epi32(max, 24))));
+	}
+#else
+	const int32x4_t zero = vdupq_n_s32(0);
+	const int32x4_t v255 = vdupq_n_s32(255);
+	const float32x4_t f255 = vdupq_n_f32(255.0F);
+
+	for (j = 0; j + 4 <= smax; j += 4, bl += 12, dest += 4 * LIGHTMAP_BYTES)
+	{
+		float32x4x3_t f;
+		int32x4_t rgb[3], max;
+		uint32x4_t over;
+		float32x4_t t;
+		uint32x4_t pixel;
+		int k;
+
+		f = vld3q_f32(bl);
+
+		/* catch negative lights, find the brightest component */
+		for (k = 0; k < 3; k++)
+		{
+			rgb[k] = vmaxq_s32(vcvtq_s32_f32(f.val[k]), zero);
+		}
+
+		max = vmaxq_s32(vmaxq_s32(rgb[0], rgb[1]), rgb[2]);
+
+		/* rescale where max > 255, the division of the
+		   other luxels is thrown away */
+		over = vcgtq_s32(max, v255);
+		t = vdivq_f32(f255, vcvtq_f32_s32(max));
+
+		for (k = 0; k < 3; k++)
+		{
+			rgb[k] = vbslq_s32(over,
+				vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(rgb[k]), t)), rgb[k]);
+		}
+
+		max = vbslq_s32(over, vcvtq_s32_f32(vmulq_f32(vcvtq_f32_s32(max), t)), max);
+
+		/* every component is in 0..255, alpha is the brightest */
+		pixel = vorrq_u32(
+			vorrq_u32(vreinterpretq_u32_s32(rgb[0]),
+				vshlq_n_u32(vreinterpretq_u32_s32(rgb[1]), 8)),
+			vorrq_u32(vshlq_n_u32(vreinterpretq_u32_s32(rgb[2]), 16),
+				vshlq_n_u32(vreinterpretq_u32_s32(max), 24)));
+
+		vst1q_u8(dest, vreinterpretq_u8_u32(pixel));
+	}
+#endif
+
+	return j;
+}
+#endif
+
 /*
  * Combine and scale multiple lightmaps into the floating format in blocklights
  */
@@ -495,7 +856,7 @@ R_BuildLightMap(const msurface_t *surf, byte *dest, int stride, const byte *dest
 {
 	int smax, tmax;
 	int r, g, b, a, max;
-	int i, j, size, nummaps;
+	int i, j, size, maps, nummaps;
 	byte *lightmap;
 	float scale[4];
 	float *bl;
@@ -537,83 +898,23 @@ R_BuildLightMap(const msurface_t *surf, byte *dest, int stride, const byte *dest
 	lightmap = surf->samples;
 
 	/* add all the lightmaps */
-	if (nummaps == 1)
-	{
-		int maps;
-
-		for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
-		{
-			bl = s_blocklights;
-
-			for (i = 0; i < 3; i++)
-			{
-				scale[i] = modulate *
-						   r_newrefdef->lightstyles[surf->styles[maps]].rgb[i];
-			}
-
-			if ((scale[0] == 1.0F) &&
-				(scale[1] == 1.0F) &&
-				(scale[2] == 1.0F))
-			{
-				for (i = 0; i < size; i++, bl += 3)
-				{
-					bl[0] = lightmap[i * 3 + 0];
-					bl[1] = lightmap[i * 3 + 1];
-					bl[2] = lightmap[i * 3 + 2];
-				}
-			}
-			else
-			{
-				for (i = 0; i < size; i++, bl += 3)
-				{
-					bl[0] = lightmap[i * 3 + 0] * scale[0];
-					bl[1] = lightmap[i * 3 + 1] * scale[1];
-					bl[2] = lightmap[i * 3 + 2] * scale[2];
-				}
-			}
-
-			lightmap += size * 3; /* skip to next lightmap */
-		}
-	}
-	else
+	if (!nummaps)
 	{
-		int maps;
-
 		memset(s_blocklights, 0, sizeof(s_blocklights[0]) * size * 3);
+	}
 
-		for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
+	for (maps = 0; maps < nummaps; maps++)
+	{
+		for (i = 0; i < 3; i++)
 		{
-			bl = s_blocklights;
-
-			for (i = 0; i < 3; i++)
-			{
-				scale[i] = modulate *
-						   r_newrefdef->lightstyles[surf->styles[maps]].rgb[i];
-			}
+			scale[i] = modulate *
+					   r_newrefdef->lightstyles[surf->styles[maps]].rgb[i];
+		}
 
-			if ((scale[0] == 1.0F) &&
-				(scale[1] == 1.0F) &&
-				(scale[2] == 1.0F))
-			{
-				for (i = 0; i < size; i++, bl += 3)
-				{
-					bl[0] += lightmap[i * 3 + 0];
-					bl[1] += lightmap[i * 3 + 1];
-					bl[2] += lightmap[i * 3 + 2];
-				}
-			}
-			else
-			{
-				for (i = 0; i < size; i++, bl += 3)
-				{
-					bl[0] += lightmap[i * 3 + 0] * scale[0];
-					bl[1] += lightmap[i * 3 + 1] * scale[1];
-					bl[2] += lightmap[i * 3 + 2] * scale[2];
-				}
-			}
+		/* the first map sets the blocklights */
+		R_AddLightStyle(s_blocklights, lightmap, size, scale, maps > 0);
 
-			lightmap += size * 3; /* skip to next lightmap */
-		}
+		lightmap += size * 3; /* skip to next lightmap */
 	}
 
 	/* add all the dynamic lights */
@@ -635,7 +936,18 @@ store:
 
 	for (i = 0; i < tmax; i++, dest += stride)
 	{
-		for (j = 0; j < smax; j++)
+		j = 0;
+
+#if defined(LM_SSE2) || defined(LM_NEON)
+		if (r_lightmapsimd)
+		{
+			j = R_StoreLightRow(dest, bl, smax);
+			dest += j * LIGHTMAP_BYTES;
+			bl += j * 3;
+		}
+#endif
+
+		for (; j < smax; j++)
 		{
 			r = Q_ftol(bl[0]);
 			g = Q_ftol(bl[1]);
@@ -803,3 +1115,126 @@ void R_PushDlights(refdef_t *r_newrefdef, mnode_t *nodes, int r_dlightframecount
 		R_MarkLights(l, 1 << i, nodes, r_dlightframecount, surfaces);
 	}
 }
+
+/*
+ * Rebuilds the lightmaps of all surfaces with the scalar reference
+ * and with the SIMD code, times both and counts the lightmaps that
+ * differ. build() writes the lightmap of a surface to dest, which
+ * has room for 16 bytes per luxel, and returns its size in bytes.
+ */
+void
+R_BenchLightMaps(msurface_t *surfaces, int numsurfaces, int runs,
+	int (*build)(msurface_t *surf, byte *dest), long long (*microseconds)(void))
+{
+	int *offsets, *sizes;
+	byte *results[2];
+	long long start, time[2];
+	int i, j, k, total, count, luxels, differ;
+	qboolean saved;
+
+	offsets = malloc(numsurfaces * sizeof(int));
+	sizes = malloc(numsurfaces * sizeof(int));
+
+	if (!offsets || !sizes)
+	{
+		Com_Error(ERR_DROP, "%s: Can't allocate", __func__);
+	}
+
+	total = 0;
+	count = 0;
+	luxels = 0;
+
+	for (i = 0; i < numsurfaces; i++)
+	{
+		const msurface_t *surf = &surfaces[i];
+		int size;
+
+		offsets[i] = -1;
+		sizes[i] = 0;
+
+		if (surf->texinfo->flags & (SURF_SKY | SURF_TRANSPARENT | SURF_WARP))
+		{
+			continue;
+		}
+
+		size = ((surf->extents[0] >> surf->lmshift) + 1) *
+			((surf->extents[1] >> surf->lmshift) + 1);
+
+		offsets[i] = total;
+		total += size * 16;
+		luxels += size;
+		count++;
+	}
+
+	if (!count)
+	{
+		R_Printf(PRINT_ALL, "No lightmaps.\n");
+		free(offsets);
+		free(sizes);
+		return;
+	}
+
+	results[0] = malloc(total);
+	results[1] = malloc(total);
+
+	if (!results[0] || !results[1])
+	{
+		Com_Error(ERR_DROP, "%s: Can't allocate", __func__);
+	}
+
+	saved = r_lightmapsimd;
+
+	/* 0 is the scalar reference, 1 the SIMD code */
+	for (k = 0; k < 2; k++)
+	{
+		r_lightmapsimd = k;
+		start = microseconds();
+
+		for (j = 0; j < runs; j++)
+		{
+			for (i = 0; i < numsurfaces; i++)
+			{
+				if (offsets[i] >= 0)
+				{
+					sizes[i] = build(&surfaces[i], results[k] + offsets[i]);
+				}
+			}
+		}
+
+		time[k] = microseconds() - start;
+	}
+
+	r_lightmapsimd = saved;
+
+	differ = 0;
+
+	for (i = 0; i < numsurfaces; i++)
+	{
+		if ((offsets[i] >= 0) &&
+			memcmp(results[0] + offsets[i], results[1] + offsets[i], sizes[i]))
+		{
+			differ++;
+		}
+	}
+
+	R_Printf(PRINT_ALL, "%i lightmaps, %i luxels, %i runs\n", count, luxels, runs);
+	R_Printf(PRINT_ALL, "scalar: %lld usec, %.3f usec per lightmap\n", time[0],
+			(float)time[0] / (count * runs));
+#if defined(LM_SSE2) || defined(LM_NEON)
+	R_Printf(PRINT_ALL, "%s: %lld usec, %.3f usec per lightmap\n",
+#if defined(LM_SSE2)
+			"sse2",
+#else
+			"neon",
+#endif
+			time[1], (float)time[1] / (count * runs));
+#else
+	R_Printf(PRINT_ALL, "No SIMD code in this build.\n");
+#endif
+	R_Printf(PRINT_ALL, "%i lightmaps differ\n", differ);
+
+	free(results[0]);
+	free(results[1]);
+	free(offsets);
+	free(sizes);
+}
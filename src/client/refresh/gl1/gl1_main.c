@@ -407,8 +407,8 @@ R_DrawEntitiesOnList(void)
 	glDepthMask(1); /* back to writing */
 }
 
-void
-R_DrawParticles2(int num_particles, const particle_t particles[],
+static void
+R_DrawParticleBatch(int num_particles, const particle_t particles[],
 		const unsigned *colortable)
 {
 	const particle_t *p;
@@ -508,6 +508,26 @@ R_DrawParticles2(int num_particles, const particle_t particles[],
 	YQ2_VLAFREE(clr);
 }
 
+/*
+ * The client may send more than MAX_PARTICLES,
+ * they're drawn in batches to keep the vertex
+ * arrays on the stack small.
+ */
+void
+R_DrawParticles2(int num_particles, const particle_t particles[],
+		const unsigned *colortable)
+{
+	while (num_particles > 0)
+	{
+		int n = Q_min(num_particles, MAX_PARTICLES);
+
+		R_DrawParticleBatch(n, particles, colortable);
+
+		particles += n;
+		num_particles -= n;
+	}
+}
+
 static void
 R_DrawParticles(void)
 {
@@ -521,15 +541,18 @@ R_DrawParticles(void)
 
 	if (gl_config.pointparameters && !(stereo_split_tb || stereo_split_lr))
 	{
-		int i;
+		int i, n, batch;
 		YQ2_ALIGNAS_TYPE(unsigned) byte color[4];
 		const particle_t *p;
 
-		YQ2_VLA(GLfloat, vtx, 3 * r_newrefdef.num_particles);
-		YQ2_VLA(GLfloat, clr, 4 * r_newrefdef.num_particles);
+		/* drawn in batches, see R_DrawParticles2() */
+		batch = Q_min(r_newrefdef.num_particles, MAX_PARTICLES);
+
+		YQ2_VLA(GLfloat, vtx, 3 * batch);
+		YQ2_VLA(GLfloat, clr, 4 * batch);
 
-		unsigned int index_vtx = 0;
-		unsigned int index_clr = 0;
+		unsigned int index_vtx;
+		unsigned int index_clr;
 
 		glDepthMask(GL_FALSE);
 		glEnable(GL_BLEND);
@@ -538,25 +561,35 @@ R_DrawParticles(void)
 		// assume the particle size looks good with window height 480px and scale according to real resolution
 		glPointSize(gl1_particle_size->value * (float)r_newrefdef.height/480.0f);
 
-		for ( i = 0, p = r_newrefdef.particles; i < r_newrefdef.num_particles; i++, p++ )
-		{
-			*(int *) color = d_8to24table [ p->color & 0xFF ];
-			clr[index_clr++] = color[0]/255.0f;
-			clr[index_clr++] = color[1]/255.0f;
-			clr[index_clr++] = color[2]/255.0f;
-			clr[index_clr++] = p->alpha;
-
-			vtx[index_vtx++] = p->origin[0];
-			vtx[index_vtx++] = p->origin[1];
-			vtx[index_vtx++] = p->origin[2];
-		}
-
 		glEnableClientState( GL_VERTEX_ARRAY );
 		glEnableClientState( GL_COLOR_ARRAY );
 
 		glVertexPointer( 3, GL_FLOAT, 0, vtx );
 		glColorPointer( 4, GL_FLOAT, 0, clr );
-		glDrawArrays( GL_POINTS, 0, r_newrefdef.num_particles );
+
+		p = r_newrefdef.particles;
+
+		for (n = r_newrefdef.num_particles; n > 0; n -= batch)
+		{
+			batch = Q_min(n, batch);
+			index_vtx = 0;
+			index_clr = 0;
+
+			for (i = 0; i < batch; i++, p++)
+			{
+				*(int *) color = d_8to24table [ p->color & 0xFF ];
+				clr[index_clr++] = color[0]/255.0f;
+				clr[index_clr++] = color[1]/255.0f;
+				clr[index_clr++] = color[2]/255.0f;
+				clr[index_clr++] = p->alpha;
+
+				vtx[index_vtx++] = p->origin[0];
+				vtx[index_vtx++] = p->origin[1];
+				vtx[index_vtx++] = p->origin[2];
+			}
+
+			glDrawArrays( GL_POINTS, 0, batch );
+		}
 
 		glDisableClientState( GL_VERTEX_ARRAY );
 		glDisableClientState( GL_COLOR_ARRAY );
@@ -1257,6 +1290,7 @@ R_Register(void)
 	ri.Cmd_AddCommand("screenshot", R_ScreenShot);
 	ri.Cmd_AddCommand("modellist", Mod_Modellist_f);
 	ri.Cmd_AddCommand("gl_strings", R_Strings);
+	ri.Cmd_AddCommand("lightmapbench", LM_Bench_f);
 }
 
 /*
@@ -1591,6 +1625,7 @@ RI_Shutdown(void)
 	ri.Cmd_RemoveCommand("screenshot");
 	ri.Cmd_RemoveCommand("imagelist");
 	ri.Cmd_RemoveCommand("gl_strings");
+	ri.Cmd_RemoveCommand("lightmapbench");
 
 	Mod_FreeAll();
 
@@ -396,6 +396,7 @@ typedef struct
 void LM_BuildPolygonFromSurface(model_t *currentmodel, msurface_t *fa);
 void LM_CreateSurfaceLightmap(msurface_t *surf);
 void LM_EndBuildingLightmaps(void);
+void LM_Bench_f(void);
 void LM_BeginBuildingLightmaps(model_t *m);
 
 extern glconfig_t gl_config;
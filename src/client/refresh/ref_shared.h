@@ -220,8 +220,10 @@ typedef struct mpoly_s
 /* soft render specific surface cache */
 typedef struct surfcache_s
 {
-	struct surfcache_s	*next;
-	struct surfcache_s	**owner;   /* NULL is an empty chunk of memory */
+	struct surfcache_s	*next;     /* least recently used order */
+	struct surfcache_s	*prev;
+	struct surfcache_s	**owner;   /* cleared when the cache is freed */
+	int	frame;                     /* last used in this frame */
 	int	lightadj[MAXLIGHTMAPS];    /* checked for strobe flush */
 	int	dlight;
 	int	size;                      /* including header */
@@ -393,6 +395,9 @@ extern void R_BuildLightMap(const msurface_t *surf, byte *dest, int stride, cons
 extern void R_InitTemporaryLMBuffer(void);
 extern void R_FreeTemporaryLMBuffer(void);
 extern byte *R_GetTemporaryLMBuffer(size_t size);
+extern void R_BenchLightMaps(msurface_t *surfaces, int numsurfaces, int runs,
+	int (*build)(msurface_t *surf, byte *dest), long long (*microseconds)(void));
+extern qboolean r_lightmapsimd;
 
 /* Warp Sky logic */
 extern void R_ClipSkyPolygon(int nump, vec3_t vecs, int stage,
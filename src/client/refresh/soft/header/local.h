@@ -328,9 +328,17 @@ extern pixel_t		*r_warpbuffer;
 
 extern float		scale_for_mip;
 
-extern float	d_sdivzstepu, d_tdivzstepu;
-extern float	d_sdivzstepv, d_tdivzstepv;
-extern float	d_sdivzorigin, d_tdivzorigin;
+/* the span drawers run on several threads with sw_threads,
+   so their state is per thread */
+#ifdef _MSC_VER
+#define SW_THREADLOCAL __declspec(thread)
+#else
+#define SW_THREADLOCAL __thread
+#endif
+
+extern SW_THREADLOCAL float	d_sdivzstepu, d_tdivzstepu;
+extern SW_THREADLOCAL float	d_sdivzstepv, d_tdivzstepv;
+extern SW_THREADLOCAL float	d_sdivzorigin, d_tdivzorigin;
 
 void D_DrawSpansPow2(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv);
 void D_DrawZSpans(espan_t *pspan, float d_ziorigin, float d_zistepu, float d_zistepv);
@@ -355,8 +363,8 @@ extern int vid_buffer_width;
 
 //===================================================================
 
-extern int	cachewidth;
-extern pixel_t	*cacheblock;
+extern SW_THREADLOCAL int	cachewidth;
+extern SW_THREADLOCAL pixel_t	*cacheblock;
 
 extern int	r_drawnpolycount;
 
@@ -397,6 +405,7 @@ extern cvar_t	*sw_mipscale;
 extern cvar_t	*sw_stipplealpha;
 extern cvar_t	*sw_surfcacheoverride;
 extern cvar_t	*sw_waterwarp;
+extern cvar_t	*sw_threads;
 extern cvar_t	*sw_gunzposition;
 extern cvar_t	*r_validation;
 extern cvar_t	*r_retexturing;
@@ -459,16 +468,20 @@ void R_AliasDrawModel(entity_t *currententity, const model_t *currentmodel);
 void R_BeginEdgeFrame(void);
 void R_ScanEdges(entity_t *currententity, surf_t *surface);
 void RI_PushDlights(const model_t *model);
+void RI_LightMapBench_f(void);
 void R_RotateBmodel(const entity_t *currententity);
 
 extern int	c_faceclip;
 extern int	r_polycount;
 
-extern int	sadjust, tadjust;
-extern int	bbextents, bbextentt;
+extern SW_THREADLOCAL int	sadjust, tadjust;
+extern SW_THREADLOCAL int	bbextents, bbextentt;
 
 extern int	r_currentkey;
 
+// threads drawing the world and the water warp, including the main thread
+extern int	r_numthreads;
+
 void R_DrawParticles (void);
 
 extern int	r_amodels_drawn;
@@ -535,7 +548,17 @@ void R_SetupFrame (void);
 
 extern  refdef_t		r_newrefdef;
 
-extern  surfcache_t	*sc_base;
+/* surface cache statistics of the current frame */
+typedef struct
+{
+	int	hits;		/* used as it was */
+	int	built;		/* drawn and lit */
+	int	allocated;	/* new caches */
+	int	evicted;	/* least recently used caches freed */
+	int	grown;		/* times the cache limit was raised */
+} sccachestats_t;
+
+extern  sccachestats_t	sc_stats;
 
 extern  void			*colormap;
 
@@ -544,6 +567,7 @@ extern  void			*colormap;
 void Draw_InitLocal(void);
 void R_InitCaches(void);
 void D_FlushCaches(void);
+void D_PrintCacheStats(void);
 
 void	RE_BeginRegistration (const char *model);
 struct model_s	*RE_RegisterModel (const char *name);
@@ -582,6 +606,7 @@ void VID_DamageBuffer(int u, int v);
 extern qboolean	fastmoving;
 void VID_DamageZBuffer(int u, int v);
 qboolean VID_CheckDamageZBuffer(int u, int v, int ucount, int vcount);
+void VID_WholeDamageZBuffer(void);
 
 /*
 ====================================================================
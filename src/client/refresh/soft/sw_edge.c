@@ -759,11 +759,9 @@ Simple single color fill with no texture mapping
 ==============
 */
 static void
-D_FlatFillSurface (surf_t *surf, pixel_t color)
+D_FlatFillSurface (const espan_t *span, pixel_t color)
 {
-	espan_t	*span;
-
-	for (span=surf->spans ; span ; span=span->pnext)
+	for ( ; span ; span=span->pnext)
 	{
 		pixel_t   *pdest;
 
@@ -831,22 +829,6 @@ D_CalcGradients (msurface_t *pface, float d_ziorigin, float d_zistepu, float d_z
 }
 
 
-/*
-==============
-D_BackgroundSurf
-
-The grey background filler seen when there is a hole in the map
-==============
-*/
-static void
-D_BackgroundSurf (surf_t *s)
-{
-	D_FlatFillSurface (s, (int)sw_clearcolor->value & 0xFF);
-	// set up a gradient for the background surface that places it
-	// effectively at infinity distance from the viewpoint
-	D_DrawZSpans (s->spans, -0.9, 0, 0);
-}
-
 /*
 =================
 D_TurbulentSurf
@@ -878,16 +860,6 @@ D_TurbulentSurf(surf_t *s)
 
 	D_CalcGradients (pface, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
 
-	//============
-	// textures that aren't warping are just flowing. Use NonTurbulentPow2 instead
-	if(!(pface->texinfo->flags & SURF_WARP))
-		NonTurbulentPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
-	else
-		TurbulentPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
-	//============
-
-	D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
-
 	if (s->insubmodel)
 	{
 		//
@@ -909,23 +881,19 @@ D_TurbulentSurf(surf_t *s)
 D_SkySurf
 ==============
 */
-static void
+static qboolean
 D_SkySurf (surf_t *s)
 {
 	pface = s->msurf;
 	miplevel = 0;
 	if (!pface->texinfo->image)
-		return;
+		return false;
 	cacheblock = pface->texinfo->image->pixels[0];
 	cachewidth = 256;
 
 	D_CalcGradients (pface, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
 
-	D_DrawSpansPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
-
-	// set up a gradient for the background surface that places it
-	// effectively at infinity distance from the viewpoint
-	D_DrawZSpans (s->spans, -0.9, 0, 0);
+	return true;
 }
 
 /*
@@ -973,10 +941,6 @@ D_SolidSurf (entity_t *currententity, surf_t *s)
 
 	D_CalcGradients (pface, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
 
-	D_DrawSpansPow2 (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
-
-	D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
-
 	if (s->insubmodel)
 	{
 		//
@@ -993,6 +957,307 @@ D_SolidSurf (entity_t *currententity, surf_t *s)
 	}
 }
 
+/*
+==============
+D_SetupSurf
+
+Sets up cacheblock and the texture gradients the span drawers use,
+returns false if there is nothing to draw
+==============
+*/
+static qboolean
+D_SetupSurf (entity_t *currententity, surf_t *s)
+{
+	pcurrentcache = NULL;
+
+	if (! (s->flags & (SURF_DRAWSKY|SURF_DRAWBACKGROUND|SURF_DRAWTURB) ) )
+		D_SolidSurf (currententity, s);
+	else if (s->flags & SURF_DRAWSKY)
+		return D_SkySurf (s);
+	else if (s->flags & SURF_DRAWTURB)
+		D_TurbulentSurf (s);
+
+	return true;
+}
+
+/*
+==============
+D_DrawSurfSpans
+
+Draws the given spans of a surface after D_SetupSurf
+==============
+*/
+static void
+D_DrawSurfSpans (const surf_t *s, espan_t *spans)
+{
+	if (! (s->flags & (SURF_DRAWSKY|SURF_DRAWBACKGROUND|SURF_DRAWTURB) ) )
+	{
+		D_DrawSpansPow2 (spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+		D_DrawZSpans (spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	}
+	else if (s->flags & SURF_DRAWSKY)
+	{
+		D_DrawSpansPow2 (spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+
+		// set up a gradient for the background surface that places it
+		// effectively at infinity distance from the viewpoint
+		D_DrawZSpans (spans, -0.9, 0, 0);
+	}
+	else if (s->flags & SURF_DRAWBACKGROUND)
+	{
+		// The grey background filler seen when there is a hole in the map
+		D_FlatFillSurface (spans, (int)sw_clearcolor->value & 0xFF);
+		D_DrawZSpans (spans, -0.9, 0, 0);
+	}
+	else if (s->flags & SURF_DRAWTURB)
+	{
+		// textures that aren't warping are just flowing. Use NonTurbulentPow2 instead
+		if(!(s->msurf->texinfo->flags & SURF_WARP))
+			NonTurbulentPow2 (spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+		else
+			TurbulentPow2 (spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+
+		D_DrawZSpans (spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
+	}
+}
+
+/*
+===============================================================================
+
+BANDED SURFACE DRAWING
+
+With sw_threads the span lists are set up on the main thread, including
+the surface cache, and then split into horizontal bands of the screen.
+The bands are drawn in parallel. Spans never overlap, so the result is
+the same as drawing them in order.
+
+===============================================================================
+*/
+
+#define MAX_BANDS		64
+#define BANDS_PER_THREAD	4
+
+// what the span drawers need for one surface
+typedef struct
+{
+	const surf_t	*surf;
+	surfcache_t		*cache;
+	surfcache_t		**owner;
+
+	pixel_t	*cacheblock;
+	int		cachewidth;
+	float	sdivzstepu, tdivzstepu;
+	float	sdivzstepv, tdivzstepv;
+	float	sdivzorigin, tdivzorigin;
+	int		sadjust, tadjust, bbextents, bbextentt;
+} bandsurf_t;
+
+static bandsurf_t	*bandsurfs;
+static espan_t		**bandspans;	// [band * numbandsurfs + surf]
+static int			maxbandsurfs, maxbands;
+static int			numbandsurfs, numbands;
+
+static void
+D_SaveBandSurf (bandsurf_t *b, const surf_t *s)
+{
+	b->surf = s;
+	b->cache = pcurrentcache;
+	b->owner = pcurrentcache ? pcurrentcache->owner : NULL;
+
+	b->cacheblock = cacheblock;
+	b->cachewidth = cachewidth;
+	b->sdivzstepu = d_sdivzstepu;
+	b->tdivzstepu = d_tdivzstepu;
+	b->sdivzstepv = d_sdivzstepv;
+	b->tdivzstepv = d_tdivzstepv;
+	b->sdivzorigin = d_sdivzorigin;
+	b->tdivzorigin = d_tdivzorigin;
+	b->sadjust = sadjust;
+	b->tadjust = tadjust;
+	b->bbextents = bbextents;
+	b->bbextentt = bbextentt;
+}
+
+static void
+D_LoadBandSurf (const bandsurf_t *b)
+{
+	cacheblock = b->cacheblock;
+	cachewidth = b->cachewidth;
+	d_sdivzstepu = b->sdivzstepu;
+	d_tdivzstepu = b->tdivzstepu;
+	d_sdivzstepv = b->sdivzstepv;
+	d_tdivzstepv = b->tdivzstepv;
+	d_sdivzorigin = b->sdivzorigin;
+	d_tdivzorigin = b->tdivzorigin;
+	sadjust = b->sadjust;
+	tadjust = b->tadjust;
+	bbextents = b->bbextents;
+	bbextentt = b->bbextentt;
+}
+
+static int
+D_CompareCaches (const void *a, const void *b)
+{
+	const surfcache_t *ca = ((const bandsurf_t *)a)->cache;
+	const surfcache_t *cb = ((const bandsurf_t *)b)->cache;
+
+	return (ca > cb) - (ca < cb);
+}
+
+/*
+==============
+D_BandCachesValid
+
+Setting up a later surface may have evicted or rebuilt the cache of
+an earlier one, which the serial path would already have drawn.
+==============
+*/
+static qboolean
+D_BandCachesValid (void)
+{
+	int i;
+
+	for (i = 0; i < numbandsurfs; i++)
+	{
+		const bandsurf_t *b = &bandsurfs[i];
+
+		// an evicted cache is freed, check its owner first
+		if (b->cache && (!b->owner || (*b->owner != b->cache) ||
+			(b->cache->owner != b->owner)))
+			return false;
+	}
+
+	// the same cache for two surfaces, e.g. two entities with the same
+	// bmodel, may have been rebuilt for the second one
+	qsort (bandsurfs, numbandsurfs, sizeof(bandsurf_t), D_CompareCaches);
+
+	for (i = 1; i < numbandsurfs; i++)
+	{
+		if (bandsurfs[i].cache && (bandsurfs[i].cache == bandsurfs[i - 1].cache))
+			return false;
+	}
+
+	return true;
+}
+
+static void
+D_DrawBandJob (void *data, int band, int thread)
+{
+	espan_t **spans;
+	int i;
+
+	spans = bandspans + band * numbandsurfs;
+
+	for (i = 0; i < numbandsurfs; i++)
+	{
+		if (!spans[i])
+			continue;
+
+		D_LoadBandSurf (&bandsurfs[i]);
+		D_DrawSurfSpans (bandsurfs[i].surf, spans[i]);
+	}
+}
+
+/*
+==============
+D_DrawSurfacesBanded
+==============
+*/
+static void
+D_DrawSurfacesBanded (entity_t *currententity, surf_t *surface)
+{
+	surf_t	*s;
+	int		i, top, bandheight;
+
+	numbands = r_numthreads * BANDS_PER_THREAD;
+	if (numbands > MAX_BANDS)
+		numbands = MAX_BANDS;
+	if (numbands > r_refdef.vrect.height)
+		numbands = r_refdef.vrect.height;
+
+	if ((surface - surfaces) > maxbandsurfs)
+	{
+		free (bandsurfs);
+		maxbandsurfs = surface - surfaces;
+		bandsurfs = malloc (maxbandsurfs * sizeof(bandsurf_t));
+		maxbands = 0;
+	}
+
+	if (numbands > maxbands)
+	{
+		free (bandspans);
+		maxbands = numbands;
+		bandspans = malloc (maxbandsurfs * maxbands * sizeof(espan_t *));
+	}
+
+	if (!bandsurfs || !bandspans)
+	{
+		Com_Error (ERR_FATAL, "%s: couldn't allocate %i surfaces",
+			__func__, maxbandsurfs);
+	}
+
+	// set up everything that isn't thread safe
+	numbandsurfs = 0;
+
+	for (s = &surfaces[1] ; s<surface ; s++)
+	{
+		if (!s->spans)
+			continue;
+
+		r_drawnpolycount++;
+
+		if (D_SetupSurf (currententity, s))
+			D_SaveBandSurf (&bandsurfs[numbandsurfs++], s);
+	}
+
+	if (!D_BandCachesValid ())
+	{
+		// surface cache too small, draw one by one
+		for (i = 0; i < numbandsurfs; i++)
+		{
+			s = (surf_t *)bandsurfs[i].surf;
+
+			if (D_SetupSurf (currententity, s))
+				D_DrawSurfSpans (s, s->spans);
+		}
+
+		return;
+	}
+
+	// split the span lists into bands
+	memset (bandspans, 0, numbands * numbandsurfs * sizeof(espan_t *));
+
+	top = r_refdef.vrect.y;
+	bandheight = (r_refdef.vrect.height + numbands - 1) / numbands;
+
+	for (i = 0; i < numbandsurfs; i++)
+	{
+		espan_t *span, *next;
+
+		for (span = bandsurfs[i].surf->spans ; span ; span = next)
+		{
+			int band;
+
+			next = span->pnext;
+
+			band = (span->v - top) / bandheight;
+			if (band < 0)
+				band = 0;
+			else if (band >= numbands)
+				band = numbands - 1;
+
+			span->pnext = bandspans[band * numbandsurfs + i];
+			bandspans[band * numbandsurfs + i] = span;
+		}
+	}
+
+	// spans only write the z buffer when it's damaged, with all of it
+	// damaged the bands don't need to update the shared damage state
+	VID_WholeDamageZBuffer ();
+
+	ri.Sys_RunParallel (D_DrawBandJob, NULL, numbands);
+}
+
 /*
 =============
 D_DrawflatSurfaces
@@ -1013,7 +1278,7 @@ D_DrawflatSurfaces (const surf_t *surface)
 
 		// make a stable color for each surface by taking the low
 		// bits of the msurface pointer
-		D_FlatFillSurface (s, color & 0xFF);
+		D_FlatFillSurface (s->spans, color & 0xFF);
 		D_DrawZSpans (s->spans, s->d_ziorigin, s->d_zistepu, s->d_zistepv);
 
 		color ++;
@@ -1035,7 +1300,11 @@ D_DrawSurfaces (entity_t *currententity, surf_t *surface)
 	TransformVector (modelorg, transformed_modelorg);
 	VectorCopy (transformed_modelorg, world_transformed_modelorg);
 
-	if (!sw_drawflat->value)
+	if (!sw_drawflat->value && (r_numthreads > 1))
+	{
+		D_DrawSurfacesBanded (currententity, surface);
+	}
+	else if (!sw_drawflat->value)
 	{
 		surf_t *s;
 
@@ -1046,14 +1315,8 @@ D_DrawSurfaces (entity_t *currententity, surf_t *surface)
 
 			r_drawnpolycount++;
 
-			if (! (s->flags & (SURF_DRAWSKY|SURF_DRAWBACKGROUND|SURF_DRAWTURB) ) )
-				D_SolidSurf (currententity, s);
-			else if (s->flags & SURF_DRAWSKY)
-				D_SkySurf (s);
-			else if (s->flags & SURF_DRAWBACKGROUND)
-				D_BackgroundSurf (s);
-			else if (s->flags & SURF_DRAWTURB)
-				D_TurbulentSurf (s);
+			if (D_SetupSurf (currententity, s))
+				D_DrawSurfSpans (s, s->spans);
 		}
 	}
 	else
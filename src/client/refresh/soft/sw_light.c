@@ -21,6 +21,14 @@
 
 #include "header/local.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LM_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LM_NEON
+#endif
+
 vec3_t lightspot;
 light_t	*blocklights = NULL, *blocklight_max = NULL;
 
@@ -185,6 +193,208 @@ RI_AddDynamicLights(drawsurf_t* drawsurf)
 	}
 }
 
+#if defined(LM_SSE2)
+/* the low 32 bits of the products, SSE2 only multiplies two lanes */
+static inline __m128i
+RI_MulLo32(__m128i a, __m128i b)
+{
+	__m128i even, odd;
+
+	even = _mm_mul_epu32(a, b);
+	odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+#endif
+
+/*
+ * Adds a light style to count values of the blocklights, each color
+ * on its own. Returns the number of values done, the scalar loop
+ * does the rest.
+ */
+static int
+RI_AddLightStyleColor(light_t *curr_light, const byte *lightmap, int count,
+	unsigned scale)
+{
+	int i = 0;
+
+#if defined(LM_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vscale = _mm_set1_epi32(scale);
+
+	for (; i + 16 <= count; i += 16, curr_light += 16, lightmap += 16)
+	{
+		__m128i bytes, half[2];
+		int k;
+
+		bytes = _mm_loadu_si128((const __m128i *)lightmap);
+		half[0] = _mm_unpacklo_epi8(bytes, zero);
+		half[1] = _mm_unpackhi_epi8(bytes, zero);
+
+		for (k = 0; k < 4; k++)
+		{
+			__m128i *dst = (__m128i *)(curr_light + k * 4);
+			__m128i light;
+
+			light = (k & 1) ? _mm_unpackhi_epi16(half[k >> 1], zero) :
+				_mm_unpacklo_epi16(half[k >> 1], zero);
+
+			_mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst),
+				RI_MulLo32(light, vscale)));
+		}
+	}
+#elif defined(LM_NEON)
+	for (; i + 16 <= count; i += 16, curr_light += 16, lightmap += 16)
+	{
+		uint8x16_t bytes;
+		uint16x8_t half[2];
+		int k;
+
+		bytes = vld1q_u8(lightmap);
+		half[0] = vmovl_u8(vget_low_u8(bytes));
+		half[1] = vmovl_u8(vget_high_u8(bytes));
+
+		for (k = 0; k < 4; k++)
+		{
+			uint32x4_t light;
+
+			light = vmovl_u16((k & 1) ? vget_high_u16(half[k >> 1]) :
+				vget_low_u16(half[k >> 1]));
+
+			vst1q_u32(curr_light + k * 4,
+				vmlaq_n_u32(vld1q_u32(curr_light + k * 4), light, scale));
+		}
+	}
+#endif
+
+	return i;
+}
+
+/*
+ * Same for the monochrome light, the brightest color of
+ * each luxel is added to all three values of the luxel.
+ * Returns the number of luxels done.
+ */
+static int
+RI_AddLightStyleMono(light_t *curr_light, const byte *lightmap, int luxels,
+	unsigned scale)
+{
+	int i = 0;
+
+#if defined(LM_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i vscale = _mm_set1_epi32(scale);
+
+	/* 4 luxels are 12 bytes, but 16 are read */
+	for (; i + 6 <= luxels; i += 4, curr_light += 12, lightmap += 12)
+	{
+		__m128i bytes, max, lo, hi, light;
+
+		/* byte 3 * n is the brightest color of luxel n */
+		bytes = _mm_loadu_si128((const __m128i *)lightmap);
+		max = _mm_max_epu8(_mm_max_epu8(bytes, _mm_srli_si128(bytes, 1)),
+			_mm_srli_si128(bytes, 2));
+		lo = _mm_unpacklo_epi8(max, zero);
+		hi = _mm_unpackhi_epi8(max, zero);
+
+		light = _mm_setr_epi32(_mm_extract_epi16(lo, 0), _mm_extract_epi16(lo, 3),
+			_mm_extract_epi16(lo, 6), _mm_extract_epi16(hi, 1));
+		light = RI_MulLo32(light, vscale);
+
+		_mm_storeu_si128((__m128i *)curr_light, _mm_add_epi32(
+			_mm_loadu_si128((const __m128i *)curr_light),
+			_mm_shuffle_epi32(light, _MM_SHUFFLE(1, 0, 0, 0))));
+		_mm_storeu_si128((__m128i *)(curr_light + 4), _mm_add_epi32(
+			_mm_loadu_si128((const __m128i *)(curr_light + 4)),
+			_mm_shuffle_epi32(light, _MM_SHUFFLE(2, 2, 1, 1))));
+		_mm_storeu_si128((__m128i *)(curr_light + 8), _mm_add_epi32(
+			_mm_loadu_si128((const __m128i *)(curr_light + 8)),
+			_mm_shuffle_epi32(light, _MM_SHUFFLE(3, 3, 3, 2))));
+	}
+#elif defined(LM_NEON)
+	for (; i + 16 <= luxels; i += 16, curr_light += 48, lightmap += 48)
+	{
+		uint8x16x3_t bytes;
+		uint8x16_t max;
+		uint16x8_t half[2];
+		int k;
+
+		bytes = vld3q_u8(lightmap);
+		max = vmaxq_u8(vmaxq_u8(bytes.val[0], bytes.val[1]), bytes.val[2]);
+		half[0] = vmovl_u8(vget_low_u8(max));
+		half[1] = vmovl_u8(vget_high_u8(max));
+
+		for (k = 0; k < 4; k++)
+		{
+			uint32x4x3_t rgb;
+			uint32x4_t light;
+			int c;
+
+			light = vmovl_u16((k & 1) ? vget_high_u16(half[k >> 1]) :
+				vget_low_u16(half[k >> 1]));
+			light = vmulq_n_u32(light, scale);
+
+			rgb = vld3q_u32(curr_light + k * 12);
+
+			for (c = 0; c < 3; c++)
+			{
+				rgb.val[c] = vaddq_u32(rgb.val[c], light);
+			}
+
+			vst3q_u32(curr_light + k * 12, rgb);
+		}
+	}
+#endif
+
+	return i;
+}
+
+/*
+ * Bounds, inverts and shifts count values of the blocklights.
+ * Returns the number of values done.
+ */
+static int
+RI_ShiftLights(light_t *curr_light, int count)
+{
+	int i = 0;
+
+#if defined(LM_SSE2)
+	const __m128i full = _mm_set1_epi32(255 * 256);
+	const __m128i minlight = _mm_set1_epi32(1 << 6);
+
+	for (; i + 4 <= count; i += 4, curr_light += 4)
+	{
+		__m128i t, low;
+
+		t = _mm_loadu_si128((const __m128i *)curr_light);
+		t = _mm_andnot_si128(_mm_srai_epi32(t, 31), t);
+		t = _mm_srai_epi32(_mm_sub_epi32(full, t), 8 - VID_CBITS);
+
+		low = _mm_cmplt_epi32(t, minlight);
+		t = _mm_or_si128(_mm_and_si128(low, minlight), _mm_andnot_si128(low, t));
+
+		_mm_storeu_si128((__m128i *)curr_light, t);
+	}
+#elif defined(LM_NEON)
+	const int32x4_t full = vdupq_n_s32(255 * 256);
+	const int32x4_t minlight = vdupq_n_s32(1 << 6);
+
+	for (; i + 4 <= count; i += 4, curr_light += 4)
+	{
+		int32x4_t t;
+
+		t = vmaxq_s32(vreinterpretq_s32_u32(vld1q_u32(curr_light)), vdupq_n_s32(0));
+		t = vshrq_n_s32(vsubq_s32(full, t), 8 - VID_CBITS);
+		t = vmaxq_s32(t, minlight);
+
+		vst1q_u32(curr_light, vreinterpretq_u32_s32(t));
+	}
+#endif
+
+	return i;
+}
+
 /*
  * Combine and scale multiple lightmaps into the 8.8 format in blocklights
  */
@@ -220,7 +430,7 @@ RI_BuildLightMap(drawsurf_t* drawsurf)
 	lightmap = surf->samples;
 	if (lightmap)
 	{
-		int maps;
+		int maps, i;
 
 		for (maps = 0 ; maps < MAXLIGHTMAPS && surf->styles[maps] != 255 ;
 			 maps++)
@@ -235,7 +445,14 @@ RI_BuildLightMap(drawsurf_t* drawsurf)
 
 			if(r_colorlight->value == 0)
 			{
-				do
+				if (r_lightmapsimd)
+				{
+					i = RI_AddLightStyleMono(curr_light, lightmap, size / 3, scale);
+					curr_light += i * 3;
+					lightmap += i * 3;
+				}
+
+				while (curr_light < max_light)
 				{
 					light_t light;
 
@@ -256,17 +473,22 @@ RI_BuildLightMap(drawsurf_t* drawsurf)
 
 					lightmap += 3; /* skip to next lightmap */
 				}
-				while(curr_light < max_light);
 			}
 			else
 			{
-				do
+				if (r_lightmapsimd)
+				{
+					i = RI_AddLightStyleColor(curr_light, lightmap, size, scale);
+					curr_light += i;
+					lightmap += i;
+				}
+
+				while (curr_light < max_light)
 				{
 					*curr_light += *lightmap * scale;
 					curr_light++;
 					lightmap ++; /* skip to next lightmap */
 				}
-				while(curr_light < max_light);
 			}
 		}
 	}
@@ -307,7 +529,12 @@ RI_BuildLightMap(drawsurf_t* drawsurf)
 		curr_light = blocklights;
 		max_light = blocklights + size;
 
-		do
+		if (r_lightmapsimd)
+		{
+			curr_light += RI_ShiftLights(curr_light, size);
+		}
+
+		while (curr_light < max_light)
 		{
 			int t;
 
@@ -323,6 +550,65 @@ RI_BuildLightMap(drawsurf_t* drawsurf)
 			*curr_light = t;
 			curr_light++;
 		}
-		while(curr_light < max_light);
 	}
 }
+
+/*
+ * Lightmap of a surface for R_BenchLightMaps(),
+ * the blocklights as RI_BuildLightMap() leaves them.
+ */
+static int
+RI_BenchBuildLightMap(msurface_t *surf, byte *dest)
+{
+	drawsurf_t drawsurf;
+	int i, size;
+
+	size = ((surf->extents[0] >> surf->lmshift) + 1) *
+		((surf->extents[1] >> surf->lmshift) + 1) * 3;
+
+	if (blocklight_max <= blocklights + size)
+	{
+		return 0;
+	}
+
+	memset(&drawsurf, 0, sizeof(drawsurf));
+	drawsurf.surf = surf;
+
+	for (i = 0; i < MAXLIGHTMAPS; i++)
+	{
+		drawsurf.lightadj[i] = r_newrefdef.lightstyles[surf->styles[i]].white * 128;
+	}
+
+	RI_BuildLightMap(&drawsurf);
+
+	memcpy(dest, blocklights, size * sizeof(light_t));
+
+	return size * sizeof(light_t);
+}
+
+/*
+ * lightmapbench [runs]
+ */
+void
+RI_LightMapBench_f(void)
+{
+	int runs;
+
+	if (ri.Cmd_Argc() > 2)
+	{
+		R_Printf(PRINT_ALL, "Usage: lightmapbench [runs]\n");
+		return;
+	}
+
+	if (!r_worldmodel || !r_newrefdef.lightstyles)
+	{
+		R_Printf(PRINT_ALL, "No map loaded.\n");
+		return;
+	}
+
+	runs = (ri.Cmd_Argc() == 2) ? atoi(ri.Cmd_Argv(1)) : 10;
+	runs = (runs < 1) ? 1 : runs;
+
+	R_BenchLightMaps(r_worldmodel->surfaces, r_worldmodel->numsurfaces, runs,
+		RI_BenchBuildLightMap, ri.Sys_Microseconds);
+}
@@ -27,6 +27,20 @@
 
 #include "header/local.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SW_SSE2
+/* AVX2 isn't enabled by the build, it's
+   compiled for and picked at runtime */
+#if defined(__GNUC__) || defined(_MSC_VER)
+#include <immintrin.h>
+#define SW_AVX2
+#endif
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SW_NEON
+#endif
+
 #define NUMSTACKEDGES		2048
 #define NUMSTACKSURFACES	1024
 #define MAXALIASVERTS		2048
@@ -45,6 +59,37 @@ static int	vid_minu, vid_minv, vid_maxu, vid_maxv;
 static int	vid_zminu, vid_zminv, vid_zmaxu, vid_zmaxv;
 static qboolean IsHighDPIaware = false;
 static qboolean is_render_flushed = false;
+#if defined(SW_AVX2)
+static qboolean sw_hasavx2 = false;
+#endif
+
+/* The frame is compared with the previous one and converted in
+   tiles, a changed HUD number doesn't convert every row between
+   it and the top of the screen. */
+#define SW_TILE_SIZE		32
+/* smaller rectangles aren't worth waking up the workers */
+#define SW_PARALLEL_COPY	(256 * 1024)
+
+static byte	*sw_dirtytiles = NULL;
+static int	sw_tileswide, sw_tileshigh;
+
+static struct
+{
+	/* rectangle that is compared and converted */
+	int		minu, maxu, minv, maxv;
+	/* every tile of the rectangle is dirty */
+	qboolean	all;
+	/* locked texture, pitch is in pixels and the
+	   first row is the row lockv of the frame */
+	Uint32		*pixels;
+	int		pitch;
+	int		lockv;
+} copyframe;
+
+#if defined(SW_NEON)
+/* sw_state.currentpalette split by color byte */
+static byte	sw_planarpalette[4][256];
+#endif
 
 // last position  on map
 static vec3_t	lastvieworg;
@@ -148,6 +193,9 @@ static cvar_t	*sw_overbrightbits;
 cvar_t	*sw_custom_particles;
 static cvar_t	*sw_anisotropic;
 cvar_t	*sw_texture_filtering;
+cvar_t	*sw_threads;
+
+int	r_numthreads = 1;
 cvar_t	*r_retexturing;
 cvar_t	*r_scale8bittextures;
 cvar_t	*sw_gunzposition;
@@ -201,20 +249,20 @@ cvar_t	*r_cull;
 // FIXME: make into one big structure, like cl or sv
 // FIXME: do separately for refresh engine and driver
 
-float	d_sdivzstepu, d_tdivzstepu;
-float	d_sdivzstepv, d_tdivzstepv;
-float	d_sdivzorigin, d_tdivzorigin;
+SW_THREADLOCAL float	d_sdivzstepu, d_tdivzstepu;
+SW_THREADLOCAL float	d_sdivzstepv, d_tdivzstepv;
+SW_THREADLOCAL float	d_sdivzorigin, d_tdivzorigin;
 
-int	sadjust, tadjust, bbextents, bbextentt;
+SW_THREADLOCAL int	sadjust, tadjust, bbextents, bbextentt;
 
-pixel_t		*cacheblock;
-int		cachewidth;
+SW_THREADLOCAL pixel_t	*cacheblock;
+SW_THREADLOCAL int	cachewidth;
 pixel_t		*d_viewbuffer;
 zvalue_t	*d_pzbuffer;
 
 static void RE_BeginFrame(float camera_separation);
 static void Draw_BuildGammaTable(void);
-static void RE_FlushFrame(int vmin, int vmax);
+static void RE_FlushFrame(void);
 static void RE_CleanFrame(void);
 static void RE_EndFrame(void);
 static void R_DrawBeam(const entity_t *e);
@@ -286,7 +334,7 @@ VID_CheckDamageZBuffer(int u, int v, int ucount, int vcount)
 }
 
 // Need to recalculate whole z buffer
-static void
+void
 VID_WholeDamageZBuffer(void)
 {
 	vid_zminu = 0;
@@ -381,6 +429,8 @@ R_RegisterVariables (void)
 	sw_overbrightbits = ri.Cvar_Get("sw_overbrightbits", "1.0", CVAR_ARCHIVE);
 	sw_custom_particles = ri.Cvar_Get("sw_custom_particles", "0", CVAR_ARCHIVE);
 	sw_texture_filtering = ri.Cvar_Get("sw_texture_filtering", "0", CVAR_ARCHIVE);
+	sw_threads = ri.Cvar_Get("sw_threads", "0", CVAR_ARCHIVE);
+	sw_threads->modified = true; /* ask for the workers again after a restart */
 	sw_anisotropic = ri.Cvar_Get("r_anisotropic", "0", CVAR_ARCHIVE);
 	r_retexturing = ri.Cvar_Get("r_retexturing", "1", CVAR_ARCHIVE);
 	r_scale8bittextures = ri.Cvar_Get("r_scale8bittextures", "0", CVAR_ARCHIVE);
@@ -425,6 +475,7 @@ R_RegisterVariables (void)
 	ri.Cmd_AddCommand("modellist", Mod_Modellist_f);
 	ri.Cmd_AddCommand("screenshot", R_ScreenShot_f);
 	ri.Cmd_AddCommand("imagelist", R_ImageList_f);
+	ri.Cmd_AddCommand("lightmapbench", RI_LightMapBench_f);
 
 	r_mode->modified = true; // force us to do mode specific stuff later
 	vid_gamma->modified = true; // force us to rebuild the gamma table later
@@ -439,6 +490,7 @@ R_UnRegister (void)
 	ri.Cmd_RemoveCommand( "screenshot" );
 	ri.Cmd_RemoveCommand( "modellist" );
 	ri.Cmd_RemoveCommand( "imagelist" );
+	ri.Cmd_RemoveCommand( "lightmapbench" );
 }
 
 static void RE_ShutdownContext(void);
@@ -475,6 +527,10 @@ RE_Init(void)
 	/* set our "safe" mode */
 	sw_state.prev_mode = 4;
 
+#if defined(SW_AVX2)
+	sw_hasavx2 = SDL_HasAVX2();
+#endif
+
 	/* create the window and set up the context */
 	if (!RE_SetMode())
 	{
@@ -505,12 +561,10 @@ RE_Shutdown (void)
 		d_pzbuffer = NULL;
 	}
 	// free surface cache
-	if (sc_base)
-	{
-		D_FlushCaches ();
-		free (sc_base);
-		sc_base = NULL;
-	}
+	D_FlushCaches ();
+
+	// leave the workers to the server
+	ri.Sys_StartWorkers(SYS_WORKERS_RENDERER, 0);
 
 	// free colormap
 	if (vid_colormap)
@@ -1317,6 +1371,36 @@ VectorCompareRound(const vec3_t v1, const vec3_t v2)
 
 cplane_t frustum[4];
 
+/*
+================
+R_SetupThreads
+
+The worker pool is shared with the server, it may
+have more workers than asked for
+================
+*/
+static void
+R_SetupThreads (void)
+{
+	if (sw_threads->modified)
+	{
+		sw_threads->modified = false;
+		ri.Sys_StartWorkers(SYS_WORKERS_RENDERER, sw_threads->value - 1);
+	}
+
+	r_numthreads = (int)sw_threads->value;
+
+	if (r_numthreads > ri.Sys_NumWorkers() + 1)
+	{
+		r_numthreads = ri.Sys_NumWorkers() + 1;
+	}
+
+	if (r_numthreads < 1)
+	{
+		r_numthreads = 1;
+	}
+}
+
 
 /*
 ================
@@ -1360,6 +1444,7 @@ RE_RenderFrame (refdef_t *fd)
 	if (r_speeds->value || r_dspeeds->value)
 		r_time1 = SDL_GetTicks();
 
+	R_SetupThreads ();
 	R_SetupFrame ();
 
 	R_SetFrustum(vup, vpn, vright, r_origin, r_newrefdef.fov_x, r_newrefdef.fov_y,
@@ -1459,12 +1544,7 @@ R_InitGraphics( int width, int height )
 	}
 
 	// free surface cache
-	if ( sc_base )
-	{
-		D_FlushCaches();
-		free(sc_base);
-		sc_base = NULL;
-	}
+	D_FlushCaches();
 
 	d_pzbuffer = malloc(width * height * sizeof(zvalue_t));
 
@@ -1889,6 +1969,12 @@ RE_InitContext(void *win)
 		renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
 	}
 
+	/* No GPU, e.g. headless. */
+	if (!renderer)
+	{
+		renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+	}
+
 	/* Select the color for drawing. It is set to black here. */
 	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
 
@@ -2011,6 +2097,12 @@ RE_ShutdownContext(void)
 	}
 	warp_column = NULL;
 
+	if (sw_dirtytiles)
+	{
+		free(sw_dirtytiles);
+	}
+	sw_dirtytiles = NULL;
+
 	if (edge_basespans)
 	{
 		free(edge_basespans);
@@ -2067,87 +2159,264 @@ RE_ShutdownContext(void)
 }
 
 /*
-be careful if you ever want to change width: 12.20 fixed
-point math used in R_ScanEdges() overflows at width 2048 !!
+fraction bits of the fixed-point u of edges and spans. 12.20 fixed
+point math used in R_ScanEdges() overflows at width 2048, so wider
+screens give up fraction bits, see R_EdgeShiftForWidth()
 */
 char shift_size;
 
+/*
+================
+R_EdgeShiftForWidth
+
+Returns the most fraction bits which still keep u of the right screen
+edge plus some slack in shift20_t: 20 up to 2045 pixels, 19 up to 4K,
+18 up to 8K. At 16 bits, about 32K pixels, the precision is still
+finer than the float math edges are clipped with.
+================
+*/
+static char
+R_EdgeShiftForWidth (int width)
+{
+	int	shift = 20;
+
+	while ((shift > 16) &&
+		((((long long)width + 2) << shift) > (long long)INT_MAX) &&
+		(sizeof(shift20_t) == 4))
+	{
+		shift--;
+	}
+
+	if ((((long long)width + 2) << shift) > (long long)INT_MAX)
+	{
+		R_Printf(PRINT_ALL, "%s: width %d is too wide for the edge pipeline\n",
+			__func__, width);
+	}
+
+	return shift;
+}
+
+#if defined(SW_AVX2)
+/*
+ * Gathers 8 palette entries at once, returns
+ * the number of pixels converted.
+ */
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+static int
+RE_ConvertSpanAVX2(Uint32 *dst, const pixel_t *src, int count,
+	const Uint32 *sdl_palette)
+{
+	int i;
+
+	for (i = 0; i + 8 <= count; i += 8)
+	{
+		__m256i index;
+
+		index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+		_mm256_storeu_si256((__m256i *)(dst + i),
+			_mm256_i32gather_epi32((const int *)sdl_palette, index, 4));
+	}
+
+	return i;
+}
+#endif
+
+/*
+ * Converts palette indices to the texture format. The SIMD
+ * paths give the same pixels as the scalar loop at the end.
+ */
 static void
-RE_CopyFrame (Uint32 * pixels, int pitch, int vmin, int vmax)
+RE_ConvertSpan(Uint32 *dst, const pixel_t *src, int count)
 {
-	Uint32 *sdl_palette = (Uint32 *)sw_state.currentpalette;
+	const Uint32 *sdl_palette = (const Uint32 *)sw_state.currentpalette;
 
-	// no gaps between images rows
-	if (pitch == vid_buffer_width)
+#if defined(SW_AVX2)
+	if (sw_hasavx2)
 	{
-		const Uint32	*max_pixels;
-		Uint32	*pixels_pos;
-		pixel_t	*buffer_pos;
+		int done = RE_ConvertSpanAVX2(dst, src, count, sdl_palette);
 
-		max_pixels = pixels + vmax;
-		buffer_pos = vid_buffer + vmin;
+		src += done;
+		dst += done;
+		count -= done;
+	}
+#endif
 
-		pixels_pos = pixels + vmin;
+#if defined(SW_SSE2)
+	/* there's no gather, but the stores are 4 pixels wide */
+	while (count >= 4)
+	{
+		_mm_storeu_si128((__m128i *)dst, _mm_set_epi32(
+			(int)sdl_palette[src[3]], (int)sdl_palette[src[2]],
+			(int)sdl_palette[src[1]], (int)sdl_palette[src[0]]));
 
-		while ( pixels_pos < max_pixels)
-		{
-			*pixels_pos = sdl_palette[*buffer_pos];
-			buffer_pos++;
-			pixels_pos++;
-		}
+		src += 4;
+		dst += 4;
+		count -= 4;
 	}
-	else
+#elif defined(SW_NEON)
+	/* look up each byte of the color in a 256 byte plane, 64 entries
+	   per table lookup; indices out of a table's range give 0 */
+	if (count >= 16)
 	{
-		int y,x, buffer_pos, ymin, ymax;
+		uint8x16x4_t planes[4][4];
+		const uint8x16_t step = vdupq_n_u8(64);
+		int c, i;
+
+		for (c = 0; c < 4; c++)
+		{
+			for (i = 0; i < 4; i++)
+			{
+				const byte *table = sw_planarpalette[c] + i * 64;
 
-		ymin = vmin / vid_buffer_width;
-		ymax = vmax / vid_buffer_width;
+				planes[c][i].val[0] = vld1q_u8(table);
+				planes[c][i].val[1] = vld1q_u8(table + 16);
+				planes[c][i].val[2] = vld1q_u8(table + 32);
+				planes[c][i].val[3] = vld1q_u8(table + 48);
+			}
+		}
 
-		buffer_pos = ymin * vid_buffer_width;
-		pixels += ymin * pitch;
-		for (y=ymin; y < ymax;  y++)
+		while (count >= 16)
 		{
-			for (x=0; x < vid_buffer_width; x ++)
+			uint8x16_t index[4];
+			uint8x16x4_t color;
+
+			index[0] = vld1q_u8(src);
+			index[1] = vsubq_u8(index[0], step);
+			index[2] = vsubq_u8(index[1], step);
+			index[3] = vsubq_u8(index[2], step);
+
+			for (c = 0; c < 4; c++)
 			{
-				pixels[x] = sdl_palette[vid_buffer[buffer_pos + x]];
+				color.val[c] = vorrq_u8(
+					vorrq_u8(vqtbl4q_u8(planes[c][0], index[0]),
+						vqtbl4q_u8(planes[c][1], index[1])),
+					vorrq_u8(vqtbl4q_u8(planes[c][2], index[2]),
+						vqtbl4q_u8(planes[c][3], index[3])));
 			}
-			pixels += pitch;
-			buffer_pos += vid_buffer_width;
+
+			/* interleaves the planes back to 4 bytes per pixel */
+			vst4q_u8((uint8_t *)dst, color);
+
+			src += 16;
+			dst += 16;
+			count -= 16;
 		}
 	}
+#endif
+
+	while (count > 0)
+	{
+		*dst = sdl_palette[*src];
+		src++;
+		dst++;
+		count--;
+	}
 }
 
-static int
-RE_BufferDifferenceStart(int vmin, int vmax)
+/*
+ * Tile row job of RE_EndFrame(), marks the tiles
+ * that differ from the previous frame.
+ */
+static void
+RE_MarkTilesJob(void *data, int index, int thread)
 {
-	int *front_buffer, *back_buffer, *back_max;
+	const pixel_t *front, *back;
+	int ty, tx, u, v, umax, vmin, vmax;
 
-	back_buffer = (int*)(swap_frames[0] + vmin);
-	front_buffer = (int*)(swap_frames[1] + vmin);
-	back_max = (int*)(swap_frames[0] + vmax);
+	ty = (copyframe.minv / SW_TILE_SIZE) + index;
 
-	while (back_buffer < back_max && *back_buffer == *front_buffer) {
-		back_buffer ++;
-		front_buffer ++;
+	vmin = Q_max(ty * SW_TILE_SIZE, copyframe.minv);
+	vmax = Q_min((ty + 1) * SW_TILE_SIZE, copyframe.maxv);
+
+	for (tx = copyframe.minu / SW_TILE_SIZE; tx * SW_TILE_SIZE < copyframe.maxu; tx++)
+	{
+		byte *dirty = &sw_dirtytiles[ty * sw_tileswide + tx];
+
+		u = Q_max(tx * SW_TILE_SIZE, copyframe.minu);
+		umax = Q_min((tx + 1) * SW_TILE_SIZE, copyframe.maxu);
+
+		back = swap_frames[0] + vmin * vid_buffer_width + u;
+		front = swap_frames[1] + vmin * vid_buffer_width + u;
+
+		*dirty = copyframe.all;
+
+		for (v = vmin; (v < vmax) && !*dirty; v++)
+		{
+			*dirty = memcmp(back, front, (umax - u) * sizeof(pixel_t)) != 0;
+
+			back += vid_buffer_width;
+			front += vid_buffer_width;
+		}
 	}
-	return (pixel_t*)back_buffer - swap_frames[0];
 }
 
-static int
-RE_BufferDifferenceEnd(int vmin, int vmax)
+/*
+ * Tile row job of RE_FlushFrame(), converts the marked tiles.
+ * Neighbouring tiles are converted as one span.
+ */
+static void
+RE_CopyTilesJob(void *data, int index, int thread)
+{
+	int ty, tx, txend, u, umax, v, vmin, vmax;
+
+	ty = (copyframe.minv / SW_TILE_SIZE) + index;
+
+	vmin = Q_max(ty * SW_TILE_SIZE, copyframe.minv);
+	vmax = Q_min((ty + 1) * SW_TILE_SIZE, copyframe.maxv);
+
+	for (tx = copyframe.minu / SW_TILE_SIZE; tx * SW_TILE_SIZE < copyframe.maxu; tx = txend)
+	{
+		txend = tx + 1;
+
+		if (!sw_dirtytiles[ty * sw_tileswide + tx])
+		{
+			continue;
+		}
+
+		while ((txend * SW_TILE_SIZE < copyframe.maxu) &&
+			sw_dirtytiles[ty * sw_tileswide + txend])
+		{
+			txend++;
+		}
+
+		u = Q_max(tx * SW_TILE_SIZE, copyframe.minu);
+		umax = Q_min(txend * SW_TILE_SIZE, copyframe.maxu);
+
+		for (v = vmin; v < vmax; v++)
+		{
+			RE_ConvertSpan(copyframe.pixels + (v - copyframe.lockv) * copyframe.pitch + u,
+				vid_buffer + v * vid_buffer_width + u, umax - u);
+		}
+	}
+}
+
+/*
+ * Runs a tile row job for every tile row of the
+ * frame rectangle, with the workers if it's big.
+ */
+static void
+RE_RunTileJob(sysjob_t job)
 {
-	int *front_buffer, *back_buffer, *back_min;
-
-	back_buffer = (int*)(swap_frames[0] + vmax);
-	front_buffer = (int*)(swap_frames[1] + vmax);
-	back_min = (int*)(swap_frames[0] + vmin);
-
-	do {
-		back_buffer --;
-		front_buffer --;
-	} while (back_buffer > back_min && *back_buffer == *front_buffer);
-	// +1 for fully cover changes
-	return (pixel_t*)back_buffer - swap_frames[0] + sizeof(int);
+	int rows, area;
+
+	rows = (copyframe.maxv - 1) / SW_TILE_SIZE - copyframe.minv / SW_TILE_SIZE + 1;
+	area = (copyframe.maxu - copyframe.minu) * (copyframe.maxv - copyframe.minv);
+
+	if ((r_numthreads > 1) && (area >= SW_PARALLEL_COPY))
+	{
+		ri.Sys_RunParallel(job, NULL, rows);
+	}
+	else
+	{
+		int i;
+
+		for (i = 0; i < rows; i++)
+		{
+			job(NULL, i, 0);
+		}
+	}
 }
 
 static void
@@ -2174,43 +2443,54 @@ RE_CleanFrame(void)
 }
 
 static void
-RE_FlushFrame(int vmin, int vmax)
+RE_FlushFrame(void)
 {
+	SDL_Rect rect;
 	int pitch;
 	Uint32 *pixels;
 
-	if (vmin > vmax)
-	{
-		/* Looks like we already updated everything */
-		return;
-	}
-
 	if (is_render_flushed)
 	{
 		Com_Printf("%s: Render is already flushed\n", __func__);
 		return;
 	}
 
-	if (SDL_LockTexture(texture, NULL, (void**)&pixels, &pitch))
+	/* only the rows with dirty tiles are uploaded */
+	rect.x = 0;
+	rect.y = copyframe.minv;
+	rect.w = vid_buffer_width;
+	rect.h = copyframe.maxv - copyframe.minv;
+
+	if (SDL_LockTexture(texture, &rect, (void**)&pixels, &pitch))
 	{
 		Com_Printf("Can't lock texture: %s\n", SDL_GetError());
 		return;
 	}
 
-	if (sw_partialrefresh->value)
-	{
-		RE_CopyFrame (pixels, pitch / sizeof(Uint32), vmin, vmax);
-	}
-	else
+	copyframe.pixels = pixels;
+	copyframe.pitch = pitch / sizeof(Uint32);
+	copyframe.lockv = copyframe.minv;
+
+#if defined(SW_NEON)
 	{
-		// On MacOS texture is cleaned up after render,
-		// code have to copy a whole screen to the texture
-		RE_CopyFrame (pixels, pitch / sizeof(Uint32), 0, vid_buffer_height * vid_buffer_width);
+		int i, c;
+
+		for (i = 0; i < 256; i++)
+		{
+			for (c = 0; c < 4; c++)
+			{
+				sw_planarpalette[c][i] = sw_state.currentpalette[i * 4 + c];
+			}
+		}
 	}
+#endif
+
+	RE_RunTileJob(RE_CopyTilesJob);
 
 	if ((sw_anisotropic->value > 0) && !fastmoving)
 	{
-		SmoothColorImage(pixels + vmin, vmax - vmin, sw_anisotropic->value);
+		SmoothColorImage(pixels, (rect.h - 1) * copyframe.pitch + rect.w,
+			sw_anisotropic->value);
 	}
 
 	SDL_UnlockTexture(texture);
@@ -2328,7 +2608,7 @@ RE_Draw_StretchDirectRaw(int x, int y, int w, int h, int cols, int rows, const b
 static void
 RE_EndFrame (void)
 {
-	int vmin, vmax;
+	int tx, ty, tumin, tumax, tvmin, tvmax;
 
 	// fix possible issue with min/max
 	if (vid_minu < 0)
@@ -2351,36 +2631,67 @@ RE_EndFrame (void)
 		vid_maxv = vid_buffer_height;
 	}
 
-	vmin = vid_minu + vid_minv  * vid_buffer_width;
-	vmax = vid_maxu + vid_maxv  * vid_buffer_width;
-
-	// fix to correct limit
-	if (vmax > (vid_buffer_height * vid_buffer_width))
+	if ((vid_minu >= vid_maxu) || (vid_minv >= vid_maxv))
 	{
-		vmax = vid_buffer_height * vid_buffer_width;
+		return;
 	}
 
+	copyframe.minu = vid_minu;
+	copyframe.maxu = vid_maxu;
+	copyframe.minv = vid_minv;
+	copyframe.maxv = vid_maxv;
+
 	// if palette changed need to flush whole buffer
-	if (!palette_changed)
-	{
-		// search real begin/end of difference
-		vmin = RE_BufferDifferenceStart(vmin, vmax);
+	copyframe.all = palette_changed;
 
-		// no differences found
-		if (vmin >= vmax)
-		{
-			return;
-		}
+	// search tiles with differences
+	RE_RunTileJob(RE_MarkTilesJob);
+
+	tumin = sw_tileswide;
+	tumax = -1;
+	tvmin = sw_tileshigh;
+	tvmax = -1;
 
-		// search difference end
-		vmax = RE_BufferDifferenceEnd(vmin, vmax);
-		if (vmax > (vid_buffer_height * vid_buffer_width))
+	for (ty = vid_minv / SW_TILE_SIZE; ty * SW_TILE_SIZE < vid_maxv; ty++)
+	{
+		for (tx = vid_minu / SW_TILE_SIZE; tx * SW_TILE_SIZE < vid_maxu; tx++)
 		{
-			vmax = vid_buffer_height * vid_buffer_width;
+			if (sw_dirtytiles[ty * sw_tileswide + tx])
+			{
+				tumin = Q_min(tumin, tx);
+				tumax = Q_max(tumax, tx);
+				tvmin = Q_min(tvmin, ty);
+				tvmax = Q_max(tvmax, ty);
+			}
 		}
 	}
 
-	RE_FlushFrame(vmin, vmax);
+	// no differences found
+	if (tvmax < 0)
+	{
+		return;
+	}
+
+	if (!sw_partialrefresh->value)
+	{
+		// On MacOS texture is cleaned up after render,
+		// code have to copy a whole screen to the texture
+		copyframe.minu = 0;
+		copyframe.maxu = vid_buffer_width;
+		copyframe.minv = 0;
+		copyframe.maxv = vid_buffer_height;
+
+		memset(sw_dirtytiles, 1, sw_tileswide * sw_tileshigh);
+	}
+	else
+	{
+		copyframe.minu = Q_max(tumin * SW_TILE_SIZE, vid_minu);
+		copyframe.maxu = Q_min((tumax + 1) * SW_TILE_SIZE, vid_maxu);
+		copyframe.minv = Q_max(tvmin * SW_TILE_SIZE, vid_minv);
+		copyframe.maxv = Q_min((tvmax + 1) * SW_TILE_SIZE, vid_maxv);
+	}
+
+	RE_FlushFrame();
 }
 
 /*
@@ -2511,6 +2822,10 @@ SWimp_CreateRender(int width, int height)
 	warp_rowptr = malloc((width+AMP2*2) * sizeof(byte*));
 	warp_column = malloc((width+AMP2*2) * sizeof(int));
 
+	sw_tileswide = (width + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+	sw_tileshigh = (height + SW_TILE_SIZE - 1) / SW_TILE_SIZE;
+	sw_dirtytiles = malloc(sw_tileswide * sw_tileshigh);
+
 	// count of "out of items"
 	r_outofsurfaces = false;
 	r_outofedges = false;
@@ -2537,15 +2852,7 @@ SWimp_CreateRender(int width, int height)
 
 	r_warpbuffer = malloc(height * width * sizeof(pixel_t));
 
-	// 2k+ resolution and 32 == shift20_t
-	if ((width >= 2048) && (sizeof(shift20_t) == 4))
-	{
-		shift_size = 18;
-	}
-	else
-	{
-		shift_size = 20;
-	}
+	shift_size = R_EdgeShiftForWidth (width);
 
 	R_InitTurb (width);
 
@@ -117,6 +117,8 @@ R_PrintDSpeeds (void)
 
 	R_Printf(PRINT_ALL,"%3i %2ip %2iw %2ib %2is %2ie %2ia\n",
 				ms, dp_time, rw_time, db_time, se_time, de_time, da_time);
+
+	D_PrintCacheStats ();
 }
 
 
@@ -325,6 +327,7 @@ R_SetupFrame (void)
 	}
 
 	r_framecount++;
+	memset(&sc_stats, 0, sizeof(sc_stats));
 
 
 	// build the transformation matrix for the given view angles
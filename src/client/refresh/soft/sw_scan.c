@@ -29,6 +29,42 @@
 byte	**warp_rowptr;
 int	*warp_column;
 
+/*
+=============
+D_WarpBand
+
+Warps one of r_numthreads bands of rows
+=============
+*/
+static void
+D_WarpBand (void *data, int band, int thread)
+{
+	const int	*turb = data;
+	int	w, h, u, v, v1;
+	pixel_t	*dest;
+	byte	**row;
+
+	w = r_newrefdef.width;
+	h = r_newrefdef.height;
+
+	v = h * band / r_numthreads;
+	v1 = h * (band + 1) / r_numthreads;
+
+	dest = vid_buffer + (r_newrefdef.y + v) * vid_buffer_width + r_newrefdef.x;
+
+	for ( ; v<v1 ; v++, dest += vid_buffer_width)
+	{
+		int *col;
+
+		col = warp_column + turb[v];
+		row = warp_rowptr + v;
+		for (u=0 ; u<w ; u++)
+		{
+			dest[u] = row[turb[u]][col[u]];
+		}
+	}
+}
+
 /*
 =============
 D_WarpScreen
@@ -42,9 +78,7 @@ D_WarpScreen (void)
 {
 	int	w, h;
 	int	u,v;
-	pixel_t	*dest;
 	int	*turb;
-	byte	**row;
 
 	static int	cached_width, cached_height;
 
@@ -75,19 +109,9 @@ D_WarpScreen (void)
 	}
 
 	turb = intsintable + ((int)(r_newrefdef.time*SPEED)&(CYCLE-1));
-	dest = vid_buffer + r_newrefdef.y * vid_buffer_width + r_newrefdef.x;
 
-	for (v=0 ; v<h ; v++, dest += vid_buffer_width)
-	{
-		int *col;
-
-		col = warp_column + turb[v];
-		row = warp_rowptr + v;
-		for (u=0 ; u<w ; u++)
-		{
-			dest[u] = row[turb[u]][col[u]];
-		}
-	}
+	// rows are independent, with sw_threads bands of them are warped in parallel
+	ri.Sys_RunParallel (D_WarpBand, turb, r_numthreads);
 }
 
 
@@ -21,6 +21,8 @@
 
 // sw_surf.c: surface-related refresh code
 
+#include <stddef.h>
+
 #include "header/local.h"
 
 static int		sourcetstep;
@@ -34,9 +36,17 @@ static unsigned		*r_lightptr;
 
 void RI_BuildLightMap(drawsurf_t *drawsurf);
 
-static int	sc_size;
-static surfcache_t	*sc_rover;
-surfcache_t	*sc_base;
+/* the surface cache never shrinks below the size for the resolution,
+   but grows up to SC_MAXGROWTH times that when a single frame needs
+   more surfaces than fit */
+#define SC_MAXGROWTH	4
+
+static int	sc_size;	/* current limit in bytes */
+static int	sc_basesize;	/* limit for the resolution */
+static int	sc_used;	/* bytes allocated, including headers */
+static surfcache_t	sc_lru;	/* next is the most, prev the least recently used */
+
+sccachestats_t	sc_stats;
 
 /*
  * Color light apply is not required
@@ -264,6 +274,8 @@ R_InitCaches (void)
 	// calculate size to allocate
 	int pix;
 
+	D_FlushCaches ();
+
 	// surface cache size at 320X240
 	size = 1024*768;
 
@@ -289,18 +301,56 @@ R_InitCaches (void)
 	R_Printf(PRINT_ALL,"%ik surface cache.\n", size/1024);
 
 	sc_size = size;
-	sc_base = (surfcache_t *)malloc(size);
-	if (!sc_base)
+	sc_basesize = size;
+}
+
+static void
+D_SCUnlink (surfcache_t *cache)
+{
+	cache->prev->next = cache->next;
+	cache->next->prev = cache->prev;
+}
+
+static void
+D_SCLinkFirst (surfcache_t *cache)
+{
+	cache->next = sc_lru.next;
+	cache->prev = &sc_lru;
+	sc_lru.next->prev = cache;
+	sc_lru.next = cache;
+}
+
+/*
+=================
+D_SCTouch
+
+Moves the cache to the most recently used end
+=================
+*/
+static void
+D_SCTouch (surfcache_t *cache)
+{
+	if (sc_lru.next != cache)
 	{
-		Com_Error(ERR_FATAL, "%s: Can't allocate cache.", __func__);
-		/* code never returns after ERR_FATAL */
-		return;
+		D_SCUnlink (cache);
+		D_SCLinkFirst (cache);
 	}
-	sc_rover = sc_base;
 
-	sc_base->next = NULL;
-	sc_base->owner = NULL;
-	sc_base->size = sc_size;
+	cache->frame = r_framecount;
+}
+
+static void
+D_SCFree (surfcache_t *cache)
+{
+	D_SCUnlink (cache);
+
+	if (cache->owner)
+	{
+		*cache->owner = NULL;
+	}
+
+	sc_used -= cache->size;
+	free (cache);
 }
 
 /*
@@ -311,21 +361,18 @@ D_FlushCaches
 void
 D_FlushCaches (void)
 {
-	surfcache_t     *c;
-
-	if (!sc_base)
-		return;
+	if (!sc_lru.next)
+	{
+		sc_lru.next = &sc_lru;
+		sc_lru.prev = &sc_lru;
+	}
 
-	for (c = sc_base ; c ; c = c->next)
+	while (sc_lru.next != &sc_lru)
 	{
-		if (c->owner)
-			*c->owner = NULL;
+		D_SCFree (sc_lru.next);
 	}
 
-	sc_rover = sc_base;
-	sc_base->next = NULL;
-	sc_base->owner = NULL;
-	sc_base->size = sc_size;
+	sc_size = sc_basesize;
 }
 
 /*
@@ -338,85 +385,83 @@ D_SCAlloc(int width, int size)
 {
 	surfcache_t	*new;
 
-	if ((width < 0) || (width > 256))
+	if (width < 0)
 	{
 		Com_Error(ERR_FATAL, "%s: bad cache width %d\n", __func__, width);
 	}
 
-	if ((size <= 0) || (size > 0x10000))
+	if (size <= 0)
 	{
 		Com_Error(ERR_FATAL, "%s: bad cache size %d\n", __func__, size);
 	}
 
 	/* Add header size */
-	size += ((char*)sc_base->data - (char*)sc_base);
+	size += offsetof(surfcache_t, data);
 	size = (size + 3) & ~3;
-	if (size > sc_size)
-	{
-		Com_Error(ERR_FATAL, "%s: %i > cache size of %i", __func__, size, sc_size);
-	}
-
-	/* if there is not size bytes after the rover, reset to the start */
-	if ( !sc_rover || (byte *)sc_rover - (byte *)sc_base > sc_size - size)
-	{
-		sc_rover = sc_base;
-	}
 
-	/* colect and free surfcache_t blocks until the rover block is large enough */
-	new = sc_rover;
-	if (sc_rover->owner)
+	/* free the least recently used surfaces until the new one fits */
+	while ((sc_used + size > sc_size) && (sc_lru.prev != &sc_lru))
 	{
-		*sc_rover->owner = NULL;
-	}
-
-	while (new->size < size)
-	{
-		/* free another */
-		sc_rover = sc_rover->next;
-
-		if (!sc_rover)
+		if ((sc_lru.prev->frame == r_framecount) &&
+			(sc_size < sc_basesize * SC_MAXGROWTH))
 		{
-			Com_Error(ERR_FATAL, "%s: hit the end of memory", __func__);
-		}
+			/* everything is visible in this frame,
+			   evicting would draw surfaces twice */
+			sc_size = Q_min(sc_size * 2, sc_basesize * SC_MAXGROWTH);
+			sc_stats.grown++;
 
-		if (sc_rover->owner)
-		{
-			*sc_rover->owner = NULL;
+			R_Printf(PRINT_DEVELOPER, "%s: grew to %ik\n", __func__, sc_size / 1024);
+			continue;
 		}
 
-		new->size += sc_rover->size;
-		new->next = sc_rover->next;
+		D_SCFree (sc_lru.prev);
+		sc_stats.evicted++;
 	}
 
-	// create a fragment out of any leftovers
-	if (new->size - size > 256)
-	{
-		sc_rover = (surfcache_t *)( (byte *)new + size);
-		sc_rover->size = new->size - size;
-		sc_rover->next = new->next;
-		sc_rover->width = 0;
-		sc_rover->owner = NULL;
-		new->next = sc_rover;
-		new->size = size;
-	}
-	else
+	new = malloc(size);
+	if (!new)
 	{
-		sc_rover = new->next;
+		Com_Error(ERR_FATAL, "%s: Can't allocate %i bytes", __func__, size);
+		/* code never returns after ERR_FATAL */
+		return NULL;
 	}
 
+	memset(new, 0, offsetof(surfcache_t, data));
+
+	new->size = size;
 	new->width = width;
 
 	// DEBUG
 	if (width > 0)
 	{
-		new->height = (size - sizeof(*new) + sizeof(new->data)) / width;
+		new->height = (size - offsetof(surfcache_t, data)) / width;
 	}
 
 	new->owner = NULL; // should be set properly after return
 
+	new->frame = r_framecount;
+	D_SCLinkFirst (new);
+
+	sc_used += size;
+
 	return new;
 }
 
+/*
+=================
+D_PrintCacheStats
+
+Surface cache statistics of the frame, for r_dspeeds
+=================
+*/
+void
+D_PrintCacheStats (void)
+{
+	R_Printf(PRINT_ALL, "%4i hit %3i built %3i new %3i evicted %ik/%ik cache%s\n",
+		sc_stats.hits, sc_stats.built, sc_stats.allocated, sc_stats.evicted,
+		sc_used / 1024, sc_size / 1024, sc_stats.grown ? " grown" : "");
+}
+
 //=============================================================================
 
 static drawsurf_t	r_drawsurf;
@@ -452,7 +497,11 @@ D_CacheSurface(const entity_t *currententity, msurface_t *surface, int miplevel)
 			&& cache->lightadj[1] == r_drawsurf.lightadj[1]
 			&& cache->lightadj[2] == r_drawsurf.lightadj[2]
 			&& cache->lightadj[3] == r_drawsurf.lightadj[3] )
+	{
+		D_SCTouch (cache);
+		sc_stats.hits++;
 		return cache;
+	}
 
 	//
 	// determine shape of surface
@@ -473,7 +522,14 @@ D_CacheSurface(const entity_t *currententity, msurface_t *surface, int miplevel)
 		surface->cachespots[miplevel] = cache;
 		cache->owner = &surface->cachespots[miplevel];
 		cache->mipscale = surfscale;
+		sc_stats.allocated++;
 	}
+	else
+	{
+		D_SCTouch (cache);
+	}
+
+	sc_stats.built++;
 
 	if (surface->dlightframe == r_framecount)
 		cache->dlight = 1;
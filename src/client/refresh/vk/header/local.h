@@ -229,6 +229,7 @@ void	Vk_ImageList_f (void);
 void LM_BuildPolygonFromSurface(model_t *currentmodel, msurface_t *fa);
 void LM_CreateSurfaceLightmap (msurface_t *surf);
 void LM_EndBuildingLightmaps (void);
+void LM_Bench_f (void);
 void LM_BeginBuildingLightmaps (model_t *m);
 
 void	Vk_InitImages (void);
@@ -299,3 +299,48 @@ LM_EndBuildingLightmaps(void)
 	LM_UploadBlock();
 }
 
+
+/*
+ * Lightmap of a surface for R_BenchLightMaps()
+ */
+static int
+LM_BenchBuildLightmap(msurface_t *surf, byte *dest)
+{
+	int smax, tmax;
+
+	smax = (surf->extents[0] >> surf->lmshift) + 1;
+	tmax = (surf->extents[1] >> surf->lmshift) + 1;
+
+	R_BuildLightMap(surf, dest, smax * LIGHTMAP_BYTES,
+		dest + smax * tmax * LIGHTMAP_BYTES,
+		&r_newrefdef, r_modulate->value, r_framecount);
+
+	return smax * tmax * LIGHTMAP_BYTES;
+}
+
+/*
+ * lightmapbench [runs]
+ */
+void
+LM_Bench_f(void)
+{
+	int runs;
+
+	if (ri.Cmd_Argc() > 2)
+	{
+		R_Printf(PRINT_ALL, "Usage: lightmapbench [runs]\n");
+		return;
+	}
+
+	if (!r_worldmodel || !r_newrefdef.lightstyles)
+	{
+		R_Printf(PRINT_ALL, "No map loaded.\n");
+		return;
+	}
+
+	runs = (ri.Cmd_Argc() == 2) ? atoi(ri.Cmd_Argv(1)) : 10;
+	runs = (runs < 1) ? 1 : runs;
+
+	R_BenchLightMaps(r_worldmodel->surfaces, r_worldmodel->numsurfaces, runs,
+		LM_BenchBuildLightmap, ri.Sys_Microseconds);
+}
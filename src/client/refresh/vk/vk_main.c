@@ -559,8 +559,9 @@ R_DrawParticles(void)
 		particleUbo.att_c = vk_particle_att_c->value;
 
 		static ppoint visibleParticles[MAX_PARTICLES];
+		int num_particles = Q_min(r_newrefdef.num_particles, MAX_PARTICLES);
 
-		for (i = 0, p = r_newrefdef.particles; i < r_newrefdef.num_particles; i++, p++)
+		for (i = 0, p = r_newrefdef.particles; i < num_particles; i++, p++)
 		{
 			*(int *)color = d_8to24table[p->color];
 
@@ -583,13 +584,13 @@ R_DrawParticles(void)
 		VkDeviceSize vboOffset;
 		uint32_t uboOffset;
 		VkDescriptorSet uboDescriptorSet;
-		uint8_t *vertData = QVk_GetVertexBuffer(sizeof(ppoint) * r_newrefdef.num_particles, &vbo, &vboOffset);
+		uint8_t *vertData = QVk_GetVertexBuffer(sizeof(ppoint) * num_particles, &vbo, &vboOffset);
 		uint8_t *uboData  = QVk_GetUniformBuffer(sizeof(particleUbo), &uboOffset, &uboDescriptorSet);
-		memcpy(vertData, &visibleParticles, sizeof(ppoint) * r_newrefdef.num_particles);
+		memcpy(vertData, &visibleParticles, sizeof(ppoint) * num_particles);
 		memcpy(uboData,  &particleUbo, sizeof(particleUbo));
 		vkCmdBindDescriptorSets(vk_activeCmdbuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vk_drawPointParticlesPipeline.layout, 0, 1, &uboDescriptorSet, 1, &uboOffset);
 		vkCmdBindVertexBuffers(vk_activeCmdbuffer, 0, 1, &vbo, &vboOffset);
-		vkCmdDraw(vk_activeCmdbuffer, r_newrefdef.num_particles, 1, 0, 0);
+		vkCmdDraw(vk_activeCmdbuffer, num_particles, 1, 0, 0);
 	}
 	else
 	{
@@ -1204,6 +1205,7 @@ R_Register(void)
 	ri.Cmd_AddCommand("imagelist", Vk_ImageList_f);
 	ri.Cmd_AddCommand("screenshot", Vk_ScreenShot_f);
 	ri.Cmd_AddCommand("modellist", Mod_Modellist_f);
+	ri.Cmd_AddCommand("lightmapbench", LM_Bench_f);
 }
 
 /*
@@ -1349,6 +1351,7 @@ RE_Shutdown(void)
 	ri.Cmd_RemoveCommand("imagelist");
 	ri.Cmd_RemoveCommand("vk_strings");
 	ri.Cmd_RemoveCommand("vk_mem");
+	ri.Cmd_RemoveCommand("lightmapbench");
 
 	QVk_WaitAndShutdownAll();
 
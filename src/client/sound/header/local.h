@@ -131,6 +131,8 @@ typedef struct
 	int master_vol;             /* 0-255 master volume */
 	qboolean fixed_origin;      /* use origin instead of fetching entnum's origin */
 	qboolean autosound;         /* from an entity->sound, cleared each frame */
+	int spatialserial;          /* listener the volumes were computed for (SDL) */
+	vec3_t spatialorigin;       /* origin the volumes were computed for (SDL) */
 #if USE_OPENAL
 	int autoframe;
 	float oal_vol;
@@ -40,11 +40,22 @@
 #include "../../client/header/client.h"
 #include "../../client/sound/header/local.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SDL_MIX_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SDL_MIX_NEON
+#endif
+
 /* Defines */
 #define SDL_PAINTBUFFER_SIZE 2048
 #define SDL_FULLVOLUME 80
 #define SDL_LOOPATTENUATE 0.003
 
+/* channels summed per pass over the paintbuffer */
+#define SDL_MIX_PER_PASS 4
+
 /* Globals */
 static cvar_t *s_sdldriver;
 static int *snd_p;
@@ -57,6 +68,35 @@ static int snd_inited = 0;
 static int snd_scaletable[32][256];
 static int snd_vol;
 static int soundtime;
+static cvar_t *s_simd;
+
+/* Bumped whenever the listener moves, channels
+   spatialized against an older serial must be
+   recomputed. 0 is never used, so cleared
+   channels are always spatialized. */
+static int listener_serial = 1;
+static vec3_t listener_lastorigin;
+static vec3_t listener_lastright;
+static connstate_t listener_laststate;
+
+/* A part of a channel waiting to be mixed
+   by the SIMD kernels. For 16 bit samples
+   the volume is leftvol * snd_vol and the
+   product is shifted down by 8. For 8 bit
+   samples it's the step of snd_scaletable
+   and nothing is shifted. */
+typedef struct
+{
+	const void *data;
+	int width;
+	int leftvol;
+	int rightvol;
+	int offset;
+	int count;
+} mixsegment_t;
+
+static mixsegment_t mixsegments[MAX_CHANNELS * 4];
+static int num_mixsegments;
 
 /* ------------------------------------------------------------------ */
 
@@ -395,6 +435,330 @@ SDL_PaintChannelFrom16(channel_t *ch, sfxcache_t *sc, int count, int offset)
 	ch->pos += count;
 }
 
+/*
+ * Queues a part of a channel for the
+ * SIMD kernels. The channel is advanced
+ * as if it had been painted. Returns
+ * false if the part must be painted by
+ * SDL_PaintChannelFrom8/16 instead.
+ */
+static qboolean
+SDL_QueueChannel(channel_t *ch, sfxcache_t *sc, int count, int offset)
+{
+#if defined(SDL_MIX_SSE2) || defined(SDL_MIX_NEON)
+	mixsegment_t *seg;
+	int leftvol, rightvol;
+
+	if (!s_simd->value ||
+		(num_mixsegments == sizeof(mixsegments) / sizeof(mixsegments[0])))
+	{
+		return false;
+	}
+
+	if (sc->width == 1)
+	{
+		if (ch->leftvol > 255)
+		{
+			ch->leftvol = 255;
+		}
+
+		if (ch->rightvol > 255)
+		{
+			ch->rightvol = 255;
+		}
+
+		/* snd_scaletable[i][j] is j times the step */
+		leftvol = snd_scaletable[ch->leftvol >> 3][1];
+		rightvol = snd_scaletable[ch->rightvol >> 3][1];
+	}
+	else
+	{
+		leftvol = ch->leftvol * snd_vol;
+		rightvol = ch->rightvol * snd_vol;
+	}
+
+#if defined(SDL_MIX_SSE2)
+	/* SSE2 has only 16 bit multiplications */
+	if ((leftvol < 0) || (leftvol > 0xffff) ||
+		(rightvol < 0) || (rightvol > 0xffff))
+	{
+		return false;
+	}
+#endif
+
+	seg = &mixsegments[num_mixsegments++];
+
+	if (sc->width == 1)
+	{
+		seg->data = sc->data + ch->pos;
+	}
+	else
+	{
+		seg->data = (signed short *)sc->data + ch->pos;
+	}
+
+	seg->width = sc->width;
+	seg->leftvol = leftvol;
+	seg->rightvol = rightvol;
+	seg->offset = offset;
+	seg->count = count;
+
+	ch->pos += count;
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+#if defined(SDL_MIX_SSE2) || defined(SDL_MIX_NEON)
+/*
+ * Sums the samples i to count - 1 of
+ * a segment into the paintbuffer, the
+ * same way as SDL_PaintChannelFrom8/16.
+ */
+static void
+SDL_MixSegmentTail(const mixsegment_t *seg, int i, int offset, int count)
+{
+	portable_samplepair_t *samp = &paintbuffer[offset + i];
+
+	for ( ; i < count; i++, samp++)
+	{
+		int data;
+
+		if (seg->width == 1)
+		{
+			data = ((const unsigned char *)seg->data)[i];
+			data = (data < 128) ? data : data - 0xff;
+			samp->left += data * seg->leftvol;
+			samp->right += data * seg->rightvol;
+		}
+		else
+		{
+			data = ((const signed short *)seg->data)[i];
+			samp->left += (data * seg->leftvol) >> 8;
+			samp->right += (data * seg->rightvol) >> 8;
+		}
+	}
+}
+
+/*
+ * Mixes up to SDL_MIX_PER_PASS segments
+ * with the same offset and count into
+ * the paintbuffer, 8 samples at a time.
+ * The sums are kept in registers, so the
+ * paintbuffer is read and written once
+ * per pass instead of once per channel.
+ * All operations are integer, the result
+ * is bit identical to the scalar code.
+ */
+static void
+SDL_MixSegments(const mixsegment_t **segs, int numsegs, int offset, int count)
+{
+	int *out = (int *)&paintbuffer[offset];
+	int i, j;
+
+#if defined(SDL_MIX_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c127 = _mm_set1_epi16(127);
+	const __m128i c255 = _mm_set1_epi16(0xff);
+
+	for (i = 0; i + 8 <= count; i += 8, out += 16)
+	{
+		__m128i l0 = zero, l1 = zero, r0 = zero, r1 = zero;
+
+		for (j = 0; j < numsegs; j++)
+		{
+			const mixsegment_t *seg = segs[j];
+			__m128i s, v, lo, hi;
+
+			if (seg->width == 1)
+			{
+				/* same mapping as snd_scaletable,
+				   128..255 become j - 0xff */
+				s = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)
+						((const unsigned char *)seg->data + i)), zero);
+				s = _mm_sub_epi16(s, _mm_and_si128(_mm_cmpgt_epi16(s, c127), c255));
+			}
+			else
+			{
+				s = _mm_loadu_si128((const __m128i *)((const signed short *)seg->data + i));
+			}
+
+			/* 16x16 -> 32 bit products. A volume above 0x7fff
+			   is negative to mulhi, which lowers the high half
+			   by the sample. Add it back. */
+			v = _mm_set1_epi16((short)seg->leftvol);
+			lo = _mm_mullo_epi16(s, v);
+			hi = _mm_mulhi_epi16(s, v);
+
+			if (seg->leftvol > 0x7fff)
+			{
+				hi = _mm_add_epi16(hi, s);
+			}
+
+			v = _mm_unpacklo_epi16(lo, hi);
+			hi = _mm_unpackhi_epi16(lo, hi);
+			lo = v;
+
+			if (seg->width != 1)
+			{
+				lo = _mm_srai_epi32(lo, 8);
+				hi = _mm_srai_epi32(hi, 8);
+			}
+
+			l0 = _mm_add_epi32(l0, lo);
+			l1 = _mm_add_epi32(l1, hi);
+
+			v = _mm_set1_epi16((short)seg->rightvol);
+			lo = _mm_mullo_epi16(s, v);
+			hi = _mm_mulhi_epi16(s, v);
+
+			if (seg->rightvol > 0x7fff)
+			{
+				hi = _mm_add_epi16(hi, s);
+			}
+
+			v = _mm_unpacklo_epi16(lo, hi);
+			hi = _mm_unpackhi_epi16(lo, hi);
+			lo = v;
+
+			if (seg->width != 1)
+			{
+				lo = _mm_srai_epi32(lo, 8);
+				hi = _mm_srai_epi32(hi, 8);
+			}
+
+			r0 = _mm_add_epi32(r0, lo);
+			r1 = _mm_add_epi32(r1, hi);
+		}
+
+		/* back to left/right pairs */
+		_mm_storeu_si128((__m128i *)out, _mm_add_epi32(
+				_mm_loadu_si128((const __m128i *)out), _mm_unpacklo_epi32(l0, r0)));
+		_mm_storeu_si128((__m128i *)(out + 4), _mm_add_epi32(
+				_mm_loadu_si128((const __m128i *)(out + 4)), _mm_unpackhi_epi32(l0, r0)));
+		_mm_storeu_si128((__m128i *)(out + 8), _mm_add_epi32(
+				_mm_loadu_si128((const __m128i *)(out + 8)), _mm_unpacklo_epi32(l1, r1)));
+		_mm_storeu_si128((__m128i *)(out + 12), _mm_add_epi32(
+				_mm_loadu_si128((const __m128i *)(out + 12)), _mm_unpackhi_epi32(l1, r1)));
+	}
+#else
+	const uint16x8_t c127 = vdupq_n_u16(127);
+	const uint16x8_t c255 = vdupq_n_u16(0xff);
+
+	for (i = 0; i + 8 <= count; i += 8, out += 16)
+	{
+		int32x4_t l0 = vdupq_n_s32(0), l1 = l0, r0 = l0, r1 = l0;
+		int32x4x2_t p;
+
+		for (j = 0; j < numsegs; j++)
+		{
+			const mixsegment_t *seg = segs[j];
+			int32x4_t lo, hi, a, b;
+			int16x8_t s;
+
+			if (seg->width == 1)
+			{
+				/* same mapping as snd_scaletable,
+				   128..255 become j - 0xff */
+				uint16x8_t u = vmovl_u8(vld1_u8((const unsigned char *)seg->data + i));
+				u = vsubq_u16(u, vandq_u16(vcgtq_u16(u, c127), c255));
+				s = vreinterpretq_s16_u16(u);
+			}
+			else
+			{
+				s = vld1q_s16((const signed short *)seg->data + i);
+			}
+
+			lo = vmovl_s16(vget_low_s16(s));
+			hi = vmovl_s16(vget_high_s16(s));
+
+			a = vmulq_n_s32(lo, seg->leftvol);
+			b = vmulq_n_s32(hi, seg->leftvol);
+
+			if (seg->width != 1)
+			{
+				a = vshrq_n_s32(a, 8);
+				b = vshrq_n_s32(b, 8);
+			}
+
+			l0 = vaddq_s32(l0, a);
+			l1 = vaddq_s32(l1, b);
+
+			a = vmulq_n_s32(lo, seg->rightvol);
+			b = vmulq_n_s32(hi, seg->rightvol);
+
+			if (seg->width != 1)
+			{
+				a = vshrq_n_s32(a, 8);
+				b = vshrq_n_s32(b, 8);
+			}
+
+			r0 = vaddq_s32(r0, a);
+			r1 = vaddq_s32(r1, b);
+		}
+
+		/* back to left/right pairs */
+		p = vzipq_s32(l0, r0);
+		vst1q_s32(out, vaddq_s32(vld1q_s32(out), p.val[0]));
+		vst1q_s32(out + 4, vaddq_s32(vld1q_s32(out + 4), p.val[1]));
+		p = vzipq_s32(l1, r1);
+		vst1q_s32(out + 8, vaddq_s32(vld1q_s32(out + 8), p.val[0]));
+		vst1q_s32(out + 12, vaddq_s32(vld1q_s32(out + 12), p.val[1]));
+	}
+#endif
+
+	for (j = 0; j < numsegs; j++)
+	{
+		SDL_MixSegmentTail(segs[j], i, offset, count);
+	}
+}
+#endif
+
+/*
+ * Mixes all queued segments. Segments
+ * spanning the whole paint are mixed
+ * SDL_MIX_PER_PASS at a time, the rest
+ * one by one.
+ */
+static void
+SDL_MixQueued(int count)
+{
+#if defined(SDL_MIX_SSE2) || defined(SDL_MIX_NEON)
+	const mixsegment_t *pass[SDL_MIX_PER_PASS];
+	int i, numpass;
+
+	numpass = 0;
+
+	for (i = 0; i < num_mixsegments; i++)
+	{
+		const mixsegment_t *seg = &mixsegments[i];
+
+		if ((seg->offset != 0) || (seg->count != count))
+		{
+			SDL_MixSegments(&seg, 1, seg->offset, seg->count);
+			continue;
+		}
+
+		pass[numpass++] = seg;
+
+		if (numpass == SDL_MIX_PER_PASS)
+		{
+			SDL_MixSegments(pass, numpass, 0, count);
+			numpass = 0;
+		}
+	}
+
+	if (numpass)
+	{
+		SDL_MixSegments(pass, numpass, 0, count);
+	}
+#endif
+
+	num_mixsegments = 0;
+}
+
 /*
  * Mixes all pending sounds into
  * the available output channels.
@@ -485,13 +849,16 @@ SDL_PaintChannels(int endtime)
 
 				if (count > 0)
 				{
-					if (sc->width == 1)
+					if (!SDL_QueueChannel(ch, sc, count, ltime - paintedtime))
 					{
-						SDL_PaintChannelFrom8(ch, sc, count, ltime - paintedtime);
-					}
-					else
-					{
-						SDL_PaintChannelFrom16(ch, sc, count, ltime - paintedtime);
+						if (sc->width == 1)
+						{
+							SDL_PaintChannelFrom8(ch, sc, count, ltime - paintedtime);
+						}
+						else
+						{
+							SDL_PaintChannelFrom16(ch, sc, count, ltime - paintedtime);
+						}
 					}
 
 					ltime += count;
@@ -520,6 +887,8 @@ SDL_PaintChannels(int endtime)
 			}
 		}
 
+		SDL_MixQueued(end - paintedtime);
+
 		if (lpf_is_enabled && snd_is_underwater)
 		{
 			lpf_update_samples(&lpf_context, end - paintedtime, paintbuffer);
@@ -667,7 +1036,17 @@ SDL_Spatialize(channel_t *ch)
 		CL_GetEntitySoundOrigin(ch->entnum, origin);
 	}
 
+	/* Nothing moved since the last time */
+	if ((ch->spatialserial == listener_serial) &&
+		VectorCompare(origin, ch->spatialorigin))
+	{
+		return;
+	}
+
 	SDL_SpatializeOrigin(origin, (float)ch->master_vol, ch->dist_mult, &ch->leftvol, &ch->rightvol);
+
+	ch->spatialserial = listener_serial;
+	VectorCopy(origin, ch->spatialorigin);
 }
 
 /*
@@ -1129,6 +1508,22 @@ SDL_Update(void)
 		SDL_UpdateScaletable();
 	}
 
+	/* channels spatialized for another
+	   listener position are outdated */
+	if (!VectorCompare(listener_origin, listener_lastorigin) ||
+		!VectorCompare(listener_right, listener_lastright) ||
+		(cls.state != listener_laststate))
+	{
+		VectorCopy(listener_origin, listener_lastorigin);
+		VectorCopy(listener_right, listener_lastright);
+		listener_laststate = cls.state;
+
+		if (++listener_serial == 0)
+		{
+			listener_serial = 1;
+		}
+	}
+
 	/* update spatialization
 	   for dynamic sounds */
 	ch = channels;
@@ -1226,6 +1621,320 @@ SDL_Update(void)
 
 /* ------------------------------------------------------------------ */
 
+/* s_mixbench scene */
+#define SDL_MIXBENCH_SFX 4
+
+static const struct
+{
+	int width;
+	int length;
+	int loopstart;
+} mixbench_sfx[SDL_MIXBENCH_SFX] = {
+	{2, 11025, 0},
+	{2, 3001, -1},
+	{1, 7919, 1000},
+	{1, 513, -1}
+};
+
+static sfx_t mixbench_known[SDL_MIXBENCH_SFX];
+static unsigned int mixbench_seed;
+
+/*
+ * Pseudo random numbers for the s_mixbench
+ * scene, integer only so that every build
+ * renders the same scene.
+ */
+static int
+SDL_MixBenchRand(void)
+{
+	mixbench_seed = mixbench_seed * 1103515245 + 12345;
+
+	return (mixbench_seed >> 16) & 0x7fff;
+}
+
+/*
+ * Creates the effects of the s_mixbench
+ * scene: a triangle wave with some noise.
+ */
+static void
+SDL_MixBenchCreateSfx(void)
+{
+	int i, j;
+
+	mixbench_seed = 1;
+
+	for (i = 0; i < SDL_MIXBENCH_SFX; i++)
+	{
+		sfx_t *sfx = &mixbench_known[i];
+		sfxcache_t *sc;
+
+		sc = Z_Malloc(sizeof(*sc) + mixbench_sfx[i].length * mixbench_sfx[i].width);
+		sc->length = mixbench_sfx[i].length;
+		sc->loopstart = mixbench_sfx[i].loopstart;
+		sc->speed = sound.speed;
+		sc->width = mixbench_sfx[i].width;
+
+		for (j = 0; j < sc->length; j++)
+		{
+			int period = 50 + i * 37;
+			int phase = j % period;
+			int val;
+
+			val = ((phase < period / 2) ? phase : period - phase) * 65535 / period - 16384;
+			val += SDL_MixBenchRand() / 4 - 4096;
+
+			if (sc->width == 1)
+			{
+				sc->data[j] = (val >> 8) & 0xff;
+			}
+			else
+			{
+				((signed short *)sc->data)[j] = val;
+			}
+		}
+
+		Com_sprintf(sfx->name, sizeof(sfx->name), "mixbench%i", i);
+		sfx->cache = sc;
+	}
+}
+
+static void
+SDL_MixBenchFreeSfx(void)
+{
+	int i;
+
+	for (i = 0; i < SDL_MIXBENCH_SFX; i++)
+	{
+		Z_Free(mixbench_known[i].cache);
+		memset(&mixbench_known[i], 0, sizeof(mixbench_known[i]));
+	}
+}
+
+/*
+ * (Re)starts all stopped channels of the
+ * s_mixbench scene with a random effect,
+ * volume and start position.
+ */
+static void
+SDL_MixBenchArm(void)
+{
+	int i;
+
+	for (i = 0; i < s_numchannels; i++)
+	{
+		channel_t *ch = &channels[i];
+		sfxcache_t *sc;
+
+		if (ch->sfx)
+		{
+			continue;
+		}
+
+		memset(ch, 0, sizeof(*ch));
+		ch->sfx = &mixbench_known[SDL_MixBenchRand() % SDL_MIXBENCH_SFX];
+		ch->leftvol = SDL_MixBenchRand() & 0xff;
+		ch->rightvol = SDL_MixBenchRand() & 0xff;
+
+		sc = ch->sfx->cache;
+		ch->pos = SDL_MixBenchRand() % sc->length;
+		ch->end = paintedtime + sc->length - ch->pos;
+	}
+}
+
+/*
+ * Writes a mixed buffer as WAV file.
+ */
+static qboolean
+SDL_MixBenchWrite(const char *name, byte *data, int size)
+{
+	byte header[44];
+	FILE *f;
+	int i;
+
+	if ((f = Q_fopen(name, "wb")) == NULL)
+	{
+		return false;
+	}
+
+	memcpy(header, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0", 22);
+	header[22] = sound.channels;
+	header[23] = 0;
+
+	for (i = 0; i < 4; i++)
+	{
+		header[4 + i] = ((36 + size) >> (i * 8)) & 0xff;
+		header[24 + i] = (sound.speed >> (i * 8)) & 0xff;
+		header[28 + i] = ((sound.speed * sound.channels * sound.samplebits / 8) >> (i * 8)) & 0xff;
+		header[40 + i] = (size >> (i * 8)) & 0xff;
+	}
+
+	header[32] = sound.channels * sound.samplebits / 8;
+	header[33] = 0;
+	header[34] = sound.samplebits;
+	header[35] = 0;
+	memcpy(header + 36, "data", 4);
+
+	if (sound.samplebits == 16)
+	{
+		short *p = (short *)data;
+
+		for (i = 0; i < size / 2; i++)
+		{
+			p[i] = LittleShort(p[i]);
+		}
+	}
+
+	fwrite(header, sizeof(header), 1, f);
+	fwrite(data, size, 1, f);
+	fclose(f);
+
+	return true;
+}
+
+/*
+ * Renders a fixed scene of synthetic
+ * effects on all channels with the
+ * scalar and the SIMD mixer, times
+ * both and compares the output. The
+ * output of the path selected by
+ * s_simd is written as WAV file, so
+ * that builds can be compared.
+ */
+static void
+SDL_MixBench_f(void)
+{
+	channel_t savedchannels[MAX_CHANNELS];
+	playsound_t *savednext, *savedprev;
+	unsigned char *savedbuffer;
+	int savedpaintedtime, savedrawend;
+	qboolean savedunderwater;
+	float savedsimd;
+	byte *out[2];
+	long long start, time[2];
+	char name[MAX_OSPATH];
+	int chunk, frames, seconds, size, differ, i, k;
+
+	if ((Cmd_Argc() < 2) || (Cmd_Argc() > 3))
+	{
+		Com_Printf("Usage: s_mixbench <file> [seconds]\n");
+		return;
+	}
+
+	if (!sound.buffer)
+	{
+		Com_Printf("SDL sound is not running.\n");
+		return;
+	}
+
+	seconds = (Cmd_Argc() == 3) ? atoi(Cmd_Argv(2)) : 60;
+	seconds = (seconds < 1) ? 1 : seconds;
+
+	/* render in chunks of the ring buffer size,
+	   starting at 0 each chunk fills it once */
+	chunk = samplesize;
+	frames = sound.samples / sound.channels;
+	size = ((seconds * sound.speed + frames - 1) / frames) * chunk;
+
+	out[0] = Z_Malloc(size);
+	out[1] = Z_Malloc(size);
+
+	SDL_LockAudio();
+
+	memcpy(savedchannels, channels, sizeof(savedchannels));
+	savednext = s_pendingplays.next;
+	savedprev = s_pendingplays.prev;
+	savedbuffer = sound.buffer;
+	savedpaintedtime = paintedtime;
+	savedrawend = s_rawend;
+	savedunderwater = snd_is_underwater;
+	savedsimd = s_simd->value;
+
+	s_pendingplays.next = s_pendingplays.prev = &s_pendingplays;
+	snd_is_underwater = false;
+	SDL_MixBenchCreateSfx();
+
+	/* 0 is the scalar reference, 1 the SIMD kernels */
+	for (k = 0; k < 2; k++)
+	{
+		s_simd->value = k;
+		mixbench_seed = 1;
+		memset(channels, 0, sizeof(channels));
+		paintedtime = 0;
+		s_rawend = 0;
+
+		start = Sys_Microseconds();
+
+		for (i = 0; i < size; i += chunk)
+		{
+			SDL_MixBenchArm();
+			sound.buffer = out[k] + i;
+			SDL_PaintChannels(paintedtime + frames);
+		}
+
+		time[k] = Sys_Microseconds() - start;
+	}
+
+	SDL_MixBenchFreeSfx();
+
+	memcpy(channels, savedchannels, sizeof(channels));
+	s_pendingplays.next = savednext;
+	s_pendingplays.prev = savedprev;
+	sound.buffer = savedbuffer;
+	paintedtime = savedpaintedtime;
+	s_rawend = savedrawend;
+	snd_is_underwater = savedunderwater;
+	s_simd->value = savedsimd;
+
+	SDL_UnlockAudio();
+
+	differ = 0;
+
+	for (i = 0; i < size; i++)
+	{
+		if (out[0][i] != out[1][i])
+		{
+			differ++;
+		}
+	}
+
+	Com_Printf("%i seconds, %i channels, %i Hz, %i bit\n", seconds,
+			s_numchannels, sound.speed, sound.samplebits);
+	Com_Printf("scalar: %lld usec\n", time[0]);
+#if defined(SDL_MIX_SSE2) || defined(SDL_MIX_NEON)
+	Com_Printf("%s: %lld usec\n",
+#if defined(SDL_MIX_SSE2)
+			"sse2",
+#else
+			"neon",
+#endif
+			time[1]);
+#else
+	Com_Printf("No SIMD kernels in this build.\n");
+#endif
+	Com_Printf("%i bytes differ\n", differ);
+
+	if (s_testsound->value)
+	{
+		Com_Printf("s_testsound is set, the output is a sine wave.\n");
+	}
+
+	Com_sprintf(name, sizeof(name), "%s/%s", FS_Gamedir(), Cmd_Argv(1));
+
+	if (SDL_MixBenchWrite(name, out[savedsimd ? 1 : 0], size))
+	{
+		Com_Printf("Wrote %s.\n", name);
+	}
+	else
+	{
+		Com_Printf("Couldn't open %s for writing.\n", name);
+	}
+
+	Z_Free(out[1]);
+	Z_Free(out[0]);
+}
+
+/* ------------------------------------------------------------------ */
+
 /*
  * Gives information over user
  * defineable variables
@@ -1437,6 +2146,9 @@ SDL_BackendInit(void)
 	s_underwater_gain_hf->modified = true;
 	lpf_initialize(&lpf_context, lpf_default_gain_hf, backend->speed);
 
+	s_simd = Cvar_Get("s_simd", "1", CVAR_ARCHIVE);
+	Cmd_AddCommand("s_mixbench", SDL_MixBench_f);
+
 	SDL_UpdateScaletable();
 	SDL_PauseAudio(0);
 
@@ -1455,6 +2167,7 @@ void
 SDL_BackendShutdown(void)
 {
 	Com_Printf("Closing SDL audio device...\n");
+	Cmd_RemoveCommand("s_mixbench");
 	SDL_PauseAudio(1);
 	SDL_CloseAudio();
 	SDL_QuitSubSystem(SDL_INIT_AUDIO);
@@ -40,6 +40,9 @@
 #define MAX_SFX (MAX_SOUNDS * 2)
 #define MAX_PLAYSOUNDS 128
 
+/* must be a power of two */
+#define SFX_HASH_SIZE 256
+
 /* Maximum length (seconds) of audio data to test for silence. */
 #define S_MAX_LEN_TO_TEST_FOR_SILENCE_S (2)
 
@@ -86,6 +89,8 @@ int s_rawend;
 static int s_registration_sequence = 0;
 portable_samplepair_t s_rawsamples[MAX_RAW_SAMPLES];
 static sfx_t known_sfx[MAX_SFX];
+static int sfx_hash[SFX_HASH_SIZE];  /* index + 1 of the first sfx, 0 = empty */
+static int sfx_hashnext[MAX_SFX];    /* index + 1 of the next sfx in the chain */
 sndstarted_t sound_started = SS_NOT;
 sound_t sound;
 static qboolean s_registering;
@@ -560,6 +565,83 @@ S_LoadSound(sfx_t *s)
 	return sc;
 }
 
+/*
+ * Hashes a sound name into a bucket
+ * of the known_sfx index.
+ */
+static int
+S_HashName(const char *name)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*name)
+	{
+		hash = (hash ^ (byte)*name++) * 16777619u;
+	}
+
+	return hash & (SFX_HASH_SIZE - 1);
+}
+
+/*
+ * Adds known_sfx[i] to the name index.
+ */
+static void
+S_HashLink(int i)
+{
+	int bucket = S_HashName(known_sfx[i].name);
+
+	sfx_hashnext[i] = sfx_hash[bucket];
+	sfx_hash[bucket] = i + 1;
+}
+
+/*
+ * Removes known_sfx[i] from the name
+ * index, must be called before the
+ * name is cleared.
+ */
+static void
+S_HashUnlink(int i)
+{
+	int *link = &sfx_hash[S_HashName(known_sfx[i].name)];
+
+	while (*link)
+	{
+		if (*link == i + 1)
+		{
+			*link = sfx_hashnext[i];
+			break;
+		}
+
+		link = &sfx_hashnext[*link - 1];
+	}
+
+	sfx_hashnext[i] = 0;
+}
+
+/*
+ * Returns a free slot in known_sfx.
+ */
+static int
+S_AllocSfx(void)
+{
+	int i;
+
+	for (i = 0; i < num_sfx; i++)
+	{
+		if (!known_sfx[i].name[0])
+		{
+			return i;
+		}
+	}
+
+	if (num_sfx == MAX_SFX)
+	{
+		Com_Error(ERR_FATAL, "%s: out of sfx_t", __func__);
+	}
+
+	return num_sfx++;
+}
+
 /*
  * Returns the name of a sound
  */
@@ -586,11 +668,11 @@ S_FindName(char *name, qboolean create)
 	}
 
 	/* see if already loaded */
-	for (i = 0; i < num_sfx; i++)
+	for (i = sfx_hash[S_HashName(name)]; i; i = sfx_hashnext[i - 1])
 	{
-		if (!strcmp(known_sfx[i].name, name))
+		if (!strcmp(known_sfx[i - 1].name, name))
 		{
-			return &known_sfx[i];
+			return &known_sfx[i - 1];
 		}
 	}
 
@@ -600,29 +682,14 @@ S_FindName(char *name, qboolean create)
 	}
 
 	/* find a free sfx */
-	for (i = 0; i < num_sfx; i++)
-	{
-		if (!known_sfx[i].name[0])
-		{
-			break;
-		}
-	}
-
-	if (i == num_sfx)
-	{
-		if (num_sfx == MAX_SFX)
-		{
-			Com_Error(ERR_FATAL, "%s: out of sfx_t", __func__);
-		}
-
-		num_sfx++;
-	}
+	i = S_AllocSfx();
 
 	sfx = &known_sfx[i];
 	sfx->truename = NULL;
 	strcpy(sfx->name, name);
 	sfx->registration_sequence = s_registration_sequence;
 	sfx->is_silenced_muzzle_flash = false;
+	S_HashLink(i);
 
 	return sfx;
 }
@@ -642,29 +709,14 @@ S_AliasName(char *aliasname, char *truename)
 	strcpy(s, truename);
 
 	/* find a free sfx */
-	for (i = 0; i < num_sfx; i++)
-	{
-		if (!known_sfx[i].name[0])
-		{
-			break;
-		}
-	}
-
-	if (i == num_sfx)
-	{
-		if (num_sfx == MAX_SFX)
-		{
-			Com_Error(ERR_FATAL, "%s: out of sfx_t", __func__);
-		}
-
-		num_sfx++;
-	}
+	i = S_AllocSfx();
 
 	sfx = &known_sfx[i];
 	sfx->cache = NULL;
 	strcpy(sfx->name, aliasname);
 	sfx->registration_sequence = s_registration_sequence;
 	sfx->truename = s;
+	S_HashLink(i);
 
 	return sfx;
 }
@@ -835,6 +887,7 @@ S_EndRegistration(void)
 					Z_Free(sfx->truename);
 				}
 
+				S_HashUnlink(i);
 				sfx->cache = NULL;
 				sfx->name[0] = 0;
 			}
@@ -1654,6 +1707,8 @@ S_Init(void)
 	}
 
 	num_sfx = 0;
+	memset(sfx_hash, 0, sizeof(sfx_hash));
+	memset(sfx_hashnext, 0, sizeof(sfx_hashnext));
 	paintedtime = 0;
 	sound_max = 0;
 	s_active = true;
@@ -1711,6 +1766,8 @@ S_Shutdown(void)
 	}
 
 	memset(known_sfx, 0, sizeof(known_sfx));
+	memset(sfx_hash, 0, sizeof(sfx_hash));
+	memset(sfx_hashnext, 0, sizeof(sfx_hashnext));
 	num_sfx = 0;
 
 #if USE_OPENAL
@@ -40,6 +40,8 @@ static cvar_t *vid_displayindex;
 static cvar_t *vid_highdpiaware;
 static cvar_t *vid_rate;
 
+extern cvar_t *vid_headless;
+
 static int last_flags = 0;
 static int last_display = 0;
 static int last_position_x = SDL_WINDOWPOS_UNDEFINED;
@@ -407,6 +409,13 @@ GLimp_Init(void)
 
 	if (!SDL_WasInit(SDL_INIT_VIDEO))
 	{
+		/* The offscreen driver (SDL 2.0.12 and later) renders
+		   into memory, e.g. for benchmarks without a display. */
+		if (vid_headless->value)
+		{
+			SDL_setenv("SDL_VIDEODRIVER", "offscreen", 1);
+		}
+
 		if (SDL_Init(SDL_INIT_VIDEO) == -1)
 		{
 			Com_Printf("Couldn't init SDL video: %s.\n", SDL_GetError());
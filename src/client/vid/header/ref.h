@@ -124,8 +124,7 @@ typedef enum {
 	RESTART_PARTIAL
 } ref_restart_t;
 
-// FIXME: bump API_VERSION?
-#define	API_VERSION		6
+#define	API_VERSION		7
 #define EXPORT
 #define IMPORT
 
@@ -252,6 +251,13 @@ typedef struct
 	qboolean	(IMPORT *GLimp_GetDesktopMode)(int *pwidth, int *pheight);
 
 	void		(IMPORT *Vid_RequestRestart)(ref_restart_t rs);
+
+	// worker threads, shared with the server
+	int		(IMPORT *Sys_NumWorkers)(void);
+	void	(IMPORT *Sys_StartWorkers)(int user, int count);
+	void	(IMPORT *Sys_RunParallel)(sysjob_t func, void *data, int count);
+
+	long long	(IMPORT *Sys_Microseconds)(void);
 } refimport_t;
 
 // this is the only function actually exported at the linker level
@@ -287,6 +287,7 @@ VID_GetModeInfo(int *width, int *height, int mode)
 cvar_t *vid_gamma;
 cvar_t *vid_fullscreen;
 cvar_t *vid_renderer;
+cvar_t *vid_headless;
 
 // Global video state, used throughout the client.
 viddef_t viddef;
@@ -392,6 +393,7 @@ VID_LoadRenderer(void)
 
 	char reflib_name[64] = {0};
 	char reflib_path[MAX_OSPATH] = {0};
+	const char *renderer = vid_renderer->string;
 
 	// If the refresher is already active we need
 	// to shut it down before loading a new one
@@ -400,12 +402,21 @@ VID_LoadRenderer(void)
 	// Log what we're doing.
 	Com_Printf("----- refresher initialization -----\n");
 
-	snprintf(reflib_name, sizeof(reflib_name), "ref_%s.%s", vid_renderer->string, lib_ext);
-	VID_GetRendererLibPath(vid_renderer->string, reflib_path, sizeof(reflib_path));
+	// Without a display only the software renderer is able
+	// to draw anything. vid_renderer is left alone, it's
+	// archived and the next normal start should use it.
+	if (vid_headless->value && strcmp(renderer, "soft"))
+	{
+		Com_Printf("Headless, using the software renderer.\n");
+		renderer = "soft";
+	}
+
+	snprintf(reflib_name, sizeof(reflib_name), "ref_%s.%s", renderer, lib_ext);
+	VID_GetRendererLibPath(renderer, reflib_path, sizeof(reflib_path));
 	Com_Printf("Loading library: %s\n", reflib_name);
 
 	// Check if the renderer libs exists.
-	if (!VID_HasRenderer(vid_renderer->string))
+	if (!VID_HasRenderer(renderer))
 	{
         Com_Printf("Library %s cannot be found!\n", reflib_name);
 
@@ -445,6 +456,10 @@ VID_LoadRenderer(void)
 	ri.Vid_MenuInit = VID_MenuInit;
 	ri.Vid_WriteScreenshot = VID_WriteScreenshot;
 	ri.Vid_RequestRestart = VID_RequestRestart;
+	ri.Sys_NumWorkers = Sys_NumWorkers;
+	ri.Sys_StartWorkers = Sys_StartWorkers;
+	ri.Sys_RunParallel = Sys_RunParallel;
+	ri.Sys_Microseconds = Sys_Microseconds;
 
 	// Exchange our export struct with the renderers import struct.
 	re = GetRefAPI(ri);
@@ -524,6 +539,12 @@ VID_CheckChanges(void)
 		// Mkay, let's try our luck.
 		while (!VID_LoadRenderer())
 		{
+			// Headless there's nothing to fall back to.
+			if (vid_headless->value)
+			{
+				Com_Error(ERR_FATAL, "Couldn't load the software renderer!\n");
+			}
+
 			// We try: custom -> gl3 -> gl1 -> soft.
 			if ((strcmp(vid_renderer->string, "gl3") != 0) &&
 				(strcmp(vid_renderer->string, "gl1") != 0) &&
@@ -569,6 +590,7 @@ VID_Init(void)
 	vid_gamma = Cvar_Get("vid_gamma", "1.0", CVAR_ARCHIVE);
 	vid_fullscreen = Cvar_Get("vid_fullscreen", "0", CVAR_ARCHIVE);
 	vid_renderer = Cvar_Get("vid_renderer", "gl1", CVAR_ARCHIVE);
+	vid_headless = Cvar_Get("vid_headless", "0", CVAR_NOSET);
 
 	// Commands
 	Cmd_AddCommand("vid_restart", VID_Restart_f);
@@ -655,7 +677,11 @@ R_RenderFrame(refdef_t *fd)
 {
 	if (ref_active)
 	{
+		long long profstart = Prof_Begin();
+
 		re.RenderFrame(fd);
+
+		Prof_End(PROF_RE_RENDERFRAME, profstart);
 	}
 }
 
@@ -776,7 +802,11 @@ R_EndFrame(void)
 {
 	if(ref_active)
 	{
+		long long profstart = Prof_Begin();
+
 		re.EndFrame();
+
+		Prof_End(PROF_RE_ENDFRAME, profstart);
 	}
 }
 
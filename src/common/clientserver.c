@@ -41,6 +41,12 @@ static char *rd_buffer;
 static int rd_buffersize;
 static void (*rd_flush)(int target, char *buffer);
 
+#ifdef _MSC_VER
+static __declspec(thread) comdeferred_t *com_deferred;
+#else
+static __thread comdeferred_t *com_deferred;
+#endif
+
 void
 Com_BeginRedirect(int target, char *buffer, int buffersize, void (*flush)(int, char *))
 {
@@ -68,6 +74,41 @@ Com_EndRedirect(void)
 	rd_flush = NULL;
 }
 
+void
+Com_BeginDeferred(comdeferred_t *deferred)
+{
+	deferred->error = -1;
+	deferred->errormsg[0] = 0;
+	deferred->text[0] = 0;
+
+	com_deferred = deferred;
+}
+
+void
+Com_EndDeferred(void)
+{
+	com_deferred = NULL;
+}
+
+/*
+ * Called on the main thread after the job
+ * finished, doesn't return on an error.
+ */
+void
+Com_FlushDeferred(comdeferred_t *deferred)
+{
+	if (deferred->text[0])
+	{
+		Com_Printf("%s", deferred->text);
+		deferred->text[0] = 0;
+	}
+
+	if (deferred->error != -1)
+	{
+		Com_Error(deferred->error, "%s", deferred->errormsg);
+	}
+}
+
 /*
  * Both client and server can use this, and it will output
  * to the apropriate place.
@@ -90,6 +131,12 @@ Com_VPrintf(int print_level, const char *fmt, va_list argptr)
 			msg[msgLen] = '\0';
 		}
 
+		if (com_deferred)
+		{
+			Q_strlcat(com_deferred->text, msg, sizeof(com_deferred->text));
+			return;
+		}
+
 		if (rd_target)
 		{
 			if ((msgLen + strlen(rd_buffer)) > (rd_buffersize - 1))
@@ -248,6 +295,20 @@ Com_Error(int code, const char *fmt, ...)
 	static char msg[MAXPRINTMSG];
 	static qboolean recursive;
 
+	if (com_deferred)
+	{
+		comdeferred_t *deferred = com_deferred;
+
+		com_deferred = NULL;
+
+		va_start(argptr, fmt);
+		vsnprintf(deferred->errormsg, sizeof(deferred->errormsg), fmt, argptr);
+		va_end(argptr);
+
+		deferred->error = code;
+		longjmp(deferred->abort, 1);
+	}
+
 	if (recursive)
 	{
 		Sys_Error("recursive error after: %s", msg);
@@ -32,10 +32,12 @@
 
 #define MAX_ALIAS_NAME 32
 #define ALIAS_LOOP_COUNT 16
+#define CMD_HASH_SIZE 512 /* must be a power of 2 */
 
 typedef struct cmd_function_s
 {
 	struct cmd_function_s *next;
+	struct cmd_function_s *hashnext;
 	const char *name;
 	xcommand_t function;
 } cmd_function_t;
@@ -45,10 +47,17 @@ static cmd_function_t *cmd_functions; /* possible commands to execute */
 typedef struct cmdalias_s
 {
 	struct cmdalias_s *next;
+	struct cmdalias_s *hashnext;
 	char name[MAX_ALIAS_NAME];
 	char *value;
 } cmdalias_t;
 
+/* Commands and aliases are additionally hashed by their
+   lowercased name. The lists stay sorted for listing and
+   completion. */
+static cmd_function_t *cmd_hash[CMD_HASH_SIZE];
+static cmdalias_t *alias_hash[CMD_HASH_SIZE];
+
 char retval[256];
 int alias_count; /* for detecting runaway loops */
 cmdalias_t *cmd_alias;
@@ -62,6 +71,56 @@ sizebuf_t cmd_text;
 byte cmd_text_buf[32768];
 char defer_text_buf[32768];
 
+static unsigned
+Cmd_HashName(const char *name)
+{
+	unsigned hash = 2166136261u;
+
+	while (*name)
+	{
+		hash ^= tolower((byte)*name++);
+		hash *= 16777619u;
+	}
+
+	return hash & (CMD_HASH_SIZE - 1);
+}
+
+/*
+ * The hash ignores case, so the same bucket serves
+ * exact and case insensitive lookups.
+ */
+static cmd_function_t *
+Cmd_FindCommand(const char *name, qboolean nocase)
+{
+	cmd_function_t *cmd;
+
+	for (cmd = cmd_hash[Cmd_HashName(name)]; cmd; cmd = cmd->hashnext)
+	{
+		if (nocase ? !Q_strcasecmp(name, cmd->name) : !strcmp(name, cmd->name))
+		{
+			return cmd;
+		}
+	}
+
+	return NULL;
+}
+
+static cmdalias_t *
+Cmd_FindAlias(const char *name, qboolean nocase)
+{
+	cmdalias_t *a;
+
+	for (a = alias_hash[Cmd_HashName(name)]; a; a = a->hashnext)
+	{
+		if (nocase ? !Q_strcasecmp(name, a->name) : !strcmp(name, a->name))
+		{
+			return a;
+		}
+	}
+
+	return NULL;
+}
+
 /*
  * Causes execution of the remainder of the command buffer to be delayed
  * until next frame.  This allows commands like: bind g "impulse 5 ;
@@ -461,24 +520,23 @@ Cmd_Alias_f(void)
 	}
 
 	/* if the alias already exists, reuse it */
-	for (a = cmd_alias; a; a = a->next)
+	if ((a = Cmd_FindAlias(s, false)) != NULL)
 	{
-		if (!strcmp(s, a->name))
-		{
-			Z_Free(a->value);
-			break;
-		}
+		Z_Free(a->value);
 	}
-
-	if (!a)
+	else
 	{
+		unsigned hash = Cmd_HashName(s);
+
 		a = Z_Malloc(sizeof(cmdalias_t));
+		strcpy(a->name, s);
+
 		a->next = cmd_alias;
 		cmd_alias = a;
+		a->hashnext = alias_hash[hash];
+		alias_hash[hash] = a;
 	}
 
-	strcpy(a->name, s);
-
 	/* copy the rest of the command line */
 	cmd[0] = 0; /* start out with a null string */
 	c = Cmd_Argc();
@@ -705,6 +763,7 @@ Cmd_AddCommand(const char *cmd_name, xcommand_t function)
 {
 	cmd_function_t *cmd;
 	cmd_function_t **pos;
+	unsigned hash;
 
 	/* fail if the command is a variable name */
 	if (Cvar_VariableString(cmd_name)[0])
@@ -713,19 +772,20 @@ Cmd_AddCommand(const char *cmd_name, xcommand_t function)
 	}
 
 	/* fail if the command already exists */
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	if (Cmd_FindCommand(cmd_name, false))
 	{
-		if (!strcmp(cmd_name, cmd->name))
-		{
-			Com_Printf("Cmd_AddCommand: %s already defined\n", cmd_name);
-			return;
-		}
+		Com_Printf("Cmd_AddCommand: %s already defined\n", cmd_name);
+		return;
 	}
 
 	cmd = Z_Malloc(sizeof(cmd_function_t));
 	cmd->name = cmd_name;
 	cmd->function = function;
 
+	hash = Cmd_HashName(cmd_name);
+	cmd->hashnext = cmd_hash[hash];
+	cmd_hash[hash] = cmd;
+
 	/* link the command in */
 	pos = &cmd_functions;
 	while (*pos && strcmp((*pos)->name, cmd->name) < 0)
@@ -756,6 +816,13 @@ Cmd_RemoveCommand(const char *cmd_name)
 		if (!strcmp(cmd_name, cmd->name))
 		{
 			*back = cmd->next;
+
+			for (back = &cmd_hash[Cmd_HashName(cmd_name)]; *back != cmd;
+					back = &(*back)->hashnext)
+			{
+			}
+
+			*back = cmd->hashnext;
 			Z_Free(cmd);
 			return;
 		}
@@ -767,17 +834,7 @@ Cmd_RemoveCommand(const char *cmd_name)
 qboolean
 Cmd_Exists(char *cmd_name)
 {
-	cmd_function_t *cmd;
-
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
-	{
-		if (!strcmp(cmd_name, cmd->name))
-		{
-			return true;
-		}
-	}
-
-	return false;
+	return Cmd_FindCommand(cmd_name, false) != NULL;
 }
 
 const char *
@@ -990,25 +1047,12 @@ Cmd_CompleteMapCommand(const char *partial)
 qboolean
 Cmd_IsComplete(const char *command)
 {
-	cmd_function_t *cmd;
-	cmdalias_t *a;
 	cvar_t *cvar;
 
 	/* check for exact match */
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
-	{
-		if (!strcmp(command, cmd->name))
-		{
-			return true;
-		}
-	}
-
-	for (a = cmd_alias; a; a = a->next)
+	if (Cmd_FindCommand(command, false) || Cmd_FindAlias(command, false))
 	{
-		if (!strcmp(command, a->name))
-		{
-			return true;
-		}
+		return true;
 	}
 
 	for (cvar = cvar_vars; cvar; cvar = cvar->next)
@@ -1049,38 +1093,32 @@ Cmd_ExecuteString(char *text)
 	}
 
 	/* check functions */
-	for (cmd = cmd_functions; cmd; cmd = cmd->next)
+	if ((cmd = Cmd_FindCommand(cmd_argv[0], true)) != NULL)
 	{
-		if (!Q_strcasecmp(cmd_argv[0], cmd->name))
+		if (!cmd->function)
 		{
-			if (!cmd->function)
-			{
-				/* forward to server command */
-				Cmd_ExecuteString(va("cmd %s", text));
-			}
-			else
-			{
-				cmd->function();
-			}
-
-			return;
+			/* forward to server command */
+			Cmd_ExecuteString(va("cmd %s", text));
 		}
+		else
+		{
+			cmd->function();
+		}
+
+		return;
 	}
 
 	/* check alias */
-	for (a = cmd_alias; a; a = a->next)
+	if ((a = Cmd_FindAlias(cmd_argv[0], true)) != NULL)
 	{
-		if (!Q_strcasecmp(cmd_argv[0], a->name))
+		if (++alias_count == ALIAS_LOOP_COUNT)
 		{
-			if (++alias_count == ALIAS_LOOP_COUNT)
-			{
-				Com_Printf("ALIAS_LOOP_COUNT\n");
-				return;
-			}
-
-			Cbuf_InsertText(a->value);
+			Com_Printf("ALIAS_LOOP_COUNT\n");
 			return;
 		}
+
+		Cbuf_InsertText(a->value);
+		return;
 	}
 
 	/* check cvars */
@@ -1135,4 +1173,6 @@ Cmd_Shutdown(void)
 		Z_Free(cmd_alias);
 		cmd_alias = next;
 	}
+
+	memset(alias_hash, 0, sizeof(alias_hash));
 }
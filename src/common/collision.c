@@ -27,9 +27,21 @@
 
 #include <stdint.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #include "header/common.h"
 #include "header/cmodel.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CM_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CM_NEON
+#endif
+
 typedef struct
 {
 	cplane_t	*plane;
@@ -88,6 +100,12 @@ typedef struct
 	cbrushside_t *map_brushsides;
 	int numbrushsides;
 
+	/* The planes of map_brushsides as structure of arrays:
+	   normal x, y, z and dist, sidestride floats apart and
+	   padded for 4 wide loads. Used by the SIMD kernels. */
+	float *sideplanes;
+	int sidestride;
+
 	mapsurface_t *map_surfaces;
 	int	numtexinfo;
 
@@ -135,7 +153,6 @@ static cvar_t *map_noareas;
 static int box_headnode;
 static int checkcount;
 static int floodvalid;
-static int leaf_topnode;
 static int trace_contents;
 static mapsurface_t nullsurface;
 static qboolean trace_ispoint; /* optimized case */
@@ -144,9 +161,74 @@ static vec3_t trace_start, trace_end;
 static vec3_t trace_mins, trace_maxs;
 static vec3_t trace_extents;
 
+/*
+ * Decompressed visibility. Once complete the rows are never written
+ * again until the next CM_LoadMap() and may be read from several
+ * threads, the LRU fallback for huge maps is main thread only.
+ */
+#define VISCACHE_MIN_SLOTS 16
+
+typedef struct
+{
+	model_t *owner;
+	size_t budget;
+	int rowsize; /* multiple of 4 bytes */
+	int numrows; /* numclusters PVS rows, then numclusters PHS rows */
+	qboolean complete;
+	byte *rows;
+
+	/* LRU fallback, slots are a list with the most recently used at the head */
+	int numslots;
+	int *rowslot;
+	int *slotrow;
+	int *slotprev;
+	int *slotnext;
+	int lruhead;
+	int lrutail;
+	unsigned hits;
+	unsigned misses;
+} viscache_t;
+
+static viscache_t viscache;
+static cvar_t *map_viscache;
+
+/* brushes with more sides take the scalar path */
+#define CM_MAX_SIMD_SIDES 64
+
+static cvar_t *cm_simd;
+
+/* cm_tracerecord */
+static FILE *cm_tracefile;
+
+#define CM_TRACEFILE_IDENT (('R' << 24) + ('T' << 16) + ('M' << 8) + 'C')
+#define CM_TRACEFILE_VERSION 1
+
+typedef struct
+{
+	int ident;
+	int version;
+	unsigned checksum; /* of the map */
+} tracefileheader_t;
+
+typedef struct
+{
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	int headnode;
+	int brushmask;
+} tracerecord_t;
+
 #ifndef DEDICATED_ONLY
 int		c_pointcontents;
 int		c_traces, c_brush_traces;
+
+/* the server walks the BSP tree on worker
+   threads, so the counters are atomic */
+#ifdef _MSC_VER
+#define CM_COUNT(c) _InterlockedIncrement((volatile long *)&(c))
+#else
+#define CM_COUNT(c) __atomic_fetch_add(&(c), 1, __ATOMIC_RELAXED)
+#endif
 #endif
 
 /* 1/32 epsilon to keep floating point happy */
@@ -318,7 +400,7 @@ CM_ReadPortalState(fileHandle_t f)
  * is potentially visible
  */
 qboolean
-CM_HeadnodeVisible(int nodenum, byte *visbits)
+CM_HeadnodeVisible(int nodenum, const byte *visbits)
 {
 	int leafnum1;
 	int cluster;
@@ -425,6 +507,14 @@ CM_InitBoxHull(void)
 		p->signbits = 0;
 		VectorClear(p->normal);
 		p->normal[i >> 1] = -1;
+
+		if (cmod->sideplanes)
+		{
+			p = s->plane;
+			cmod->sideplanes[cmod->numbrushsides + i] = p->normal[0];
+			cmod->sideplanes[cmod->numbrushsides + i + cmod->sidestride] = p->normal[1];
+			cmod->sideplanes[cmod->numbrushsides + i + cmod->sidestride * 2] = p->normal[2];
+		}
 	}
 }
 
@@ -448,6 +538,18 @@ CM_HeadnodeForBox(vec3_t mins, vec3_t maxs)
 	box_planes[10].dist = mins[2];
 	box_planes[11].dist = -mins[2];
 
+	if (cmod->sideplanes)
+	{
+		float *pd = cmod->sideplanes + cmod->sidestride * 3 + cmod->numbrushsides;
+		int i;
+
+		/* side i uses plane i * 2 + (i & 1) */
+		for (i = 0; i < 6; i++)
+		{
+			pd[i] = box_planes[i * 2 + (i & 1)].dist;
+		}
+	}
+
 	return box_headnode;
 }
 
@@ -490,7 +592,7 @@ CM_PointLeafnum_r(vec3_t p, int num)
 	}
 
 #ifndef DEDICATED_ONLY
-	c_pointcontents++; /* optimize counter */
+	CM_COUNT(c_pointcontents); /* optimize counter */
 #endif
 
 	return -1 - num;
@@ -512,7 +614,7 @@ CM_PointLeafnum(vec3_t p)
  */
 static void
 CM_BoxLeafnums_r(int nodenum, vec3_t leaf_mins, vec3_t leaf_maxs,
-	int *leaf_list, int *leaf_count, int leaf_maxcount)
+	int *leaf_list, int *leaf_count, int leaf_maxcount, int *leaf_topnode)
 {
 	cplane_t *plane;
 	cnode_t *node;
@@ -553,13 +655,13 @@ CM_BoxLeafnums_r(int nodenum, vec3_t leaf_mins, vec3_t leaf_maxs,
 		else
 		{
 			/* go down both */
-			if (leaf_topnode == -1)
+			if (*leaf_topnode == -1)
 			{
-				leaf_topnode = nodenum;
+				*leaf_topnode = nodenum;
 			}
 
 			CM_BoxLeafnums_r(node->children[0], leaf_mins, leaf_maxs, leaf_list,
-				leaf_count, leaf_maxcount);
+				leaf_count, leaf_maxcount, leaf_topnode);
 			nodenum = node->children[1];
 		}
 	}
@@ -570,11 +672,11 @@ CM_BoxLeafnums_headnode(vec3_t leaf_mins, vec3_t leaf_maxs, int *leaf_list,
 		int leaf_maxcount, int headnode, int *topnode)
 {
 	int leaf_count = 0;
+	int leaf_topnode = -1;
 
-	leaf_topnode = -1;
-
+	/* no static state, the server calls this from worker threads */
 	CM_BoxLeafnums_r(headnode, leaf_mins, leaf_maxs, leaf_list,
-		&leaf_count, leaf_maxcount);
+		&leaf_count, leaf_maxcount, &leaf_topnode);
 
 	if (topnode)
 	{
@@ -649,6 +751,160 @@ CM_TransformedPointContents(vec3_t p, int headnode,
 	return cmod->map_leafs[l].contents;
 }
 
+/*
+ * Evaluates all sides of a brush at once. For each side d1 (and
+ * d2 if p2 is given) is set to the distance of the point from the
+ * side's plane, pushed out for mins/maxs. The operations are the
+ * same as in the scalar loops of CM_ClipBoxToBrush() and
+ * CM_TestBoxInBrush(), so the results are bit identical. Returns
+ * false if the brush must take the scalar path.
+ */
+static qboolean
+CM_BrushSideDists(const cbrush_t *brush, const vec3_t mins, const vec3_t maxs,
+		qboolean ispoint, const vec3_t p1, const vec3_t p2, float *d1, float *d2)
+{
+#if defined(CM_SSE2) || defined(CM_NEON)
+	const float *nx, *ny, *nz, *pd;
+	int i;
+
+	if (!cm_simd->value || !cmod->sideplanes ||
+		(brush->numsides > CM_MAX_SIMD_SIDES) ||
+		(brush->firstbrushside + brush->numsides >
+		 cmod->numbrushsides + EXTRA_LUMP_BRUSHSIDES))
+	{
+		return false;
+	}
+
+	nx = cmod->sideplanes + brush->firstbrushside;
+	ny = nx + cmod->sidestride;
+	nz = ny + cmod->sidestride;
+	pd = nz + cmod->sidestride;
+
+#if defined(CM_SSE2)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 p1x = _mm_set1_ps(p1[0]), p1y = _mm_set1_ps(p1[1]), p1z = _mm_set1_ps(p1[2]);
+		const __m128 p2x = _mm_set1_ps(p2 ? p2[0] : 0), p2y = _mm_set1_ps(p2 ? p2[1] : 0),
+			p2z = _mm_set1_ps(p2 ? p2[2] : 0);
+		const __m128 minx = _mm_set1_ps(mins[0]), miny = _mm_set1_ps(mins[1]), minz = _mm_set1_ps(mins[2]);
+		const __m128 maxx = _mm_set1_ps(maxs[0]), maxy = _mm_set1_ps(maxs[1]), maxz = _mm_set1_ps(maxs[2]);
+
+		for (i = 0; i < brush->numsides; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(nx + i);
+			__m128 y = _mm_loadu_ps(ny + i);
+			__m128 z = _mm_loadu_ps(nz + i);
+			__m128 dist = _mm_loadu_ps(pd + i);
+			__m128 d;
+
+			if (!ispoint)
+			{
+				/* push the plane out apropriately for mins/maxs */
+				__m128 sx = _mm_cmplt_ps(x, zero);
+				__m128 sy = _mm_cmplt_ps(y, zero);
+				__m128 sz = _mm_cmplt_ps(z, zero);
+				__m128 ox = _mm_or_ps(_mm_and_ps(sx, maxx), _mm_andnot_ps(sx, minx));
+				__m128 oy = _mm_or_ps(_mm_and_ps(sy, maxy), _mm_andnot_ps(sy, miny));
+				__m128 oz = _mm_or_ps(_mm_and_ps(sz, maxz), _mm_andnot_ps(sz, minz));
+
+				d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ox, x), _mm_mul_ps(oy, y)),
+						_mm_mul_ps(oz, z));
+				dist = _mm_sub_ps(dist, d);
+			}
+
+			d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p1x, x), _mm_mul_ps(p1y, y)),
+					_mm_mul_ps(p1z, z));
+			_mm_storeu_ps(d1 + i, _mm_sub_ps(d, dist));
+
+			if (p2)
+			{
+				d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p2x, x), _mm_mul_ps(p2y, y)),
+						_mm_mul_ps(p2z, z));
+				_mm_storeu_ps(d2 + i, _mm_sub_ps(d, dist));
+			}
+		}
+	}
+#else
+	{
+		const float32x4_t zero = vdupq_n_f32(0);
+		const float32x4_t p1x = vdupq_n_f32(p1[0]), p1y = vdupq_n_f32(p1[1]), p1z = vdupq_n_f32(p1[2]);
+		const float32x4_t p2x = vdupq_n_f32(p2 ? p2[0] : 0), p2y = vdupq_n_f32(p2 ? p2[1] : 0),
+			p2z = vdupq_n_f32(p2 ? p2[2] : 0);
+		const float32x4_t minx = vdupq_n_f32(mins[0]), miny = vdupq_n_f32(mins[1]), minz = vdupq_n_f32(mins[2]);
+		const float32x4_t maxx = vdupq_n_f32(maxs[0]), maxy = vdupq_n_f32(maxs[1]), maxz = vdupq_n_f32(maxs[2]);
+
+		for (i = 0; i < brush->numsides; i += 4)
+		{
+			float32x4_t x = vld1q_f32(nx + i);
+			float32x4_t y = vld1q_f32(ny + i);
+			float32x4_t z = vld1q_f32(nz + i);
+			float32x4_t dist = vld1q_f32(pd + i);
+			float32x4_t d;
+
+			if (!ispoint)
+			{
+				/* push the plane out apropriately for mins/maxs,
+				   no vmlaq_f32(), it may be fused */
+				float32x4_t ox = vbslq_f32(vcltq_f32(x, zero), maxx, minx);
+				float32x4_t oy = vbslq_f32(vcltq_f32(y, zero), maxy, miny);
+				float32x4_t oz = vbslq_f32(vcltq_f32(z, zero), maxz, minz);
+
+				d = vaddq_f32(vaddq_f32(vmulq_f32(ox, x), vmulq_f32(oy, y)),
+						vmulq_f32(oz, z));
+				dist = vsubq_f32(dist, d);
+			}
+
+			d = vaddq_f32(vaddq_f32(vmulq_f32(p1x, x), vmulq_f32(p1y, y)),
+					vmulq_f32(p1z, z));
+			vst1q_f32(d1 + i, vsubq_f32(d, dist));
+
+			if (p2)
+			{
+				d = vaddq_f32(vaddq_f32(vmulq_f32(p2x, x), vmulq_f32(p2y, y)),
+						vmulq_f32(p2z, z));
+				vst1q_f32(d2 + i, vsubq_f32(d, dist));
+			}
+		}
+	}
+#endif
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ * Builds the structure of arrays copy of the brush side planes.
+ * The box hull sides are filled in by CM_InitBoxHull() and
+ * CM_HeadnodeForBox().
+ */
+static void
+CM_BuildSidePlanes(model_t *mod)
+{
+	int i, count;
+	float *nx, *ny, *nz, *pd;
+
+	count = mod->numbrushsides + EXTRA_LUMP_BRUSHSIDES;
+	mod->sidestride = (count + 3 + 3) & ~3;
+	mod->sideplanes = Z_Malloc(mod->sidestride * 4 * sizeof(float));
+
+	nx = mod->sideplanes;
+	ny = nx + mod->sidestride;
+	nz = ny + mod->sidestride;
+	pd = nz + mod->sidestride;
+
+	for (i = 0; i < mod->numbrushsides; i++)
+	{
+		const cplane_t *plane = mod->map_brushsides[i].plane;
+
+		nx[i] = plane->normal[0];
+		ny[i] = plane->normal[1];
+		nz[i] = plane->normal[2];
+		pd[i] = plane->dist;
+	}
+}
+
 static void
 CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1,
 		vec3_t p2, trace_t *trace, cbrush_t *brush)
@@ -662,6 +918,8 @@ CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1,
 	qboolean getout, startout;
 	float f;
 	cbrushside_t *side, *leadside;
+	float d1s[CM_MAX_SIMD_SIDES + 3], d2s[CM_MAX_SIMD_SIDES + 3];
+	qboolean dists;
 
 	enterfrac = -1;
 	leavefrac = 1;
@@ -673,13 +931,15 @@ CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1,
 	}
 
 #ifndef DEDICATED_ONLY
-	c_brush_traces++;
+	CM_COUNT(c_brush_traces);
 #endif
 
 	getout = false;
 	startout = false;
 	leadside = NULL;
 
+	dists = CM_BrushSideDists(brush, mins, maxs, trace_ispoint, p1, p2, d1s, d2s);
+
 	for (i = 0; i < brush->numsides; i++)
 	{
 		if (((brush->firstbrushside + i) < 0) ||
@@ -693,7 +953,12 @@ CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1,
 		side = &cmod->map_brushsides[brush->firstbrushside + i];
 		plane = side->plane;
 
-		if (!trace_ispoint)
+		if (dists)
+		{
+			d1 = d1s[i];
+			d2 = d2s[i];
+		}
+		else if (!trace_ispoint)
 		{
 			/* general box case
 			   push the plane out
@@ -713,16 +978,19 @@ CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1,
 
 			dist = DotProduct(ofs, plane->normal);
 			dist = plane->dist - dist;
+
+			d1 = DotProduct(p1, plane->normal) - dist;
+			d2 = DotProduct(p2, plane->normal) - dist;
 		}
 
 		else
 		{
 			/* special point case */
 			dist = plane->dist;
-		}
 
-		d1 = DotProduct(p1, plane->normal) - dist;
-		d2 = DotProduct(p2, plane->normal) - dist;
+			d1 = DotProduct(p1, plane->normal) - dist;
+			d2 = DotProduct(p2, plane->normal) - dist;
+		}
 
 		if (d2 > 0)
 		{
@@ -816,12 +1084,32 @@ CM_TestBoxInBrush(vec3_t mins, vec3_t maxs, vec3_t p1,
 	vec3_t ofs;
 	float d1;
 	cbrushside_t *side;
+	float d1s[CM_MAX_SIMD_SIDES + 3];
 
 	if (!brush->numsides || !cmod->map_brushsides)
 	{
 		return;
 	}
 
+	if (CM_BrushSideDists(brush, mins, maxs, false, p1, NULL, d1s, NULL))
+	{
+		for (i = 0; i < brush->numsides; i++)
+		{
+			/* if completely in front of face, no intersection */
+			if (d1s[i] > 0)
+			{
+				return;
+			}
+		}
+
+		/* inside this brush */
+		trace->startsolid = trace->allsolid = true;
+		trace->fraction = 0;
+		trace->contents = brush->contents;
+
+		return;
+	}
+
 	for (i = 0; i < brush->numsides; i++)
 	{
 		if (((brush->firstbrushside + i) < 0) ||
@@ -1127,8 +1415,8 @@ CM_RecursiveHullCheck(int num, float p1f, float p2f, vec3_t p1, vec3_t p2)
 	CM_RecursiveHullCheck(node->children[side ^ 1], midf, p2f, mid, p2);
 }
 
-trace_t
-CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
+static trace_t
+CM_BoxTraceInternal(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
 		int headnode, int brushmask)
 {
 	int i;
@@ -1136,7 +1424,7 @@ CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
 	checkcount++; /* for multi-check avoidance */
 
 #ifndef DEDICATED_ONLY
-	c_traces++; /* for statistics, may be zeroed */
+	CM_COUNT(c_traces); /* for statistics, may be zeroed */
 #endif
 
 	/* fill in a default trace */
@@ -1149,6 +1437,21 @@ CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
 		return trace_trace;
 	}
 
+	/* box hulls can't be replayed */
+	if (cm_tracefile && (headnode < box_headnode))
+	{
+		tracerecord_t record;
+
+		VectorCopy(start, record.start);
+		VectorCopy(end, record.end);
+		VectorCopy(mins, record.mins);
+		VectorCopy(maxs, record.maxs);
+		record.headnode = headnode;
+		record.brushmask = brushmask;
+
+		fwrite(&record, sizeof(record), 1, cm_tracefile);
+	}
+
 	trace_contents = brushmask;
 	VectorCopy(start, trace_start);
 	VectorCopy(end, trace_end);
@@ -1225,6 +1528,23 @@ CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
 	return trace_trace;
 }
 
+/*
+ * Wraps the actual trace in a profiler zone.
+ */
+trace_t
+CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs,
+		int headnode, int brushmask)
+{
+	long long profstart = Prof_BeginDetail();
+	trace_t trace;
+
+	trace = CM_BoxTraceInternal(start, end, mins, maxs, headnode, brushmask);
+
+	Prof_End(PROF_CM_BOXTRACE, profstart);
+
+	return trace;
+}
+
 /*
  * Handles offseting and rotation of the end points for moving and
  * rotating entities
@@ -1898,9 +2218,22 @@ CMod_LoadEntityString(const char *name, char **map_entitystring, int *numentityc
 	(*map_entitystring)[l->filelen] = 0;
 }
 
+static void CM_FreeVisCache(void);
+static void CM_BuildVisCache(void);
+
 static void
 CM_ModFree(model_t *cmod)
 {
+	if (viscache.owner == cmod)
+	{
+		CM_FreeVisCache();
+	}
+
+	if (cmod->sideplanes)
+	{
+		Z_Free(cmod->sideplanes);
+	}
+
 	if (cmod->extradata && cmod->extradatasize)
 	{
 		Hunk_Free(cmod->extradata);
@@ -1926,10 +2259,10 @@ CM_LoadCachedMap(const char *name, model_t *mod)
 {
 	int i, length, hunkSize = 0;
 	dheader_t header;
-	unsigned *buf;
-	byte *cmod_base;
+	const unsigned *buf;
+	const byte *cmod_base;
 
-	length = FS_LoadFile(name, (void **)&buf);
+	length = FS_LoadFileReadOnly(name, (const void **)&buf);
 
 	if (!buf)
 	{
@@ -1938,7 +2271,7 @@ CM_LoadCachedMap(const char *name, model_t *mod)
 
 	mod->checksum = LittleLong(Com_BlockChecksum(buf, length));
 
-	header = *(dheader_t *)buf;
+	header = *(const dheader_t *)buf;
 
 	for (i = 0; i < sizeof(dheader_t) / 4; i++)
 	{
@@ -1958,7 +2291,7 @@ CM_LoadCachedMap(const char *name, model_t *mod)
 				__func__, name, header.version, BSPVERSION);
 	}
 
-	cmod_base = (byte *)buf;
+	cmod_base = (const byte *)buf;
 
 	/* load into heap */
 	strcpy(mod->name, name);
@@ -2079,11 +2412,13 @@ CM_LoadCachedMap(const char *name, model_t *mod)
 	/* From kmquake2: adding an extra parameter for .ent support. */
 	CMod_LoadEntityString(mod->name, &mod->map_entitystring, &mod->numentitychars,
 		cmod_base, &header.lumps[LUMP_ENTITIES]);
+	CM_BuildSidePlanes(mod);
+
 	mod->extradatasize = Hunk_End();
 	Com_DPrintf("Allocated %d from expected %d hunk size\n",
 		mod->extradatasize, hunkSize);
 
-	FS_FreeFile(buf);
+	FS_FreeFile((void *)buf);
 }
 
 /*
@@ -2095,6 +2430,8 @@ CM_LoadMap(const char *name, qboolean clientload, unsigned *checksum)
 	int i, sec_start;
 
 	map_noareas = Cvar_Get("map_noareas", "0", 0);
+	map_viscache = Cvar_Get("map_viscache", "32", CVAR_ARCHIVE);
+	cm_simd = Cvar_Get("cm_simd", "1", CVAR_ARCHIVE);
 
 	if (!name[0])
 	{
@@ -2113,6 +2450,7 @@ CM_LoadMap(const char *name, qboolean clientload, unsigned *checksum)
 		{
 			memset(cmod->portalopen, 0, sizeof(qboolean) * cmod->numareaportals);
 			FloodAreaConnections();
+			CM_BuildVisCache();
 		}
 
 		return &cmod->map_cmodels[0]; /* still have the right version */
@@ -2173,6 +2511,12 @@ CM_LoadMap(const char *name, qboolean clientload, unsigned *checksum)
 	memset(cmod->portalopen, 0, sizeof(qboolean) * cmod->numareaportals);
 	FloodAreaConnections();
 
+	/* only the server asks for PVS and PHS rows */
+	if (!clientload)
+	{
+		CM_BuildVisCache();
+	}
+
 	Com_DPrintf("%s: Loaded map: %s: %d Kb in %.2fs\n",
 		__func__, name, cmod->extradatasize / 1024,
 		(Sys_Milliseconds() - sec_start) / 1000.0);
@@ -2324,36 +2668,446 @@ CM_DecompressVis(byte *in, byte *out)
 	while (out_p - out < row);
 }
 
-byte *
-CM_ClusterPVS(int cluster)
+static byte *
+CM_VisRowSource(int row)
 {
-	if (cluster == -1 || !cmod->map_vis)
+	int cluster, which;
+
+	which = row / cmod->numclusters;
+	cluster = row % cmod->numclusters;
+
+	return (byte *)cmod->map_vis + cmod->map_vis->bitofs[cluster][which];
+}
+
+static void
+CM_FreeVisCache(void)
+{
+	if (viscache.rows)
+	{
+		Z_Free(viscache.rows);
+	}
+
+	if (viscache.rowslot)
+	{
+		Z_Free(viscache.rowslot);
+	}
+
+	memset(&viscache, 0, sizeof(viscache));
+}
+
+/*
+ * Expands the PVS and PHS rows of the current map. If all rows
+ * fit into map_viscache megabytes they're decompressed right
+ * away, otherwise as many rows as fit are kept in a LRU set.
+ */
+static void
+CM_BuildVisCache(void)
+{
+	size_t budget, needed;
+	int i, rowsize, numrows, sec_start;
+
+	budget = (size_t)(map_viscache->value > 0 ? map_viscache->value : 0) * 1024 * 1024;
+
+	if ((viscache.owner == cmod) && (viscache.budget == budget))
+	{
+		return;
+	}
+
+	CM_FreeVisCache();
+
+	if (!budget || !cmod->map_vis || (cmod->numclusters <= 0))
+	{
+		return;
+	}
+
+	sec_start = Sys_Milliseconds();
+
+	/* rows are or'ed together as int32_t in SV_FatPVS() */
+	rowsize = ((cmod->numclusters + 31) >> 5) << 2;
+	numrows = cmod->numclusters * 2;
+	needed = (size_t)numrows * rowsize;
+
+	viscache.owner = cmod;
+	viscache.budget = budget;
+	viscache.rowsize = rowsize;
+	viscache.numrows = numrows;
+
+	if (needed <= budget)
+	{
+		viscache.complete = true;
+		viscache.numslots = numrows;
+		viscache.rows = Z_Malloc(needed);
+
+		for (i = 0; i < numrows; i++)
+		{
+			CM_DecompressVis(CM_VisRowSource(i), viscache.rows + i * rowsize);
+		}
+	}
+	else
 	{
-		memset(pvsrow, 0, (cmod->numclusters + 7) >> 3);
+		viscache.numslots = budget / rowsize;
+
+		if (viscache.numslots < VISCACHE_MIN_SLOTS)
+		{
+			Com_DPrintf("%s: map_viscache too small for %d clusters\n",
+				__func__, cmod->numclusters);
+			memset(&viscache, 0, sizeof(viscache));
+			return;
+		}
+
+		viscache.rows = Z_Malloc(viscache.numslots * rowsize);
+
+		/* row -> slot, slot -> row, prev and next in one block */
+		viscache.rowslot = Z_Malloc((numrows + viscache.numslots * 3) * sizeof(int));
+		viscache.slotrow = viscache.rowslot + numrows;
+		viscache.slotprev = viscache.slotrow + viscache.numslots;
+		viscache.slotnext = viscache.slotprev + viscache.numslots;
+
+		for (i = 0; i < numrows; i++)
+		{
+			viscache.rowslot[i] = -1;
+		}
+
+		for (i = 0; i < viscache.numslots; i++)
+		{
+			viscache.slotrow[i] = -1;
+			viscache.slotprev[i] = i - 1;
+			viscache.slotnext[i] = i + 1;
+		}
+
+		viscache.slotnext[viscache.numslots - 1] = -1;
+		viscache.lruhead = 0;
+		viscache.lrutail = viscache.numslots - 1;
+	}
+
+	Com_DPrintf("%s: %s %d of %d vis rows, %d Kb in %.2fs\n",
+		__func__, viscache.complete ? "expanded" : "caching",
+		viscache.numslots, numrows, (viscache.numslots * rowsize) / 1024,
+		(Sys_Milliseconds() - sec_start) / 1000.0);
+}
+
+/*
+ * Returns the LRU slot of a row, decompressing it into the
+ * least recently used slot on a miss. Not reentrant.
+ */
+static byte *
+CM_VisCacheLookup(int row)
+{
+	int slot, prev, next;
+
+	slot = viscache.rowslot[row];
+
+	if (slot < 0)
+	{
+		slot = viscache.lrutail;
+
+		if (viscache.slotrow[slot] >= 0)
+		{
+			viscache.rowslot[viscache.slotrow[slot]] = -1;
+		}
+
+		viscache.slotrow[slot] = row;
+		viscache.rowslot[row] = slot;
+		CM_DecompressVis(CM_VisRowSource(row), viscache.rows + slot * viscache.rowsize);
+		viscache.misses++;
 	}
 	else
 	{
-		CM_DecompressVis((byte *)cmod->map_vis +
-				cmod->map_vis->bitofs[cluster][DVIS_PVS], pvsrow);
+		viscache.hits++;
 	}
 
-	return pvsrow;
+	if (slot != viscache.lruhead)
+	{
+		/* unlink, slot isn't the head so it has a predecessor */
+		prev = viscache.slotprev[slot];
+		next = viscache.slotnext[slot];
+
+		viscache.slotnext[prev] = next;
+
+		if (next != -1)
+		{
+			viscache.slotprev[next] = prev;
+		}
+		else
+		{
+			viscache.lrutail = prev;
+		}
+
+		/* and make it the most recently used one */
+		viscache.slotprev[slot] = -1;
+		viscache.slotnext[slot] = viscache.lruhead;
+		viscache.slotprev[viscache.lruhead] = slot;
+		viscache.lruhead = slot;
+	}
+
+	return viscache.rows + slot * viscache.rowsize;
 }
 
-byte *
-CM_ClusterPHS(int cluster)
+static const byte *
+CM_ClusterVis(int cluster, int which, byte *buffer, qboolean shared)
 {
+	int row;
+
 	if (cluster == -1 || !cmod->map_vis)
 	{
-		memset(phsrow, 0, (cmod->numclusters + 7) >> 3);
+		memset(buffer, 0, (cmod->numclusters + 7) >> 3);
+		return buffer;
 	}
 
-	else
+	row = which * cmod->numclusters + cluster;
+
+	if (viscache.owner == cmod)
+	{
+		if (viscache.complete)
+		{
+			return viscache.rows + row * viscache.rowsize;
+		}
+
+		if (!shared)
+		{
+			return CM_VisCacheLookup(row);
+		}
+	}
+
+	CM_DecompressVis(CM_VisRowSource(row), buffer);
+
+	return buffer;
+}
+
+/*
+ * The returned row stays valid until the next call
+ * of the same function.
+ */
+const byte *
+CM_ClusterPVS(int cluster)
+{
+	return CM_ClusterVis(cluster, DVIS_PVS, pvsrow, false);
+}
+
+const byte *
+CM_ClusterPHS(int cluster)
+{
+	return CM_ClusterVis(cluster, DVIS_PHS, phsrow, false);
+}
+
+/*
+ * Reentrant variants. Never touch shared state, buffer must hold
+ * MAX_MAP_LEAFS / 8 bytes and is only written to when the row
+ * isn't in the fully expanded vis cache.
+ */
+const byte *
+CM_ClusterPVSBuffer(int cluster, byte *buffer)
+{
+	return CM_ClusterVis(cluster, DVIS_PVS, buffer, true);
+}
+
+const byte *
+CM_ClusterPHSBuffer(int cluster, byte *buffer)
+{
+	return CM_ClusterVis(cluster, DVIS_PHS, buffer, true);
+}
+
+void
+CM_VisCacheStats_f(void)
+{
+	if (viscache.owner != cmod)
+	{
+		Com_Printf("Vis cache is empty.\n");
+		return;
+	}
+
+	Com_Printf("Vis cache: %d of %d rows (%s), %d Kb\n",
+		viscache.numslots, viscache.numrows,
+		viscache.complete ? "expanded" : "LRU",
+		(viscache.numslots * viscache.rowsize) / 1024);
+
+	if (!viscache.complete)
+	{
+		Com_Printf("%u hits, %u misses\n", viscache.hits, viscache.misses);
+	}
+}
+
+/*
+ * Records the input of every trace against the map into a
+ * file in the game dir, to be replayed by cm_tracebench.
+ */
+void
+CM_TraceRecord_f(void)
+{
+	tracefileheader_t header;
+	char name[MAX_OSPATH];
+
+	if (cm_tracefile)
+	{
+		fclose(cm_tracefile);
+		cm_tracefile = NULL;
+
+		Com_Printf("Stopped recording traces.\n");
+
+		if (Cmd_Argc() < 2)
+		{
+			return;
+		}
+	}
+
+	if (Cmd_Argc() != 2)
 	{
-		CM_DecompressVis((byte *)cmod->map_vis +
-				cmod->map_vis->bitofs[cluster][DVIS_PHS], phsrow);
+		Com_Printf("Usage: cm_tracerecord <file>, again to stop\n");
+		return;
 	}
 
-	return phsrow;
+	if (!cmod->numnodes)
+	{
+		Com_Printf("No map loaded.\n");
+		return;
+	}
+
+	Com_sprintf(name, sizeof(name), "%s/%s", FS_Gamedir(), Cmd_Argv(1));
+
+	if ((cm_tracefile = Q_fopen(name, "wb")) == NULL)
+	{
+		Com_Printf("Couldn't open %s for writing.\n", name);
+		return;
+	}
+
+	header.ident = CM_TRACEFILE_IDENT;
+	header.version = CM_TRACEFILE_VERSION;
+	header.checksum = cmod->checksum;
+	fwrite(&header, sizeof(header), 1, cm_tracefile);
+
+	Com_Printf("Recording traces to %s.\n", name);
 }
 
+static qboolean
+CM_TracesEqual(const trace_t *a, const trace_t *b)
+{
+	return (a->allsolid == b->allsolid) && (a->startsolid == b->startsolid) &&
+		!memcmp(&a->fraction, &b->fraction, sizeof(float)) &&
+		!memcmp(a->endpos, b->endpos, sizeof(vec3_t)) &&
+		!memcmp(a->plane.normal, b->plane.normal, sizeof(vec3_t)) &&
+		!memcmp(&a->plane.dist, &b->plane.dist, sizeof(float)) &&
+		(a->plane.type == b->plane.type) &&
+		(a->plane.signbits == b->plane.signbits) &&
+		(a->surface == b->surface) && (a->contents == b->contents);
+}
+
+/*
+ * Replays traces recorded with cm_tracerecord with the scalar
+ * and the SIMD brush kernels, times them and checks that both
+ * produce the same results.
+ */
+void
+CM_TraceBench_f(void)
+{
+	const tracefileheader_t *header;
+	const tracerecord_t *records;
+	trace_t *results;
+	long long start, time[2];
+	int i, j, k, count, length, runs, differ;
+	float saved;
+	byte *buf;
+
+	if ((Cmd_Argc() < 2) || (Cmd_Argc() > 3))
+	{
+		Com_Printf("Usage: cm_tracebench <file> [runs]\n");
+		return;
+	}
+
+	if (cm_tracefile)
+	{
+		Com_Printf("Stop recording first.\n");
+		return;
+	}
+
+	length = FS_LoadFile(Cmd_Argv(1), (void **)&buf);
+
+	if (!buf)
+	{
+		Com_Printf("Couldn't load %s.\n", Cmd_Argv(1));
+		return;
+	}
+
+	header = (const tracefileheader_t *)buf;
+
+	if ((length < sizeof(*header)) || (header->ident != CM_TRACEFILE_IDENT) ||
+		(header->version != CM_TRACEFILE_VERSION))
+	{
+		Com_Printf("%s is not a trace recording.\n", Cmd_Argv(1));
+		FS_FreeFile(buf);
+		return;
+	}
+
+	if (!cmod->numnodes || (header->checksum != cmod->checksum))
+	{
+		Com_Printf("%s was recorded on another map.\n", Cmd_Argv(1));
+		FS_FreeFile(buf);
+		return;
+	}
+
+	records = (const tracerecord_t *)(header + 1);
+	count = (length - sizeof(*header)) / sizeof(tracerecord_t);
+	runs = (Cmd_Argc() == 3) ? atoi(Cmd_Argv(2)) : 10;
+	runs = (runs < 1) ? 1 : runs;
+
+	if (!count)
+	{
+		Com_Printf("%s holds no traces.\n", Cmd_Argv(1));
+		FS_FreeFile(buf);
+		return;
+	}
+
+	results = Z_Malloc(count * sizeof(trace_t));
+	saved = cm_simd->value;
+	differ = 0;
+
+	/* 0 is the scalar reference, 1 the SIMD kernels */
+	for (k = 0; k < 2; k++)
+	{
+		cm_simd->value = k;
+		start = Sys_Microseconds();
+
+		for (j = 0; j < runs; j++)
+		{
+			for (i = 0; i < count; i++)
+			{
+				trace_t tr;
+
+				tr = CM_BoxTrace((float *)records[i].start, (float *)records[i].end,
+						(float *)records[i].mins, (float *)records[i].maxs,
+						records[i].headnode, records[i].brushmask);
+
+				if (k == 0)
+				{
+					results[i] = tr;
+				}
+				else if (!CM_TracesEqual(&results[i], &tr))
+				{
+					differ++;
+				}
+			}
+		}
+
+		time[k] = Sys_Microseconds() - start;
+	}
+
+	cm_simd->value = saved;
+
+	Com_Printf("%i traces, %i runs\n", count, runs);
+	Com_Printf("scalar: %lld usec, %.3f usec per trace\n", time[0],
+			(float)time[0] / (count * runs));
+#if defined(CM_SSE2) || defined(CM_NEON)
+	Com_Printf("%s: %lld usec, %.3f usec per trace\n",
+#if defined(CM_SSE2)
+			"sse2",
+#else
+			"neon",
+#endif
+			time[1], (float)time[1] / (count * runs));
+#else
+	Com_Printf("No SIMD kernels in this build.\n");
+#endif
+	Com_Printf("%i results differ\n", differ);
+
+	Z_Free(results);
+	FS_FreeFile(buf);
+}
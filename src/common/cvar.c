@@ -100,6 +100,118 @@ replacement_t replacements[] = {
 	{"vk_showtris", "r_showtris"}
 };
 
+/*
+ * Index of all cvars and the deprecated names above, so a
+ * lookup is a single probe. Open addressing with linear
+ * probing, cvars are never removed before Cvar_Fini().
+ * cvar_vars stays the sorted list for iteration.
+ */
+typedef struct
+{
+	const char *name;
+	unsigned hash;
+	cvar_t *var;
+	const char *replacement;
+} cvarindex_t;
+
+static cvarindex_t *cvar_index;
+static int cvar_indexsize;
+static int cvar_indexused;
+
+static unsigned
+Cvar_HashName(const char *name)
+{
+	unsigned hash = 2166136261u;
+
+	while (*name)
+	{
+		hash ^= (byte)*name++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static cvarindex_t *
+Cvar_IndexSlot(const char *name, unsigned hash)
+{
+	int i;
+
+	for (i = hash & (cvar_indexsize - 1); cvar_index[i].name;
+			i = (i + 1) & (cvar_indexsize - 1))
+	{
+		if ((cvar_index[i].hash == hash) && !strcmp(cvar_index[i].name, name))
+		{
+			break;
+		}
+	}
+
+	return &cvar_index[i];
+}
+
+static void
+Cvar_IndexInsert(const char *name, cvar_t *var, const char *replacement)
+{
+	cvarindex_t *slot;
+	unsigned hash;
+
+	/* keep it at most half full */
+	if ((cvar_indexused + 1) * 2 > cvar_indexsize)
+	{
+		cvarindex_t *old = cvar_index;
+		int oldsize = cvar_indexsize;
+		int i;
+
+		cvar_indexsize = oldsize ? oldsize * 2 : 512;
+		cvar_index = Z_Malloc(cvar_indexsize * sizeof(cvarindex_t));
+
+		for (i = 0; i < oldsize; i++)
+		{
+			if (old[i].name)
+			{
+				*Cvar_IndexSlot(old[i].name, old[i].hash) = old[i];
+			}
+		}
+
+		if (old)
+		{
+			Z_Free(old);
+		}
+	}
+
+	hash = Cvar_HashName(name);
+	slot = Cvar_IndexSlot(name, hash);
+
+	/* A cvar created under a deprecated name can't be
+	   looked up, just like it always was. */
+	if (slot->name)
+	{
+		return;
+	}
+
+	slot->name = name;
+	slot->hash = hash;
+	slot->var = var;
+	slot->replacement = replacement;
+	cvar_indexused++;
+}
+
+static cvarindex_t *
+Cvar_IndexLookup(const char *name)
+{
+	int i;
+
+	if (!cvar_index)
+	{
+		for (i = 0; i < sizeof(replacements) / sizeof(replacement_t); i++)
+		{
+			Cvar_IndexInsert(replacements[i].old, NULL, replacements[i].new);
+		}
+	}
+
+	return Cvar_IndexSlot(name, Cvar_HashName(name));
+}
+
 
 static qboolean
 Cvar_InfoValidate(const char *s)
@@ -125,29 +237,19 @@ Cvar_InfoValidate(const char *s)
 static cvar_t *
 Cvar_FindVar(const char *var_name)
 {
-	cvar_t *var;
-	int i;
+	cvarindex_t *slot;
+
+	slot = Cvar_IndexLookup(var_name);
 
 	/* An ugly hack to rewrite changed CVARs */
-	for (i = 0; i < sizeof(replacements) / sizeof(replacement_t); i++)
+	if (slot->replacement)
 	{
-		if (!strcmp(var_name, replacements[i].old))
-		{
-			Com_Printf("cvar %s is deprecated, use %s instead\n", replacements[i].old, replacements[i].new);
+		Com_Printf("cvar %s is deprecated, use %s instead\n", slot->name, slot->replacement);
 
-			var_name = replacements[i].new;
-		}
+		slot = Cvar_IndexLookup(slot->replacement);
 	}
 
-	for (var = cvar_vars; var; var = var->next)
-	{
-		if (!strcmp(var_name, var->name))
-		{
-			return var;
-		}
-	}
-
-	return NULL;
+	return slot->var;
 }
 
 static qboolean
@@ -290,6 +392,8 @@ Cvar_Get(const char *var_name, const char *var_value, int flags)
 	var->next = *pos;
 	*pos = var;
 
+	Cvar_IndexInsert(var->name, var, NULL);
+
 	var->flags = flags;
 
 	return var;
@@ -533,8 +637,9 @@ Cvar_Command(void)
 static void
 Cvar_Set_f(void)
 {
+	cvarindex_t *slot;
 	char *firstarg;
-	int c, i;
+	int c;
 
 	c = Cmd_Argc();
 
@@ -547,12 +652,11 @@ Cvar_Set_f(void)
 	firstarg = Cmd_Argv(1);
 
 	/* An ugly hack to rewrite changed CVARs */
-	for (i = 0; i < sizeof(replacements) / sizeof(replacement_t); i++)
+	slot = Cvar_IndexLookup(firstarg);
+
+	if (slot->replacement)
 	{
-		if (!strcmp(firstarg, replacements[i].old))
-		{
-			firstarg = replacements[i].new;
-		}
+		firstarg = (char *)slot->replacement;
 	}
 
 	if (c == 4)
@@ -903,6 +1007,16 @@ Cvar_Fini(void)
 		var = c;
 	}
 
+	cvar_vars = NULL;
+
+	if (cvar_index)
+	{
+		Z_Free(cvar_index);
+		cvar_index = NULL;
+		cvar_indexsize = 0;
+		cvar_indexused = 0;
+	}
+
 	Cmd_RemoveCommand("cvarlist");
 	Cmd_RemoveCommand("dec");
 	Cmd_RemoveCommand("inc");
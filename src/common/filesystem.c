@@ -25,6 +25,8 @@
  * =======================================================================
  */
 
+#include <ctype.h>
+
 #ifndef _MSC_VER
 #include <libgen.h>
 #endif
@@ -51,6 +53,8 @@ typedef struct
 	fsMode_t mode;
 	FILE *file;           /* Only one will be used. */
 	unzFile *zip;        /* (file or zip) */
+	const char *mapPath;  /* Pack holding the data uncompressed, */
+	size_t mapOffset;     /* or NULL. Used by FS_LoadFileReadOnly(). */
 } fsHandle_t;
 
 typedef struct fsLink_s
@@ -76,6 +80,9 @@ typedef struct
 	unzFile *pk3;
 	qboolean isProtectedPak;
 	fsPackFile_t *files;
+	int *hashHeads;  /* hashMask + 1 buckets, first file or -1 */
+	int *hashNext;   /* numFiles entries, next file or -1 */
+	unsigned hashMask;
 } fsPack_t;
 
 typedef struct fsSearchPath_s
@@ -85,6 +92,37 @@ typedef struct fsSearchPath_s
 	struct fsSearchPath_s *next;
 } fsSearchPath_t;
 
+/* The pack that wins for a file name, over the whole search path. */
+typedef struct
+{
+	fsSearchPath_t *search;
+	int file;
+	unsigned hash;
+	int next;
+} fsIndexEntry_t;
+
+/* A file name that's in no pack and in no directory. */
+typedef struct
+{
+	char name[MAX_QPATH];
+	unsigned hash;
+	int next;
+} fsMissEntry_t;
+
+#define FS_MISS_ENTRIES 2048
+#define FS_MISS_BUCKETS 1024
+
+/* A file returned by FS_LoadFile() that's mapped from a pack. */
+typedef struct
+{
+	void *data;
+	void *base;
+	size_t length;
+} fsMapping_t;
+
+#define MAX_MAPPINGS 256
+#define FS_MAP_MINSIZE (64 * 1024)
+
 typedef enum
 {
 	PAK,
@@ -119,9 +157,28 @@ cvar_t *fs_basedir;
 cvar_t *fs_cddir;
 cvar_t *fs_gamedirvar;
 cvar_t *fs_debug;
+cvar_t *fs_mmap;
+
+static fsMapping_t fs_mappings[MAX_MAPPINGS];
+static int fs_numMappings;
 
 fsHandle_t *FS_GetFileByHandle(fileHandle_t f);
 
+/* Bumped whenever the search path changes, invalidates
+   the global index and the negative lookup cache. */
+static unsigned fs_searchGeneration = 1;
+
+static unsigned fs_indexGeneration;
+static fsIndexEntry_t *fs_index;
+static int *fs_indexHeads;
+static unsigned fs_indexMask;
+
+static unsigned fs_missGeneration;
+static fsMissEntry_t *fs_misses;
+static int fs_missHeads[FS_MISS_BUCKETS];
+static int fs_numMisses;
+static unsigned fs_missHits;
+
 // --------
 
 // Raw search path, the actual search
@@ -366,6 +423,243 @@ FS_FCloseFile(fileHandle_t f)
 	memset(handle, 0, sizeof(*handle));
 }
 
+/*
+ * Case insensitive FNV-1a, pack lookups ignore the case.
+ */
+static unsigned
+FS_HashName(const char *name)
+{
+	unsigned hash = 2166136261u;
+
+	while (*name)
+	{
+		hash ^= (unsigned char)tolower((unsigned char)*name++);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static unsigned
+FS_HashSize(int count)
+{
+	unsigned size = 16;
+
+	while (size < (unsigned)count)
+	{
+		size <<= 1;
+	}
+
+	return size;
+}
+
+/*
+ * Builds the hash index of a pack. Files are inserted
+ * back to front, so the chains keep the directory order
+ * and the first of several files with the same name wins.
+ */
+static void
+FS_HashPack(fsPack_t *pack)
+{
+	unsigned bucket, size;
+	int i;
+
+	size = FS_HashSize(pack->numFiles);
+
+	pack->hashMask = size - 1;
+	pack->hashHeads = Z_Malloc((size + pack->numFiles) * sizeof(int));
+	pack->hashNext = pack->hashHeads + size;
+
+	memset(pack->hashHeads, -1, size * sizeof(int));
+
+	for (i = pack->numFiles - 1; i >= 0; i--)
+	{
+		bucket = FS_HashName(pack->files[i].name) & pack->hashMask;
+
+		pack->hashNext[i] = pack->hashHeads[bucket];
+		pack->hashHeads[bucket] = i;
+	}
+}
+
+static int
+FS_FindInPack(const fsPack_t *pack, const char *name, unsigned hash)
+{
+	int i;
+
+	for (i = pack->hashHeads[hash & pack->hashMask]; i != -1; i = pack->hashNext[i])
+	{
+		if (Q_stricmp(pack->files[i].name, name) == 0)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*
+ * (Re)builds the global index if the search path has changed
+ * since it was last built. Every name points to the first pack
+ * in search order holding it.
+ */
+static void
+FS_BuildIndex(void)
+{
+	fsSearchPath_t *search;
+	fsIndexEntry_t *entry;
+	fsPack_t *pack;
+	int i, j, total, count;
+	unsigned hash, size;
+
+	if (fs_indexGeneration == fs_searchGeneration)
+	{
+		return;
+	}
+
+	if (fs_index)
+	{
+		Z_Free(fs_index);
+		fs_index = NULL;
+	}
+
+	total = 0;
+
+	for (search = fs_searchPaths; search; search = search->next)
+	{
+		if (search->pack)
+		{
+			total += search->pack->numFiles;
+		}
+	}
+
+	size = FS_HashSize(total);
+
+	/* entries and buckets in one block */
+	fs_index = Z_Malloc(total * sizeof(fsIndexEntry_t) + size * sizeof(int));
+	fs_indexHeads = (int *)(fs_index + total);
+	fs_indexMask = size - 1;
+	memset(fs_indexHeads, -1, size * sizeof(int));
+
+	count = 0;
+
+	for (search = fs_searchPaths; search; search = search->next)
+	{
+		if (!search->pack)
+		{
+			continue;
+		}
+
+		pack = search->pack;
+
+		for (i = 0; i < pack->numFiles; i++)
+		{
+			hash = FS_HashName(pack->files[i].name);
+
+			/* an earlier pack or an earlier file in this one wins */
+			for (j = fs_indexHeads[hash & fs_indexMask]; j != -1; j = fs_index[j].next)
+			{
+				if ((fs_index[j].hash == hash) &&
+					(Q_stricmp(fs_index[j].search->pack->files[fs_index[j].file].name,
+							   pack->files[i].name) == 0))
+				{
+					break;
+				}
+			}
+
+			if (j != -1)
+			{
+				continue;
+			}
+
+			entry = &fs_index[count];
+			entry->search = search;
+			entry->file = i;
+			entry->hash = hash;
+			entry->next = fs_indexHeads[hash & fs_indexMask];
+			fs_indexHeads[hash & fs_indexMask] = count;
+			count++;
+		}
+	}
+
+	fs_indexGeneration = fs_searchGeneration;
+
+	FS_DPrintf("FS_BuildIndex: %i unique files in %i pack files.\n", count, total);
+}
+
+static const fsIndexEntry_t *
+FS_FindInIndex(const char *name, unsigned hash)
+{
+	int i;
+
+	FS_BuildIndex();
+
+	for (i = fs_indexHeads[hash & fs_indexMask]; i != -1; i = fs_index[i].next)
+	{
+		if ((fs_index[i].hash == hash) &&
+			(Q_stricmp(fs_index[i].search->pack->files[fs_index[i].file].name, name) == 0))
+		{
+			return &fs_index[i];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Negative lookup cache. Remembers names that weren't found
+ * anywhere, so repeated probes for optional files (replacement
+ * textures, alternative model formats) don't hit the disk over
+ * and over again. The engine writes only into fs_gamedir, so it
+ * is still checked for a remembered miss.
+ */
+static qboolean
+FS_IsKnownMiss(const char *name, unsigned hash)
+{
+	int i;
+
+	if (fs_missGeneration != fs_searchGeneration)
+	{
+		return false;
+	}
+
+	for (i = fs_missHeads[hash & (FS_MISS_BUCKETS - 1)]; i != -1; i = fs_misses[i].next)
+	{
+		if ((fs_misses[i].hash == hash) && (strcmp(fs_misses[i].name, name) == 0))
+		{
+			fs_missHits++;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void
+FS_AddMiss(const char *name, unsigned hash)
+{
+	fsMissEntry_t *entry;
+
+	if (!fs_misses)
+	{
+		fs_misses = Z_Malloc(FS_MISS_ENTRIES * sizeof(fsMissEntry_t));
+	}
+
+	/* start over if stale or full */
+	if ((fs_missGeneration != fs_searchGeneration) || (fs_numMisses == FS_MISS_ENTRIES))
+	{
+		memset(fs_missHeads, -1, sizeof(fs_missHeads));
+		fs_numMisses = 0;
+		fs_missGeneration = fs_searchGeneration;
+	}
+
+	entry = &fs_misses[fs_numMisses];
+	Q_strlcpy(entry->name, name, sizeof(entry->name));
+	entry->hash = hash;
+	entry->next = fs_missHeads[hash & (FS_MISS_BUCKETS - 1)];
+	fs_missHeads[hash & (FS_MISS_BUCKETS - 1)] = fs_numMisses;
+	fs_numMisses++;
+}
+
 /*
  * Finds the file in the search path. Returns filesize and an open FILE *. Used
  * for streaming data out of either a pak file or a seperate file.
@@ -377,6 +671,9 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 	fsHandle_t *handle;
 	fsPack_t *pack;
 	fsSearchPath_t *search;
+	const fsIndexEntry_t *winner;
+	qboolean knownMiss, pastWinner;
+	unsigned hash;
 	int i;
 
 	// Remove self references and empty dirs from the requested path.
@@ -435,14 +732,29 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 	handle = FS_HandleForFile(name, f);
 	Q_strlcpy(handle->name, name, sizeof(handle->name));
 	handle->mode = FS_READ;
+	handle->mapPath = NULL;
+
+	hash = FS_HashName(handle->name);
+	knownMiss = FS_IsKnownMiss(handle->name, hash);
+
+	/* Packs before the winner don't have the file. If the
+	   winner is skipped, the remaining ones are asked. */
+	winner = knownMiss ? NULL : FS_FindInIndex(handle->name, hash);
+	pastWinner = false;
 
 	/* Search through the path, one element at a time. */
 	for (search = fs_searchPaths; search; search = search->next)
 	{
+		if (knownMiss && (search->pack || strcmp(search->path, fs_gamedir)))
+		{
+			continue;
+		}
+
 		if (gamedir_only)
 		{
 			if (strstr(search->path, FS_Gamedir()) == NULL)
 			{
+				pastWinner |= (winner && (winner->search == search));
 				continue;
 			}
 		}
@@ -451,6 +763,7 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 		// TODO: A flag to ignore paks would be better
 		if ((strcmp(fs_gamedirvar->string, "") == 0) && search->pack) {
 			if ((strcmp(name, "maps.lst") == 0)|| (strncmp(name, "players/", 8) == 0)) {
+				pastWinner |= (winner && (winner->search == search));
 				continue;
 			}
 		}
@@ -460,68 +773,93 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 		{
 			pack = search->pack;
 
-			for (i = 0; i < pack->numFiles; i++)
+			if (pastWinner)
+			{
+				i = FS_FindInPack(pack, handle->name, hash);
+			}
+			else if (winner && (winner->search == search))
+			{
+				i = winner->file;
+			}
+			else
+			{
+				i = -1;
+			}
+
+			if (i != -1)
 			{
-				if (Q_stricmp(pack->files[i].name, handle->name) == 0)
+				/* Found it! */
+				if (fs_debug->value)
+				{
+					Com_Printf("FS_FOpenFile: '%s' (found in '%s').\n",
+					           handle->name, pack->name);
+				}
+
+				// save the name with *correct case* in the handle
+				// (relevant for savegames, when starting map with wrong case but it's still found
+				//  because it's from pak, but save/bla/MAPname.sav/sv2 will have wrong case and can't be found then)
+				Q_strlcpy(handle->name, pack->files[i].name, sizeof(handle->name));
+
+				if (pack->pak)
 				{
-					/* Found it! */
-					if (fs_debug->value)
+					/* PAK */
+					if (pack->isProtectedPak)
 					{
-						Com_Printf("FS_FOpenFile: '%s' (found in '%s').\n",
-						           handle->name, pack->name);
+						file_from_protected_pak = true;
 					}
 
-					// save the name with *correct case* in the handle
-					// (relevant for savegames, when starting map with wrong case but it's still found
-					//  because it's from pak, but save/bla/MAPname.sav/sv2 will have wrong case and can't be found then)
-					Q_strlcpy(handle->name, pack->files[i].name, sizeof(handle->name));
+					handle->file = Q_fopen(pack->name, "rb");
 
-					if (pack->pak)
+					if (handle->file)
 					{
-						/* PAK */
-						if (pack->isProtectedPak)
-						{
-							file_from_protected_pak = true;
-						}
+						fseek(handle->file, pack->files[i].offset, SEEK_SET);
 
-						handle->file = Q_fopen(pack->name, "rb");
+						handle->mapPath = pack->name;
+						handle->mapOffset = pack->files[i].offset;
 
-						if (handle->file)
-						{
-							fseek(handle->file, pack->files[i].offset, SEEK_SET);
-							return pack->files[i].size;
-						}
+						return pack->files[i].size;
 					}
-					else if (pack->pk3)
+				}
+				else if (pack->pk3)
+				{
+					/* PK3 */
+					if (pack->isProtectedPak)
 					{
-						/* PK3 */
-						if (pack->isProtectedPak)
-						{
-							file_from_protected_pak = true;
-						}
+						file_from_protected_pak = true;
+					}
 
 #ifdef _WIN32
-						handle->zip = unzOpen2(pack->name, &zlib_file_api);
+					handle->zip = unzOpen2(pack->name, &zlib_file_api);
 #else
-						handle->zip = unzOpen(pack->name);
+					handle->zip = unzOpen(pack->name);
 #endif
 
-						if (handle->zip)
+					if (handle->zip)
+					{
+						if (unzLocateFile(handle->zip, handle->name, 2) == UNZ_OK)
 						{
-							if (unzLocateFile(handle->zip, handle->name, 2) == UNZ_OK)
+							if (unzOpenCurrentFile(handle->zip) == UNZ_OK)
 							{
-								if (unzOpenCurrentFile(handle->zip) == UNZ_OK)
+								unz_file_info info;
+
+								/* stored and not encrypted, can be mapped */
+								if ((unzGetCurrentFileInfo(handle->zip, &info,
+										NULL, 0, NULL, 0, NULL, 0) == UNZ_OK) &&
+									(info.compression_method == 0) && !(info.flag & 1))
 								{
-									return pack->files[i].size;
+									handle->mapPath = pack->name;
+									handle->mapOffset = unzGetCurrentFileZStreamPos64(handle->zip);
 								}
-							}
 
-							unzClose(handle->zip);
+								return pack->files[i].size;
+							}
 						}
-					}
 
-					Com_Error(ERR_FATAL, "Couldn't reopen '%s'", pack->name);
+						unzClose(handle->zip);
+					}
 				}
+
+				Com_Error(ERR_FATAL, "Couldn't reopen '%s'", pack->name);
 			}
 		}
 		else
@@ -556,6 +894,12 @@ FS_FOpenFile(const char *rawname, fileHandle_t *f, qboolean gamedir_only)
 		Com_Printf("FS_FOpenFile: couldn't find '%s'.\n", handle->name);
 	}
 
+	/* Only complete searches prove that the file doesn't exist. */
+	if (!gamedir_only && !knownMiss)
+	{
+		FS_AddMiss(handle->name, hash);
+	}
+
 	/* Couldn't open, so free the handle. */
 	memset(handle, 0, sizeof(*handle));
 	*f = 0;
@@ -692,11 +1036,48 @@ FS_FRead(void *buffer, int size, int count, fileHandle_t f)
 }
 
 /*
- * Filename are reletive to the quake search path. A null buffer will just
- * return the file length without loading.
+ * Maps an open file straight out of its pack instead of
+ * reading it into a buffer. Only the pages touched by the
+ * caller are read and several processes loading the same
+ * file share the page cache. The mapping is read only and
+ * only files starting at a pointer aligned offset inside
+ * the pack are mapped, everything else is read.
  */
-int
-FS_LoadFile(const char *path, void **buffer)
+static void *
+FS_MapFile(fileHandle_t f, int size)
+{
+	fsHandle_t *handle;
+	fsMapping_t *mapping;
+	void *data;
+
+	handle = FS_GetFileByHandle(f);
+
+	if (!fs_mmap->value || !handle->mapPath || (size < FS_MAP_MINSIZE) ||
+		(handle->mapOffset % sizeof(void *)) ||
+		(fs_numMappings == MAX_MAPPINGS))
+	{
+		return NULL;
+	}
+
+	mapping = &fs_mappings[fs_numMappings];
+	data = Sys_MapFile(handle->mapPath, handle->mapOffset, size,
+			&mapping->base, &mapping->length);
+
+	if (!data)
+	{
+		return NULL;
+	}
+
+	mapping->data = data;
+	fs_numMappings++;
+
+	FS_DPrintf("FS_MapFile: '%s' mapped from '%s'.\n", handle->name, handle->mapPath);
+
+	return data;
+}
+
+static int
+FS_LoadFileInternal(const char *path, void **buffer, qboolean readonly)
 {
 	byte *buf; /* Buffer. */
 	int size; /* File size. */
@@ -721,6 +1102,14 @@ FS_LoadFile(const char *path, void **buffer)
 		return size;
 	}
 
+	if (readonly && ((buf = FS_MapFile(f, size)) != NULL))
+	{
+		*buffer = buf;
+		FS_FCloseFile(f);
+
+		return size;
+	}
+
 	buf = Z_Malloc(size);
 	*buffer = buf;
 
@@ -730,15 +1119,49 @@ FS_LoadFile(const char *path, void **buffer)
 	return size;
 }
 
+/*
+ * Filename are reletive to the quake search path. A null buffer will just
+ * return the file length without loading.
+ */
+int
+FS_LoadFile(const char *path, void **buffer)
+{
+	return FS_LoadFileInternal(path, buffer, false);
+}
+
+/*
+ * Like FS_LoadFile(), but the caller promises not to write
+ * into the buffer. Large files may then be memory mapped
+ * read only instead of being copied. Free with FS_FreeFile().
+ */
+int
+FS_LoadFileReadOnly(const char *path, const void **buffer)
+{
+	return FS_LoadFileInternal(path, (void **)buffer, true);
+}
+
 void
 FS_FreeFile(void *buffer)
 {
+	int i;
+
 	if (buffer == NULL)
 	{
 		FS_DPrintf("FS_FreeFile: NULL buffer.\n");
 		return;
 	}
 
+	for (i = 0; i < fs_numMappings; i++)
+	{
+		if (fs_mappings[i].data == buffer)
+		{
+			Sys_UnmapFile(fs_mappings[i].base, fs_mappings[i].length);
+			fs_mappings[i] = fs_mappings[--fs_numMappings];
+
+			return;
+		}
+	}
+
 	Z_Free(buffer);
 }
 
@@ -778,6 +1201,7 @@ FS_FreeSearchPaths(fsSearchPath_t *start, fsSearchPath_t *end)
 				unzClose(cur->pack->pk3);
 			}
 
+			Z_Free(cur->pack->hashHeads);
 			Z_Free(cur->pack->files);
 			Z_Free(cur->pack);
 		}
@@ -787,6 +1211,8 @@ FS_FreeSearchPaths(fsSearchPath_t *start, fsSearchPath_t *end)
 		cur = next;
 	}
 
+	fs_searchGeneration++;
+
 	return cur;
 }
 
@@ -867,6 +1293,7 @@ FS_LoadPAK(const char *packPath)
 	pack->pk3 = NULL;
 	pack->numFiles = numFiles;
 	pack->files = files;
+	FS_HashPack(pack);
 
 	Com_Printf("Added packfile '%s' (%i files).\n", pack->name, numFiles);
 
@@ -941,6 +1368,7 @@ FS_LoadPK3(const char *packPath)
 	pack->pk3 = handle;
 	pack->numFiles = numFiles;
 	pack->files = files;
+	FS_HashPack(pack);
 
 	Com_Printf("Added packfile '%s' (%i files).\n", pack->name, numFiles);
 
@@ -1032,6 +1460,17 @@ FS_Path_f(void)
 	Com_Printf("----------------------\n");
 
 	Com_Printf("%i files in PAK/PK2/PK3/ZIP files.\n", totalFiles);
+
+	if (fs_numMappings)
+	{
+		Com_Printf("%i files mapped from packs.\n", fs_numMappings);
+	}
+
+	if (fs_missGeneration == fs_searchGeneration)
+	{
+		Com_Printf("%i missing files cached, %u lookups saved.\n",
+				fs_numMisses, fs_missHits);
+	}
 }
 
 /*
@@ -1624,6 +2063,7 @@ FS_AddPAKFromGamedir(const char *pak)
 			search->pack = pakfile;
 			search->next = fs_searchPaths;
 			fs_searchPaths = search;
+			fs_searchGeneration++;
 
 			return true;
 		}
@@ -1708,6 +2148,7 @@ FS_AddDirToSearchPath(char *dir, qboolean create) {
 	Q_strlcpy(search->path, dir, sizeof(search->path));
 	search->next = fs_searchPaths;
 	fs_searchPaths = search;
+	fs_searchGeneration++;
 
 
 	// Numbered paks contain the official game data, they
@@ -1751,6 +2192,7 @@ FS_AddDirToSearchPath(char *dir, qboolean create) {
 			search->pack = pack;
 			search->next = fs_searchPaths;
 			fs_searchPaths = search;
+			fs_searchGeneration++;
 		}
 	}
 
@@ -1821,6 +2263,7 @@ FS_AddDirToSearchPath(char *dir, qboolean create) {
 			search->pack = pack;
 			search->next = fs_searchPaths;
 			fs_searchPaths = search;
+			fs_searchGeneration++;
 		}
 
 		FS_FreeList(list, nfiles);
@@ -2115,6 +2558,7 @@ FS_InitFilesystem(void)
 	fs_cddir = Cvar_Get("cddir", "", CVAR_NOSET);
 	fs_gamedirvar = Cvar_Get("game", "", CVAR_LATCH | CVAR_SERVERINFO);
 	fs_debug = Cvar_Get("fs_debug", "0", 0);
+	fs_mmap = Cvar_Get("fs_mmap", "1", CVAR_ARCHIVE);
 
 	// Deprecation warning, can be removed at a later time.
 	if (strcmp(fs_basedir->string, ".") != 0)
@@ -204,7 +204,13 @@ Qcommon_Mainloop(void)
 			}
 		}
 #else
-		Sys_Nanosleep(850000);
+		/* a running server waits in NET_Sleep() for
+		   its next frame or the next packet, or in
+		   Qcommon_Frame() for its next packet frame */
+		if (!Com_ServerState())
+		{
+			Sys_Nanosleep(850000);
+		}
 #endif
 
 		newtime = Sys_Microseconds();
@@ -355,6 +361,16 @@ Qcommon_Init(int argc, char **argv)
 	// Zone malloc statistics.
 	Cmd_AddCommand("z_stats", Z_Stats_f);
 
+	// Decompressed PVS / PHS statistics.
+	Cmd_AddCommand("cm_visstats", CM_VisCacheStats_f);
+
+	// Collision benchmark.
+	Cmd_AddCommand("cm_tracerecord", CM_TraceRecord_f);
+	Cmd_AddCommand("cm_tracebench", CM_TraceBench_f);
+
+	// Frame profiler.
+	Prof_Init();
+
 	// cvars
 
 	cl_maxfps = Cvar_Get("cl_maxfps", "-1", CVAR_ARCHIVE);
@@ -683,8 +699,12 @@ Qcommon_Frame(int usec)
 
 	// Run the serverframe.
 	if (packetframe) {
+		long long profstart = Prof_Begin();
+
 		SV_Frame(servertimedelta);
 		servertimedelta = 0;
+
+		Prof_End(PROF_SV_FRAME, profstart);
 	}
 
 
@@ -696,8 +716,12 @@ Qcommon_Frame(int usec)
 
 	// Run the client frame.
 	if (packetframe || renderframe) {
+		long long profstart = Prof_Begin();
+
 		CL_Frame(packetdelta, renderdelta, clienttimedelta, packetframe, renderframe);
 		clienttimedelta = 0;
+
+		Prof_End(PROF_CL_FRAME, profstart);
 	}
 
 
@@ -808,11 +832,23 @@ Qcommon_Frame(int usec)
 
 	// Run the serverframe.
 	if (packetframe) {
+		long long profstart = Prof_Begin();
+
 		SV_Frame(servertimedelta);
 		servertimedelta = 0;
 
+		Prof_End(PROF_SV_FRAME, profstart);
+
 		// Reset deltas if necessary.
 		packetdelta = 0;
+	} else if (pfps > 0) {
+		// Wait for the next packetframe. Packets are only
+		// read by SV_Frame(), waking up for them would spin.
+		int sleep = (int)(1000000.0f / pfps) - packetdelta;
+
+		if (sleep > 0) {
+			Sys_Nanosleep(sleep * 1000);
+		}
 	}
 }
 #endif
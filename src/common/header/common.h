@@ -29,6 +29,8 @@
 #ifndef CO_COMMON_H
 #define CO_COMMON_H
 
+#include <setjmp.h>
+
 #include "shared.h"
 #include "crc.h"
 
@@ -559,12 +561,29 @@ qboolean NET_GetPacket(netsrc_t sock, netadr_t *net_from,
 		sizebuf_t *net_message);
 void NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to);
 
+/* parts of a datagram, gathered by the
+   socket layer instead of copied together */
+#define NET_MAXIOV 4
+
+typedef struct
+{
+	const void *data;
+	int length;
+} netiov_t;
+
+void NET_SendPacketv(netsrc_t sock, const netiov_t *iov, int count, netadr_t to);
+
+/* queues the server datagrams in between and sends
+   them at once, where the platform supports it */
+void NET_BeginSendBatch(void);
+void NET_FlushSendBatch(void);
+
 qboolean NET_CompareAdr(netadr_t a, netadr_t b);
 qboolean NET_CompareBaseAdr(netadr_t a, netadr_t b);
 qboolean NET_IsLocalAddress(netadr_t adr);
 char *NET_AdrToString(netadr_t a);
 qboolean NET_StringToAdr(const char *s, netadr_t *a);
-void NET_Sleep(int msec);
+void NET_Sleep(int usec);
 
 /*=================================================================== */
 
@@ -600,9 +619,12 @@ typedef struct
 	sizebuf_t message;          /* writing buffer to send to server */
 	byte message_buf[MAX_MSGLEN - 16];          /* leave space for header */
 
-	/* message is copied to this buffer when it is first transfered */
+	/* unacked reliable message. When the message is first
+	   transfered message_buf and reliable_buf swap roles,
+	   reliable_data points to the one holding it. */
 	int reliable_length;
-	byte reliable_buf[MAX_MSGLEN - 16];         /* unacked reliable message */
+	byte reliable_buf[MAX_MSGLEN - 16];
+	byte *reliable_data;
 } netchan_t;
 
 extern netadr_t net_from;
@@ -649,8 +671,16 @@ trace_t CM_TransformedBoxTrace(vec3_t start, vec3_t end,
 		vec3_t mins, vec3_t maxs, int headnode,
 		int brushmask, vec3_t origin, vec3_t angles);
 
-byte *CM_ClusterPVS(int cluster);
-byte *CM_ClusterPHS(int cluster);
+const byte *CM_ClusterPVS(int cluster);
+const byte *CM_ClusterPHS(int cluster);
+
+/* reentrant, buffer must hold MAX_MAP_LEAFS / 8 bytes */
+const byte *CM_ClusterPVSBuffer(int cluster, byte *buffer);
+const byte *CM_ClusterPHSBuffer(int cluster, byte *buffer);
+
+void CM_VisCacheStats_f(void);
+void CM_TraceRecord_f(void);
+void CM_TraceBench_f(void);
 
 int CM_PointLeafnum(vec3_t p);
 
@@ -667,7 +697,7 @@ void CM_SetAreaPortalState(int portalnum, qboolean open);
 qboolean CM_AreasConnected(int area1, int area2);
 
 int CM_WriteAreaBits(byte *buffer, int area);
-qboolean CM_HeadnodeVisible(int headnode, byte *visbits);
+qboolean CM_HeadnodeVisible(int headnode, const byte *visbits);
 
 void CM_WritePortalState(FILE *f);
 
@@ -677,6 +707,30 @@ extern float pm_airaccelerate;
 
 void Pmove(pmove_t *pmove);
 
+/* PROFILER */
+
+typedef enum
+{
+	PROF_SV_FRAME,
+	PROF_SV_READPACKETS,
+	PROF_G_RUNFRAME,
+	PROF_SV_SENDMESSAGES,
+	PROF_CM_BOXTRACE,
+	PROF_CL_FRAME,
+	PROF_S_UPDATE,
+	PROF_RE_RENDERFRAME,
+	PROF_RE_ENDFRAME,
+	PROF_NUMZONES
+} profzone_t;
+
+void Prof_Init(void);
+
+/* returns 0 when not recording, pass the
+   result to Prof_End() to close the zone */
+long long Prof_Begin(void);
+long long Prof_BeginDetail(void); /* for frequent zones, only with prof_record 2 */
+void Prof_End(int zone, long long start);
+
 /* FILESYSTEM */
 
 #define SFF_INPACK 0x20
@@ -728,6 +782,7 @@ void FS_BuildGameSpecificSearchPath(const char *dir);
 char *FS_Gamedir(void);
 char *FS_NextPath(const char *prevpath);
 int FS_LoadFile(const char *path, void **buffer);
+int FS_LoadFileReadOnly(const char *path, const void **buffer);
 qboolean FS_FileInGamedir(const char *file);
 qboolean FS_AddPAKFromGamedir(const char *pak);
 const char* FS_GetNextRawPath(const char* lastRawPath);
@@ -756,6 +811,22 @@ void FS_CreatePath(char *path);
 
 void Com_BeginRedirect(int target, char *buffer, int buffersize, void (*flush)(int, char *));
 void Com_EndRedirect(void);
+
+/* Jobs on worker threads must neither print to the console nor
+   longjmp out of the frame. Between Com_BeginDeferred() and
+   Com_EndDeferred() prints are collected and an error jumps back
+   to abort, Com_FlushDeferred() replays both on the main thread. */
+typedef struct
+{
+	jmp_buf abort;
+	int error; /* -1 for none */
+	char errormsg[256];
+	char text[1024];
+} comdeferred_t;
+
+void Com_BeginDeferred(comdeferred_t *deferred);
+void Com_EndDeferred(void);
+void Com_FlushDeferred(comdeferred_t *deferred);
 void Com_Printf(const char *fmt, ...) PRINTF_ATTR(1, 2);
 void Com_DPrintf(const char *fmt, ...) PRINTF_ATTR(1, 2);
 void Com_VPrintf(int print_level, const char *fmt, va_list argptr); /* print_level is PRINT_ALL or PRINT_DEVELOPER */
@@ -872,6 +943,9 @@ void Sys_UnloadGame(void);
 void Sys_GetWorkDir(char *buffer, size_t len);
 qboolean Sys_SetWorkDir(char *path);
 qboolean Sys_Realpath(const char *in, char *out, size_t size);
+void *Sys_MapFile(const char *path, size_t offset, size_t length,
+		void **base, size_t *maplength);
+void Sys_UnmapFile(void *base, size_t maplength);
 
 // Windows only (system.c)
 #ifdef _WIN32
@@ -879,6 +953,26 @@ void Sys_RedirectStdout(void);
 void Sys_SetHighDPIMode(void);
 #endif
 
+// thread.c
+#define SYS_MAX_WORKERS 32
+
+/* thread is 0 for the calling thread, 1 to Sys_NumWorkers() for workers */
+typedef void (*sysjob_t)(void *data, int index, int thread);
+
+/* the pool is shared, it's sized for the largest request */
+enum
+{
+	SYS_WORKERS_SERVER,
+	SYS_WORKERS_RENDERER,
+	SYS_WORKERS_NUMUSERS
+};
+
+int Sys_NumCores(void);
+int Sys_NumWorkers(void);
+int Sys_ThreadIndex(void); /* 0 on the main thread, the thread argument of jobs on workers */
+void Sys_StartWorkers(int user, int count);
+void Sys_RunParallel(sysjob_t func, void *data, int count);
+
 // misc.c
 const char *Sys_GetBinaryDir(void);
 void Sys_SetupFPU(void);
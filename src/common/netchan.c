@@ -130,16 +130,26 @@ void
 Netchan_OutOfBand(int net_socket, netadr_t adr, int length, byte *data)
 {
 	sizebuf_t send;
-	byte send_buf[MAX_MSGLEN];
+	byte send_buf[4];
+	netiov_t iov[2];
+
+	if (length > MAX_MSGLEN - 4)
+	{
+		Com_Error(ERR_FATAL, "Netchan_OutOfBand: overflow");
+	}
 
 	/* write the packet header */
 	SZ_Init(&send, send_buf, sizeof(send_buf));
 
 	MSG_WriteLong(&send, -1); /* -1 sequence means out of band */
-	SZ_Write(&send, data, length);
 
-	/* send the datagram */
-	NET_SendPacket(net_socket, send.cursize, send.data, adr);
+	/* send the datagram, the payload isn't copied */
+	iov[0].data = send.data;
+	iov[0].length = send.cursize;
+	iov[1].data = data;
+	iov[1].length = length;
+
+	NET_SendPacketv(net_socket, iov, 2, adr);
 }
 
 /*
@@ -175,6 +185,7 @@ Netchan_Setup(netsrc_t sock, netchan_t *chan, netadr_t adr, int qport)
 
 	SZ_Init(&chan->message, chan->message_buf, sizeof(chan->message_buf));
 	chan->message.allowoverflow = true;
+	chan->reliable_data = chan->reliable_buf;
 }
 
 /*
@@ -224,7 +235,9 @@ void
 Netchan_Transmit(netchan_t *chan, int length, byte *data)
 {
 	sizebuf_t send;
-	byte send_buf[MAX_MSGLEN];
+	byte send_buf[10];
+	netiov_t iov[3];
+	int count, size;
 	qboolean send_reliable;
 	unsigned w1, w2;
 
@@ -241,7 +254,13 @@ Netchan_Transmit(netchan_t *chan, int length, byte *data)
 
 	if (!chan->reliable_length && chan->message.cursize)
 	{
-		memcpy(chan->reliable_buf, chan->message_buf, chan->message.cursize);
+		/* swap the buffers instead of copying the message
+		   out, new reliable data goes into the free one */
+		byte *buf = chan->message.data;
+
+		chan->message.data = chan->reliable_data;
+		chan->reliable_data = buf;
+
 		chan->reliable_length = chan->message.cursize;
 		chan->message.cursize = 0;
 		chan->reliable_sequence ^= 1;
@@ -267,17 +286,35 @@ Netchan_Transmit(netchan_t *chan, int length, byte *data)
 		MSG_WriteShort(&send, qport->value);
 	}
 
-	/* copy the reliable message to the packet first */
+	/* the header, the reliable message and the unreliable
+	   part are gathered into the datagram by the socket */
+	iov[0].data = send.data;
+	iov[0].length = send.cursize;
+	size = send.cursize;
+	count = 1;
+
+	/* the reliable message goes first */
 	if (send_reliable)
 	{
-		SZ_Write(&send, chan->reliable_buf, chan->reliable_length);
+		iov[count].data = chan->reliable_data;
+		iov[count].length = chan->reliable_length;
+		count++;
+
+		size += chan->reliable_length;
 		chan->last_reliable_sequence = chan->outgoing_sequence;
 	}
 
 	/* add the unreliable part if space is available */
-	if (send.maxsize - send.cursize >= length)
+	if (MAX_MSGLEN - size >= length)
 	{
-		SZ_Write(&send, data, length);
+		if (length)
+		{
+			iov[count].data = data;
+			iov[count].length = length;
+			count++;
+
+			size += length;
+		}
 	}
 	else
 	{
@@ -285,21 +322,21 @@ Netchan_Transmit(netchan_t *chan, int length, byte *data)
 	}
 
 	/* send the datagram */
-	NET_SendPacket(chan->sock, send.cursize, send.data, chan->remote_address);
+	NET_SendPacketv(chan->sock, iov, count, chan->remote_address);
 
 	if (showpackets->value)
 	{
 		if (send_reliable)
 		{
 			Com_Printf("send %4i : s=%i reliable=%i ack=%i rack=%i\n",
-					send.cursize, chan->outgoing_sequence - 1,
+					size, chan->outgoing_sequence - 1,
 					chan->reliable_sequence, chan->incoming_sequence,
 					chan->incoming_reliable_sequence);
 		}
 		else
 		{
 			Com_Printf("send %4i : s=%i ack=%i rack=%i\n",
-					send.cursize, chan->outgoing_sequence - 1,
+					size, chan->outgoing_sequence - 1,
 					chan->incoming_sequence,
 					chan->incoming_reliable_sequence);
 		}
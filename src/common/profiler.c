@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * A tiny frame profiler. Timing zones are recorded into a ring
+ * buffer while prof_record is set, prof_dump writes the ring as
+ * Chrome trace JSON (load it in chrome://tracing or Perfetto).
+ * Every thread of the worker pool gets its own track.
+ *
+ * =======================================================================
+ */
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "header/common.h"
+
+/* must be a power of two */
+#define PROF_MAX_EVENTS 65536
+
+typedef struct
+{
+	long long start;
+	int duration;
+	short zone;
+	short thread;
+} profevent_t;
+
+typedef struct
+{
+	const char *name;
+	const char *category;
+} profzoneinfo_t;
+
+static const profzoneinfo_t profzones[PROF_NUMZONES] = {
+	{"SV_Frame", "server"},
+	{"SV_ReadPackets", "server"},
+	{"G_RunFrame", "game"},
+	{"SV_SendClientMessages", "server"},
+	{"CM_BoxTrace", "collision"},
+	{"CL_Frame", "client"},
+	{"S_Update", "sound"},
+	{"RE_RenderFrame", "renderer"},
+	{"RE_EndFrame", "renderer"}
+};
+
+static profevent_t profevents[PROF_MAX_EVENTS];
+
+/* total number of events ever recorded, the ring
+   position is taken modulo PROF_MAX_EVENTS */
+static volatile long profhead;
+
+static cvar_t *prof_record;
+
+long long
+Prof_Begin(void)
+{
+	if (!prof_record || !prof_record->value)
+	{
+		return 0;
+	}
+
+	return Sys_Microseconds();
+}
+
+/*
+ * Zones entered thousands of times per frame
+ * would flood the ring, they're only recorded
+ * with prof_record 2.
+ */
+long long
+Prof_BeginDetail(void)
+{
+	if (!prof_record || (prof_record->value < 2))
+	{
+		return 0;
+	}
+
+	return Sys_Microseconds();
+}
+
+void
+Prof_End(int zone, long long start)
+{
+	profevent_t *ev;
+	long slot;
+
+	if (!start)
+	{
+		return;
+	}
+
+	/* zones may end on worker threads, so
+	   claim the slot atomically */
+#ifdef _MSC_VER
+	slot = _InterlockedIncrement(&profhead) - 1;
+#else
+	slot = __atomic_fetch_add(&profhead, 1, __ATOMIC_RELAXED);
+#endif
+
+	ev = &profevents[slot & (PROF_MAX_EVENTS - 1)];
+	ev->start = start;
+	ev->duration = (int)(Sys_Microseconds() - start);
+	ev->zone = zone;
+	ev->thread = Sys_ThreadIndex();
+}
+
+/*
+ * Writes the recorded zones to a file in the game dir.
+ */
+static void
+Prof_Dump_f(void)
+{
+	char name[MAX_OSPATH];
+	const char *file;
+	long head, first, i;
+	qboolean seen[SYS_MAX_WORKERS + 1];
+	FILE *f;
+
+	if (Cmd_Argc() > 2)
+	{
+		Com_Printf("Usage: prof_dump [file]\n");
+		return;
+	}
+
+	file = (Cmd_Argc() == 2) ? Cmd_Argv(1) : "profile.json";
+	head = profhead;
+
+	if (!head)
+	{
+		Com_Printf("Nothing recorded, set prof_record 1 first.\n");
+		return;
+	}
+
+	Com_sprintf(name, sizeof(name), "%s/%s", FS_Gamedir(), file);
+
+	if ((f = Q_fopen(name, "w")) == NULL)
+	{
+		Com_Printf("Couldn't open %s for writing.\n", name);
+		return;
+	}
+
+	first = (head > PROF_MAX_EVENTS) ? head - PROF_MAX_EVENTS : 0;
+
+	fprintf(f, "{\"traceEvents\":[\n");
+
+	memset(seen, 0, sizeof(seen));
+
+	for (i = first; i < head; i++)
+	{
+		const profevent_t *ev = &profevents[i & (PROF_MAX_EVENTS - 1)];
+		const profzoneinfo_t *info = &profzones[ev->zone];
+
+		seen[ev->thread] = true;
+
+		fprintf(f, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+				"\"ts\":%lld,\"dur\":%i,\"pid\":1,\"tid\":%i},\n",
+				info->name, info->category, ev->start, ev->duration,
+				ev->thread);
+	}
+
+	/* name the tracks */
+	for (i = 0; i <= SYS_MAX_WORKERS; i++)
+	{
+		if (!seen[i])
+		{
+			continue;
+		}
+
+		if (i == 0)
+		{
+			fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+					"\"tid\":0,\"args\":{\"name\":\"main\"}},\n");
+		}
+		else
+		{
+			fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+					"\"tid\":%li,\"args\":{\"name\":\"worker %li\"}},\n", i, i);
+		}
+	}
+
+	/* last, JSON doesn't allow a trailing comma */
+	fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"args\":{\"name\":\"Yamagi Quake II v%s\"}}\n", YQ2VERSION);
+
+	fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(f);
+
+	Com_Printf("Wrote %li zones to %s.\n", head - first, name);
+
+	if (first)
+	{
+		Com_Printf("%li older zones were overwritten.\n", first);
+	}
+}
+
+void
+Prof_Init(void)
+{
+	prof_record = Cvar_Get("prof_record", "0", 0);
+
+	Cmd_AddCommand("prof_dump", Prof_Dump_f);
+}
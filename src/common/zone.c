@@ -19,7 +19,8 @@
  *
  * =======================================================================
  *
- * Zone malloc. It's just a normal malloc with tags.
+ * Zone malloc. It's just a normal malloc with tags, tagged
+ * allocations are served from per tag arenas.
  *
  * =======================================================================
  */
@@ -28,10 +29,268 @@
 #include "header/zone.h"
 
 #define Z_MAGIC 0x1d1d
+#define Z_ARENA_MAGIC 0x1d1e
+
+/*
+ * Allocations with a tag other than 0 come from the game
+ * and are released all at once by Z_FreeTags(). They're
+ * carved out of per tag blocks, so allocating is mostly a
+ * pointer bump and freeing a tag releases a few blocks
+ * instead of walking every single allocation. Sizes are
+ * rounded up to a size class, single frees go onto the
+ * free list of their class and are handed out again by
+ * the next allocation of that class. Big allocations get
+ * a block of their own, which is freed right away.
+ */
+#define Z_MAX_ARENAS 8
+#define Z_ARENA_BLOCKSIZE (256 * 1024)
+#define Z_ARENA_ALIGN 16
+#define Z_BLOCK_HEADER ((sizeof(zblock_t) + Z_ARENA_ALIGN - 1) & ~(Z_ARENA_ALIGN - 1))
+
+/* 16 byte steps up to 1k, powers of two up to a quarter block */
+#define Z_SMALL_MAX 1024
+#define Z_SMALL_CLASSES (Z_SMALL_MAX / Z_ARENA_ALIGN)
+#define Z_NUM_CLASSES (Z_SMALL_CLASSES + 6)
+#define Z_LARGE_MIN (Z_ARENA_BLOCKSIZE / 4)
+
+typedef struct zblock_s
+{
+	struct zblock_s *next;
+	int size;
+	int used;
+} zblock_t;
+
+typedef struct
+{
+	int tag;
+	zblock_t *blocks; /* first one is bumped */
+	int numblocks;
+	int reserved; /* bytes in blocks */
+	int count;
+	int bytes;
+	int peak;
+	zhead_t *free[Z_NUM_CLASSES]; /* linked by next */
+	int freebytes;
+} zarena_t;
 
 zhead_t z_chain;
 int z_count, z_bytes;
 
+static zarena_t z_arenas[Z_MAX_ARENAS];
+static int z_numarenas;
+
+/* tagged allocations in z_chain, when all arenas are taken */
+static int z_chaintagged;
+
+static zarena_t *
+Z_ArenaForTag(int tag, qboolean create)
+{
+	int i;
+
+	for (i = 0; i < z_numarenas; i++)
+	{
+		if (z_arenas[i].tag == tag)
+		{
+			return &z_arenas[i];
+		}
+	}
+
+	if (!create || (z_numarenas == Z_MAX_ARENAS))
+	{
+		return NULL;
+	}
+
+	memset(&z_arenas[z_numarenas], 0, sizeof(zarena_t));
+	z_arenas[z_numarenas].tag = tag;
+
+	return &z_arenas[z_numarenas++];
+}
+
+static byte *
+Z_BlockData(zblock_t *block)
+{
+	return (byte *)block + Z_BLOCK_HEADER;
+}
+
+static zblock_t *
+Z_NewBlock(zarena_t *arena, int size)
+{
+	zblock_t *block;
+	int total;
+
+	total = Z_BLOCK_HEADER + size;
+	block = malloc(total);
+
+	if (!block)
+	{
+		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes", total);
+	}
+
+	block->size = size;
+	block->used = 0;
+
+	arena->numblocks++;
+	arena->reserved += size;
+
+	return block;
+}
+
+/*
+ * Returns the size class of size and
+ * rounds size up to the class' size.
+ */
+static int
+Z_SizeClass(int *size)
+{
+	int class, classsize;
+
+	if (*size <= Z_SMALL_MAX)
+	{
+		class = (*size + Z_ARENA_ALIGN - 1) / Z_ARENA_ALIGN - 1;
+		*size = (class + 1) * Z_ARENA_ALIGN;
+
+		return class;
+	}
+
+	for (class = Z_SMALL_CLASSES, classsize = Z_SMALL_MAX * 2;
+		classsize < *size; class++, classsize *= 2)
+	{
+	}
+
+	*size = classsize;
+
+	return class;
+}
+
+static zhead_t *
+Z_ArenaMalloc(zarena_t *arena, int size)
+{
+	zblock_t *block;
+	zhead_t *z;
+	int class = -1;
+
+	if (size > Z_LARGE_MIN)
+	{
+		size = (size + Z_ARENA_ALIGN - 1) & ~(Z_ARENA_ALIGN - 1);
+
+		/* a block of its own, behind the one that's bumped */
+		block = Z_NewBlock(arena, size);
+
+		if (arena->blocks)
+		{
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		}
+		else
+		{
+			block->next = NULL;
+			arena->blocks = block;
+		}
+
+		block->used = size;
+		z = (zhead_t *)Z_BlockData(block);
+	}
+	else if ((z = arena->free[(class = Z_SizeClass(&size))]) != NULL)
+	{
+		arena->free[class] = z->next;
+		arena->freebytes -= size;
+	}
+	else
+	{
+		block = arena->blocks;
+
+		if (!block || (block->size - block->used < size))
+		{
+			block = Z_NewBlock(arena, Z_ARENA_BLOCKSIZE);
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+
+		z = (zhead_t *)(Z_BlockData(block) + block->used);
+		block->used += size;
+	}
+
+	memset(z, 0, size);
+	z->magic = Z_ARENA_MAGIC;
+	z->tag = arena->tag;
+	z->size = size;
+
+	arena->count++;
+	arena->bytes += size;
+
+	if (arena->bytes > arena->peak)
+	{
+		arena->peak = arena->bytes;
+	}
+
+	return z;
+}
+
+static void
+Z_ArenaFree(zhead_t *z)
+{
+	zarena_t *arena;
+	zblock_t *block, **link;
+	int size, class;
+
+	arena = Z_ArenaForTag(z->tag, false);
+
+	if (!arena)
+	{
+		Com_Printf("ERROR: Z_free(%p) failed: no arena for tag %i\n", (void *)(z + 1), z->tag);
+		abort();
+	}
+
+	z->magic = 0;
+	arena->count--;
+	arena->bytes -= z->size;
+
+	if (z->size <= Z_LARGE_MIN)
+	{
+		size = z->size;
+		class = Z_SizeClass(&size);
+
+		z->next = arena->free[class];
+		arena->free[class] = z;
+		arena->freebytes += size;
+
+		return;
+	}
+
+	/* big ones are the only allocation in their block */
+	block = (zblock_t *)((byte *)z - Z_BLOCK_HEADER);
+
+	for (link = &arena->blocks; *link != block; link = &(*link)->next)
+	{
+	}
+
+	*link = block->next;
+
+	arena->numblocks--;
+	arena->reserved -= block->size;
+	free(block);
+}
+
+static void
+Z_FreeArena(zarena_t *arena)
+{
+	zblock_t *block, *next;
+
+	for (block = arena->blocks; block; block = next)
+	{
+		next = block->next;
+		free(block);
+	}
+
+	arena->blocks = NULL;
+	arena->numblocks = 0;
+	arena->reserved = 0;
+	arena->count = 0;
+	arena->bytes = 0;
+	arena->freebytes = 0;
+	memset(arena->free, 0, sizeof(arena->free));
+}
+
 void
 Z_Free(void *ptr)
 {
@@ -39,6 +298,12 @@ Z_Free(void *ptr)
 
 	z = ((zhead_t *)ptr) - 1;
 
+	if (z->magic == Z_ARENA_MAGIC)
+	{
+		Z_ArenaFree(z);
+		return;
+	}
+
 	if (z->magic != Z_MAGIC)
 	{
 		Com_Printf("ERROR: Z_free(%p) failed: bad magic\n", ptr);
@@ -48,6 +313,11 @@ Z_Free(void *ptr)
 	z->prev->next = z->next;
 	z->next->prev = z->prev;
 
+	if (z->tag)
+	{
+		z_chaintagged--;
+	}
+
 	z_count--;
 	z_bytes -= z->size;
 	free(z);
@@ -56,13 +326,50 @@ Z_Free(void *ptr)
 void
 Z_Stats_f(void)
 {
+	zarena_t *arena;
+	int i, wasted;
+
 	Com_Printf("%i bytes in %i blocks\n", z_bytes, z_count);
+
+	for (i = 0; i < z_numarenas; i++)
+	{
+		arena = &z_arenas[i];
+		wasted = 0;
+
+		/* The unused tails of full blocks can't be handed
+		   out until the tag is freed. Freed allocations on
+		   the free lists and the tail of the block that's
+		   bumped can. */
+		if (arena->blocks)
+		{
+			wasted = arena->reserved - arena->bytes - arena->freebytes -
+				(arena->blocks->size - arena->blocks->used);
+		}
+
+		Com_Printf("tag %i: %i bytes in %i allocations, peak %i, "
+				"%i bytes in %i arena blocks, %i bytes free for reuse, "
+				"%i%% wasted\n",
+				arena->tag, arena->bytes, arena->count, arena->peak,
+				arena->reserved, arena->numblocks, arena->freebytes,
+				arena->reserved ? (int)(100.0f * wasted / arena->reserved) : 0);
+	}
 }
 
 void
 Z_FreeTags(int tag)
 {
 	zhead_t *z, *next;
+	zarena_t *arena;
+
+	if ((arena = Z_ArenaForTag(tag, false)) != NULL)
+	{
+		Z_FreeArena(arena);
+	}
+
+	if (!z_chaintagged)
+	{
+		return;
+	}
 
 	for (z = z_chain.next; z != &z_chain; z = next)
 	{
@@ -78,9 +385,16 @@ Z_FreeTags(int tag)
 void *
 Z_TagMalloc(int size, int tag)
 {
+	zarena_t *arena;
 	zhead_t *z;
 
 	size = size + sizeof(zhead_t);
+
+	if (tag && ((arena = Z_ArenaForTag(tag, true)) != NULL))
+	{
+		return (void *)(Z_ArenaMalloc(arena, size) + 1);
+	}
+
 	z = malloc(size);
 
 	if (!z)
@@ -95,6 +409,11 @@ Z_TagMalloc(int size, int tag)
 	z->tag = tag;
 	z->size = size;
 
+	if (tag)
+	{
+		z_chaintagged++;
+	}
+
 	z->next = z_chain.next;
 	z->prev = &z_chain;
 	z_chain.next->prev = z;
@@ -108,4 +427,3 @@ Z_Malloc(int size)
 {
 	return Z_TagMalloc(size, 0);
 }
-
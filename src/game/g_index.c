@@ -0,0 +1,657 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Entity index for G_Find(), findradius() and findradius2(). Entity
+ * centers are hashed into a 2D grid of columns, targetnames and
+ * classnames into case insensitive hash chains sorted by entity
+ * number. Both keep the iteration order of the plain scans over
+ * g_edicts, the index only decides which entities are looked at.
+ *
+ * Entities are marked dirty when they're spawned, freed, linked or
+ * get a new model and are reindexed at the next query. Everything
+ * is resynced once per frame to catch entities that were moved or
+ * renamed without any of these.
+ *
+ * =======================================================================
+ */
+
+#include <ctype.h>
+
+#include "header/local.h"
+
+#define INDEX_CELLSIZE 256
+#define INDEX_CELLBUCKETS 4096  /* must be a power of two */
+#define INDEX_NAMEBUCKETS 1024  /* must be a power of two */
+#define INDEX_MAXCELLS 256      /* bigger radius queries scan linearly */
+#define INDEX_MAXCOORD 1048576
+
+/* the indexed string fields */
+#define INDEX_TARGETNAME 0
+#define INDEX_CLASSNAME 1
+#define INDEX_NAMES 2
+
+typedef struct
+{
+	int cell;
+	int cellprev;
+	int cellnext;
+
+	char *name[INDEX_NAMES];
+	int namebucket[INDEX_NAMES];
+	int nameprev[INDEX_NAMES];
+	int namenext[INDEX_NAMES];
+
+	qboolean dirty;
+} entindex_t;
+
+static entindex_t *index_ents;
+static int index_maxents;
+
+static int index_cells[INDEX_CELLBUCKETS];
+static int index_cellvisit[INDEX_CELLBUCKETS];
+static int index_visit;
+
+static int index_names[INDEX_NAMES][INDEX_NAMEBUCKETS];
+
+static int *index_dirty;
+static int index_numdirty;
+
+/* bumped whenever an entity changes its cell */
+static int index_version;
+
+/* candidates of the last radius query, sorted by entity number */
+static struct
+{
+	vec3_t org;
+	float rad;
+	int version;
+	int count;
+	int *ents;
+} index_query;
+
+static void (*index_linkentity)(edict_t *ent);
+static void (*index_setmodel)(edict_t *ent, const char *name);
+
+static qboolean
+G_IndexActive(void)
+{
+	return index_ents && g_entindex && g_entindex->value;
+}
+
+static int
+G_IndexCoord(float v)
+{
+	if (v < -INDEX_MAXCOORD)
+	{
+		v = -INDEX_MAXCOORD;
+	}
+	else if (v > INDEX_MAXCOORD)
+	{
+		v = INDEX_MAXCOORD;
+	}
+
+	return (int)floor(v / INDEX_CELLSIZE);
+}
+
+static int
+G_IndexCellBucket(int x, int y)
+{
+	return (((unsigned)x * 73856093u) ^ ((unsigned)y * 19349663u)) &
+		(INDEX_CELLBUCKETS - 1);
+}
+
+static int
+G_IndexNameBucket(const char *name)
+{
+	unsigned hash = 2166136261u;
+
+	for ( ; *name; name++)
+	{
+		hash = (hash ^ (unsigned char)tolower((unsigned char)*name)) * 16777619u;
+	}
+
+	return hash & (INDEX_NAMEBUCKETS - 1);
+}
+
+static int
+G_IndexField(int fieldofs)
+{
+	if (fieldofs == FOFS(targetname))
+	{
+		return INDEX_TARGETNAME;
+	}
+	else if (fieldofs == FOFS(classname))
+	{
+		return INDEX_CLASSNAME;
+	}
+
+	return -1;
+}
+
+static void
+G_IndexUnlinkCell(int num)
+{
+	entindex_t *ie = &index_ents[num];
+
+	if (ie->cell < 0)
+	{
+		return;
+	}
+
+	if (ie->cellprev >= 0)
+	{
+		index_ents[ie->cellprev].cellnext = ie->cellnext;
+	}
+	else
+	{
+		index_cells[ie->cell] = ie->cellnext;
+	}
+
+	if (ie->cellnext >= 0)
+	{
+		index_ents[ie->cellnext].cellprev = ie->cellprev;
+	}
+
+	ie->cell = -1;
+	index_version++;
+}
+
+static void
+G_IndexLinkCell(int num, int cell)
+{
+	entindex_t *ie = &index_ents[num];
+
+	ie->cell = cell;
+	ie->cellprev = -1;
+	ie->cellnext = index_cells[cell];
+
+	if (ie->cellnext >= 0)
+	{
+		index_ents[ie->cellnext].cellprev = num;
+	}
+
+	index_cells[cell] = num;
+	index_version++;
+}
+
+static void
+G_IndexUnlinkName(int num, int field)
+{
+	entindex_t *ie = &index_ents[num];
+
+	if (!ie->name[field])
+	{
+		return;
+	}
+
+	if (ie->nameprev[field] >= 0)
+	{
+		index_ents[ie->nameprev[field]].namenext[field] = ie->namenext[field];
+	}
+	else
+	{
+		index_names[field][ie->namebucket[field]] = ie->namenext[field];
+	}
+
+	if (ie->namenext[field] >= 0)
+	{
+		index_ents[ie->namenext[field]].nameprev[field] = ie->nameprev[field];
+	}
+
+	ie->name[field] = NULL;
+}
+
+/*
+ * Name chains are kept sorted by entity
+ * number, so G_Find() can walk them in
+ * the same order as g_edicts.
+ */
+static void
+G_IndexLinkName(int num, int field, char *name)
+{
+	entindex_t *ie = &index_ents[num];
+	int bucket, prev, next;
+
+	bucket = G_IndexNameBucket(name);
+	prev = -1;
+	next = index_names[field][bucket];
+
+	while ((next >= 0) && (next < num))
+	{
+		prev = next;
+		next = index_ents[next].namenext[field];
+	}
+
+	ie->name[field] = name;
+	ie->namebucket[field] = bucket;
+	ie->nameprev[field] = prev;
+	ie->namenext[field] = next;
+
+	if (prev >= 0)
+	{
+		index_ents[prev].namenext[field] = num;
+	}
+	else
+	{
+		index_names[field][bucket] = num;
+	}
+
+	if (next >= 0)
+	{
+		index_ents[next].nameprev[field] = num;
+	}
+}
+
+static void
+G_IndexUpdate(int num)
+{
+	entindex_t *ie = &index_ents[num];
+	edict_t *ent = &g_edicts[num];
+	char *name[INDEX_NAMES];
+	int cell, i;
+
+	if (ent->inuse)
+	{
+		cell = G_IndexCellBucket(
+				G_IndexCoord(ent->s.origin[0] + (ent->mins[0] + ent->maxs[0]) * 0.5),
+				G_IndexCoord(ent->s.origin[1] + (ent->mins[1] + ent->maxs[1]) * 0.5));
+
+		name[INDEX_TARGETNAME] = ent->targetname;
+		name[INDEX_CLASSNAME] = ent->classname;
+	}
+	else
+	{
+		cell = -1;
+		name[INDEX_TARGETNAME] = NULL;
+		name[INDEX_CLASSNAME] = NULL;
+	}
+
+	if (cell != ie->cell)
+	{
+		G_IndexUnlinkCell(num);
+
+		if (cell >= 0)
+		{
+			G_IndexLinkCell(num, cell);
+		}
+	}
+
+	for (i = 0; i < INDEX_NAMES; i++)
+	{
+		if (name[i] == ie->name[i])
+		{
+			continue;
+		}
+
+		G_IndexUnlinkName(num, i);
+
+		if (name[i])
+		{
+			G_IndexLinkName(num, i, name[i]);
+		}
+	}
+}
+
+static void
+G_IndexFlush(void)
+{
+	int i;
+
+	for (i = 0; i < index_numdirty; i++)
+	{
+		index_ents[index_dirty[i]].dirty = false;
+		G_IndexUpdate(index_dirty[i]);
+	}
+
+	index_numdirty = 0;
+}
+
+/*
+ * Marks an entity for reindexing
+ * at the next query.
+ */
+void
+G_IndexTouch(edict_t *ent)
+{
+	int num;
+
+	if (!index_ents || !ent)
+	{
+		return;
+	}
+
+	num = ent - g_edicts;
+
+	if ((num < 0) || (num >= index_maxents) || index_ents[num].dirty)
+	{
+		return;
+	}
+
+	index_ents[num].dirty = true;
+	index_dirty[index_numdirty++] = num;
+}
+
+/*
+ * Reindexes all entities. Called once
+ * per frame to pick up entities that
+ * changed without being relinked.
+ */
+void
+G_IndexSync(void)
+{
+	int i;
+
+	if (!index_ents)
+	{
+		return;
+	}
+
+	for (i = 0; i < index_numdirty; i++)
+	{
+		index_ents[index_dirty[i]].dirty = false;
+	}
+
+	index_numdirty = 0;
+
+	for (i = 0; i < globals.num_edicts; i++)
+	{
+		G_IndexUpdate(i);
+	}
+}
+
+/*
+ * Empties the index, must be called
+ * whenever g_edicts is wiped.
+ */
+void
+G_IndexClear(void)
+{
+	int i, j;
+
+	if (!index_ents)
+	{
+		return;
+	}
+
+	for (i = 0; i < index_maxents; i++)
+	{
+		index_ents[i].cell = -1;
+		index_ents[i].dirty = false;
+
+		for (j = 0; j < INDEX_NAMES; j++)
+		{
+			index_ents[i].name[j] = NULL;
+		}
+	}
+
+	memset(index_cells, -1, sizeof(index_cells));
+	memset(index_names, -1, sizeof(index_names));
+
+	index_numdirty = 0;
+	index_version++;
+	index_query.count = 0;
+	index_query.version = index_version - 1;
+}
+
+/*
+ * (Re)allocates the index for
+ * game.maxentities entities.
+ */
+void
+G_IndexInit(void)
+{
+	index_maxents = game.maxentities;
+	index_ents = gi.TagMalloc(index_maxents * sizeof(index_ents[0]), TAG_GAME);
+	index_dirty = gi.TagMalloc(index_maxents * sizeof(index_dirty[0]), TAG_GAME);
+	index_query.ents = gi.TagMalloc(index_maxents * sizeof(index_query.ents[0]), TAG_GAME);
+
+	G_IndexClear();
+}
+
+static void
+G_IndexLinkEntity(edict_t *ent)
+{
+	index_linkentity(ent);
+	G_IndexTouch(ent);
+}
+
+static void
+G_IndexSetModel(edict_t *ent, const char *name)
+{
+	index_setmodel(ent, name);
+	G_IndexTouch(ent);
+}
+
+/*
+ * Routes linkentity and setmodel through
+ * the index. Must be called right after
+ * the import table was copied into gi.
+ */
+void
+G_IndexHookImports(void)
+{
+	index_linkentity = gi.linkentity;
+	index_setmodel = gi.setmodel;
+
+	gi.linkentity = G_IndexLinkEntity;
+	gi.setmodel = G_IndexSetModel;
+}
+
+/*
+ * G_Find() for indexed fields. Returns
+ * false if the caller must fall back
+ * to scanning all entities.
+ */
+qboolean
+G_IndexFind(edict_t *from, int fieldofs, const char *match, edict_t **result)
+{
+	int field, bucket, num;
+	edict_t *ent;
+	char *s;
+
+	field = G_IndexField(fieldofs);
+
+	if ((field < 0) || !G_IndexActive())
+	{
+		return false;
+	}
+
+	G_IndexFlush();
+
+	bucket = G_IndexNameBucket(match);
+	num = index_names[field][bucket];
+
+	if (from && index_ents[from - g_edicts].name[field] &&
+		(index_ents[from - g_edicts].namebucket[field] == bucket))
+	{
+		/* usually we're continuing the last search */
+		num = index_ents[from - g_edicts].namenext[field];
+	}
+	else if (from)
+	{
+		while ((num >= 0) && (num <= from - g_edicts))
+		{
+			num = index_ents[num].namenext[field];
+		}
+	}
+
+	for ( ; num >= 0; num = index_ents[num].namenext[field])
+	{
+		ent = &g_edicts[num];
+
+		if (!ent->inuse)
+		{
+			continue;
+		}
+
+		s = *(char **)((byte *)ent + fieldofs);
+
+		if (s && !Q_stricmp(s, match))
+		{
+			*result = ent;
+			return true;
+		}
+	}
+
+	*result = NULL;
+	return true;
+}
+
+static int
+G_IndexCompareNums(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static void
+G_IndexGather(vec3_t org, float rad)
+{
+	int x, y, x0, x1, y0, y1, bucket, num;
+
+	/* one unit of slack against rounding
+	   at the edges of the query box */
+	x0 = G_IndexCoord(org[0] - rad - 1);
+	x1 = G_IndexCoord(org[0] + rad + 1);
+	y0 = G_IndexCoord(org[1] - rad - 1);
+	y1 = G_IndexCoord(org[1] + rad + 1);
+
+	VectorCopy(org, index_query.org);
+	index_query.rad = rad;
+	index_query.version = index_version;
+	index_query.count = 0;
+
+	/* different columns can share a bucket */
+	index_visit++;
+
+	for (x = x0; x <= x1; x++)
+	{
+		for (y = y0; y <= y1; y++)
+		{
+			bucket = G_IndexCellBucket(x, y);
+
+			if (index_cellvisit[bucket] == index_visit)
+			{
+				continue;
+			}
+
+			index_cellvisit[bucket] = index_visit;
+
+			for (num = index_cells[bucket]; num >= 0; num = index_ents[num].cellnext)
+			{
+				index_query.ents[index_query.count++] = num;
+			}
+		}
+	}
+
+	qsort(index_query.ents, index_query.count, sizeof(index_query.ents[0]),
+			G_IndexCompareNums);
+}
+
+/*
+ * findradius() and findradius2() through
+ * the grid. Returns false if the caller
+ * must fall back to scanning all entities.
+ */
+qboolean
+G_IndexRadius(edict_t *from, vec3_t org, float rad, qboolean damageable,
+		edict_t **result)
+{
+	int lo, hi, mid, start, j;
+	float span;
+	vec3_t eorg;
+	edict_t *ent;
+
+	if (!G_IndexActive() || !(rad >= 0))
+	{
+		return false;
+	}
+
+	span = 2 * rad / INDEX_CELLSIZE + 2;
+
+	if (span * span > INDEX_MAXCELLS)
+	{
+		return false;
+	}
+
+	G_IndexFlush();
+
+	if ((index_query.version != index_version) || (index_query.rad != rad) ||
+		!VectorCompare(index_query.org, org))
+	{
+		G_IndexGather(org, rad);
+	}
+
+	/* first candidate after from */
+	start = from ? (from - g_edicts) + 1 : 0;
+	lo = 0;
+	hi = index_query.count;
+
+	while (lo < hi)
+	{
+		mid = (lo + hi) / 2;
+
+		if (index_query.ents[mid] < start)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	for ( ; lo < index_query.count; lo++)
+	{
+		ent = &g_edicts[index_query.ents[lo]];
+
+		if (!ent->inuse)
+		{
+			continue;
+		}
+
+		if (ent->solid == SOLID_NOT)
+		{
+			continue;
+		}
+
+		if (damageable && (!ent->takedamage || !(ent->svflags & SVF_DAMAGEABLE)))
+		{
+			continue;
+		}
+
+		for (j = 0; j < 3; j++)
+		{
+			eorg[j] = org[j] - (ent->s.origin[j] +
+					   (ent->mins[j] + ent->maxs[j]) * 0.5);
+		}
+
+		if (VectorLength(eorg) > rad)
+		{
+			continue;
+		}
+
+		*result = ent;
+		return true;
+	}
+
+	*result = NULL;
+	return true;
+}
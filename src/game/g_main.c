@@ -102,6 +102,8 @@ cvar_t *aimfix;
 cvar_t *g_machinegun_norecoil;
 cvar_t *g_quick_weap;
 cvar_t *g_swap_speed;
+cvar_t *g_entindex;
+cvar_t *g_savecompress;
 
 void G_RunFrame(void);
 
@@ -114,6 +116,7 @@ ShutdownGame(void)
 
 	gi.FreeTags(TAG_LEVEL);
 	gi.FreeTags(TAG_GAME);
+	FreeSaveHashes();
 }
 
 /*
@@ -125,6 +128,7 @@ Q2_DLL_EXPORTED game_export_t *
 GetGameAPI(game_import_t *import)
 {
 	gi = *import;
+	G_IndexHookImports();
 
 	globals.apiversion = GAME_API_VERSION;
 	globals.Init = InitGame;
@@ -465,6 +469,8 @@ G_RunFrame(void)
 	level.framenum++;
 	level.time = level.framenum * FRAMETIME;
 
+	G_IndexSync();
+
 	gibsthisframe = 0;
 	debristhisframe = 0;
 
@@ -68,6 +68,7 @@ G_ProjectSource2(vec3_t point, vec3_t distance, vec3_t forward,
 edict_t *
 G_Find(edict_t *from, int fieldofs, char *match)
 {
+	edict_t *ent;
 	char *s;
 
 	if (!match)
@@ -75,6 +76,11 @@ G_Find(edict_t *from, int fieldofs, char *match)
 		return NULL;
 	}
 
+	if (G_IndexFind(from, fieldofs, match, &ent))
+	{
+		return ent;
+	}
+
 	if (!from)
 	{
 		from = g_edicts;
@@ -114,9 +120,15 @@ G_Find(edict_t *from, int fieldofs, char *match)
 edict_t *
 findradius(edict_t *from, vec3_t org, float rad)
 {
+	edict_t *ent;
 	vec3_t eorg;
 	int j;
 
+	if (G_IndexRadius(from, org, rad, false, &ent))
+	{
+		return ent;
+	}
+
 	if (!from)
 	{
 		from = g_edicts;
@@ -162,9 +174,15 @@ edict_t *
 findradius2(edict_t *from, vec3_t org, float rad)
 {
 	/* rad must be positive */
+	edict_t *ent;
 	vec3_t eorg;
 	int j;
 
+	if (G_IndexRadius(from, org, rad, true, &ent))
+	{
+		return ent;
+	}
+
 	if (!from)
 	{
 		from = g_edicts;
@@ -710,6 +728,8 @@ G_InitEdict(edict_t *e)
 	e->gravityVector[0] = 0.0;
 	e->gravityVector[1] = 0.0;
 	e->gravityVector[2] = -1.0;
+
+	G_IndexTouch(e);
 }
 
 /*
@@ -808,6 +828,8 @@ G_FreeEdict(edict_t *ed)
 	ed->classname = "freed";
 	ed->freetime = level.time;
 	ed->inuse = false;
+
+	G_IndexTouch(ed);
 }
 
 void
@@ -106,6 +106,15 @@ struct edict_s
 
 #endif /* GAME_INCLUDE */
 
+/* one ray of a batched trace, mins and maxs may be NULL */
+typedef struct
+{
+	float *start, *end;
+	float *mins, *maxs;
+	edict_t *passent;
+	int contentmask;
+} tracerequest_t;
+
 /* =============================================================== */
 
 /* functions provided by the main engine */
@@ -188,6 +197,12 @@ typedef struct
 	void (*AddCommandString)(const char *text);
 
 	void (*DebugGraph)(float value, int color);
+
+	/* Traces several rays at once, gives the same results as
+	   calling trace() for each of them. Not available in
+	   engines other than Yamagi Quake II. */
+	void (*traces)(const tracerequest_t *requests, trace_t *results,
+			int count);
 } game_import_t;
 
 /* functions exported by the game subsystem */
@@ -673,6 +673,8 @@ extern cvar_t *aimfix;
 extern cvar_t *g_machinegun_norecoil;
 extern cvar_t *g_quick_weap;
 extern cvar_t *g_swap_speed;
+extern cvar_t *g_entindex;
+extern cvar_t *g_savecompress;
 
 /* this is for the count of monsters */
 #define ENT_SLOTS_LEFT \
@@ -793,6 +795,17 @@ float vectoyaw2(vec3_t vec);
 void vectoangles2(vec3_t vec, vec3_t angles);
 edict_t *findradius2(edict_t *from, vec3_t org, float rad);
 
+/* g_index.c */
+void G_IndexInit(void);
+void G_IndexClear(void);
+void G_IndexSync(void);
+void G_IndexTouch(edict_t *ent);
+void G_IndexHookImports(void);
+qboolean G_IndexFind(edict_t *from, int fieldofs, const char *match,
+		edict_t **result);
+qboolean G_IndexRadius(edict_t *from, vec3_t org, float rad,
+		qboolean damageable, edict_t **result);
+
 /* g_spawn.c */
 void ED_CallSpawn(edict_t *ent);
 
@@ -1004,6 +1017,7 @@ void GetChaseTarget(edict_t *ent);
 
 /* savegame */
 void InitGame(void);
+void FreeSaveHashes(void);
 void ReadLevel(const char *filename);
 void WriteLevel(const char *filename);
 void ReadGame(const char *filename);
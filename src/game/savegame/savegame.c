@@ -68,6 +68,7 @@
  */
 
 #include "../../common/header/common.h" // YQ2ARCH
+#include "../../common/unzip/miniz/miniz.h"
 #include "../header/local.h"
 #include "savegame.h"
 /*
@@ -182,6 +183,8 @@ static field_t clientfields[] = {
 	#include "tables/clientfields.h"
 };
 
+static void BuildSaveHashes(void);
+
 /* ========================================================= */
 
 /*
@@ -263,10 +266,15 @@ InitGame(void)
 	g_machinegun_norecoil = gi.cvar("g_machinegun_norecoil", "0", CVAR_ARCHIVE);
 	g_quick_weap = gi.cvar("g_quick_weap", "0", CVAR_ARCHIVE);
 	g_swap_speed = gi.cvar("g_swap_speed", "1", 0);
+	g_entindex = gi.cvar("g_entindex", "1", 0);
+	g_savecompress = gi.cvar("g_savecompress", "0", CVAR_ARCHIVE);
 
 	/* items */
 	InitItems();
 
+	/* savegame function and mmove lookups */
+	BuildSaveHashes();
+
 	Com_sprintf(game.helpmessage1, sizeof(game.helpmessage1), "");
 	Com_sprintf(game.helpmessage2, sizeof(game.helpmessage2), "");
 
@@ -275,6 +283,7 @@ InitGame(void)
 	g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
 	globals.max_edicts = game.maxentities;
+	G_IndexInit();
 
 	/* initialize all clients for this game */
 	game.maxclients = maxclients->value;
@@ -291,6 +300,141 @@ InitGame(void)
 
 /* ========================================================= */
 
+/*
+ * The function and mmove lists have a few
+ * thousand entries and are searched for
+ * each pointer field of each edict when
+ * saving or loading. So they're indexed
+ * by address and by name in open addressed
+ * hash tables, built once by InitGame().
+ * The slots hold the list index + 1, 0
+ * marks an empty slot. Linear probing finds
+ * duplicates in list order, like a scan.
+ * The tables are sized from the lists to
+ * be at most half full.
+ */
+typedef struct
+{
+	unsigned short *byAddress;
+	unsigned short *byName;
+	int size;
+} savehash_t;
+
+static savehash_t funcHash;
+static savehash_t mmoveHash;
+
+static unsigned
+HashAddress(const void *adr, int size)
+{
+	unsigned long long key = (size_t)adr;
+
+	key ^= key >> 29;
+	key *= 0x9e3779b97f4a7c15ull;
+
+	return (unsigned)(key >> 32) & (size - 1);
+}
+
+static unsigned
+HashName(const char *name, int size)
+{
+	unsigned hash = 2166136261u;
+
+	while (*name)
+	{
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+	}
+
+	return hash & (size - 1);
+}
+
+static void
+HashInsert(unsigned short *table, int size, unsigned slot, int index)
+{
+	while (table[slot])
+	{
+		slot = (slot + 1) & (size - 1);
+	}
+
+	table[slot] = index + 1;
+}
+
+static void
+HashAlloc(savehash_t *hash, int count)
+{
+	/* the slots are unsigned short */
+	if (count >= 0xffff)
+	{
+		gi.error("%s: %i entries are too many", __func__, count);
+	}
+
+	for (hash->size = 16; hash->size < count * 2; hash->size *= 2)
+	{
+	}
+
+	hash->byAddress = calloc(hash->size, sizeof(unsigned short));
+	hash->byName = calloc(hash->size, sizeof(unsigned short));
+
+	if (!hash->byAddress || !hash->byName)
+	{
+		gi.error("%s: out of memory", __func__);
+	}
+}
+
+static void
+BuildSaveHashes(void)
+{
+	int i, count;
+
+	if (funcHash.size)
+	{
+		return;
+	}
+
+	for (count = 0; functionList[count].funcStr; count++)
+	{
+	}
+
+	HashAlloc(&funcHash, count);
+
+	for (i = 0; i < count; i++)
+	{
+		HashInsert(funcHash.byAddress, funcHash.size,
+				HashAddress(functionList[i].funcPtr, funcHash.size), i);
+		HashInsert(funcHash.byName, funcHash.size,
+				HashName(functionList[i].funcStr, funcHash.size), i);
+	}
+
+	for (count = 0; mmoveList[count].mmoveStr; count++)
+	{
+	}
+
+	HashAlloc(&mmoveHash, count);
+
+	for (i = 0; i < count; i++)
+	{
+		HashInsert(mmoveHash.byAddress, mmoveHash.size,
+				HashAddress(mmoveList[i].mmovePtr, mmoveHash.size), i);
+		HashInsert(mmoveHash.byName, mmoveHash.size,
+				HashName(mmoveList[i].mmoveStr, mmoveHash.size), i);
+	}
+}
+
+/*
+ * Frees the tables built by InitGame(),
+ * called by ShutdownGame().
+ */
+void
+FreeSaveHashes(void)
+{
+	free(funcHash.byAddress);
+	free(funcHash.byName);
+	free(mmoveHash.byAddress);
+	free(mmoveHash.byName);
+
+	memset(&funcHash, 0, sizeof(funcHash));
+	memset(&mmoveHash, 0, sizeof(mmoveHash));
+}
+
 /*
  * Helper function to get
  * the human readable function
@@ -301,14 +445,20 @@ InitGame(void)
 functionList_t *
 GetFunctionByAddress(byte *adr)
 {
-	int i;
+	unsigned slot;
 
-	for (i = 0; functionList[i].funcStr; i++)
+	slot = HashAddress(adr, funcHash.size);
+
+	while (funcHash.byAddress[slot])
 	{
-		if (functionList[i].funcPtr == adr)
+		functionList_t *func = &functionList[funcHash.byAddress[slot] - 1];
+
+		if (func->funcPtr == adr)
 		{
-			return &functionList[i];
+			return func;
 		}
+
+		slot = (slot + 1) & (funcHash.size - 1);
 	}
 
 	return NULL;
@@ -318,20 +468,25 @@ GetFunctionByAddress(byte *adr)
  * Helper function to get the
  * pointer to a function by
  * it's human readable name.
- * Called by WriteField1 and
- * WriteField2.
+ * Called by ReadField.
  */
 byte *
 FindFunctionByName(char *name)
 {
-	int i;
+	unsigned slot;
 
-	for (i = 0; functionList[i].funcStr; i++)
+	slot = HashName(name, funcHash.size);
+
+	while (funcHash.byName[slot])
 	{
-		if (!strcmp(name, functionList[i].funcStr))
+		functionList_t *func = &functionList[funcHash.byName[slot] - 1];
+
+		if (!strcmp(name, func->funcStr))
 		{
-			return functionList[i].funcPtr;
+			return func->funcPtr;
 		}
+
+		slot = (slot + 1) & (funcHash.size - 1);
 	}
 
 	return NULL;
@@ -345,14 +500,20 @@ FindFunctionByName(char *name)
 mmoveList_t *
 GetMmoveByAddress(mmove_t *adr)
 {
-	int i;
+	unsigned slot;
+
+	slot = HashAddress(adr, mmoveHash.size);
 
-	for (i = 0; mmoveList[i].mmoveStr; i++)
+	while (mmoveHash.byAddress[slot])
 	{
-		if (mmoveList[i].mmovePtr == adr)
+		mmoveList_t *mmove = &mmoveList[mmoveHash.byAddress[slot] - 1];
+
+		if (mmove->mmovePtr == adr)
 		{
-			return &mmoveList[i];
+			return mmove;
 		}
+
+		slot = (slot + 1) & (mmoveHash.size - 1);
 	}
 
 	return NULL;
@@ -366,20 +527,241 @@ GetMmoveByAddress(mmove_t *adr)
 mmove_t *
 FindMmoveByName(char *name)
 {
-	int i;
+	unsigned slot;
+
+	slot = HashName(name, mmoveHash.size);
 
-	for (i = 0; mmoveList[i].mmoveStr; i++)
+	while (mmoveHash.byName[slot])
 	{
-		if (!strcmp(name, mmoveList[i].mmoveStr))
+		mmoveList_t *mmove = &mmoveList[mmoveHash.byName[slot] - 1];
+
+		if (!strcmp(name, mmove->mmoveStr))
 		{
-			return mmoveList[i].mmovePtr;
+			return mmove->mmovePtr;
 		}
+
+		slot = (slot + 1) & (mmoveHash.size - 1);
 	}
 
 	return NULL;
 }
 
 
+/* ========================================================= */
+
+/*
+ * Savegames are serialized into memory
+ * and written with one call when done.
+ * If g_savecompress is set the data is
+ * deflated first. Compressed files start
+ * with SAVE_ZMAGIC and the uncompressed
+ * size, everything else is read as is,
+ * so older savegames still load.
+ */
+#define SAVE_ZMAGIC "YQ2Z"
+#define SAVE_ZHEADER (4 + sizeof(int))
+
+static void *
+SaveAlloc(void *ptr, size_t size)
+{
+	ptr = realloc(ptr, size);
+
+	if (!ptr)
+	{
+		gi.error("%s: out of memory allocating %i bytes", __func__, (int)size);
+	}
+
+	return ptr;
+}
+
+static savefile_t *
+SaveCreate(void)
+{
+	savefile_t *f;
+
+	f = SaveAlloc(NULL, sizeof(*f));
+	memset(f, 0, sizeof(*f));
+
+	return f;
+}
+
+static void
+SaveFree(savefile_t *f)
+{
+	free(f->data);
+	free(f);
+}
+
+static void
+SaveWrite(savefile_t *f, const void *data, size_t size)
+{
+	if (f->size + size > f->maxsize)
+	{
+		size_t maxsize = f->maxsize ? f->maxsize : 256 * 1024;
+
+		while (f->size + size > maxsize)
+		{
+			maxsize *= 2;
+		}
+
+		f->data = SaveAlloc(f->data, maxsize);
+		f->maxsize = maxsize;
+	}
+
+	memcpy(f->data + f->size, data, size);
+	f->size += size;
+}
+
+/*
+ * Returns 1 if size bytes could be read,
+ * 0 otherwise like fread() with a count
+ * of 1. Missing bytes are zeroed.
+ */
+static int
+SaveRead(savefile_t *f, void *data, size_t size)
+{
+	size_t left = f->size - f->readcount;
+
+	if (size > left)
+	{
+		memcpy(data, f->data + f->readcount, left);
+		memset((byte *)data + left, 0, size - left);
+		f->readcount = f->size;
+
+		return 0;
+	}
+
+	memcpy(data, f->data + f->readcount, size);
+	f->readcount += size;
+
+	return 1;
+}
+
+/*
+ * Writes the serialized data to disk
+ * and frees the buffer.
+ */
+static void
+SaveWriteFile(savefile_t *f, const char *filename)
+{
+	byte *out = f->data;
+	size_t outsize = f->size;
+	int level;
+	FILE *file;
+
+	level = (int)g_savecompress->value;
+
+	if (level > 0)
+	{
+		mz_ulong zsize = mz_compressBound(f->size);
+		int size = (int)f->size;
+
+		out = SaveAlloc(NULL, SAVE_ZHEADER + zsize);
+		memcpy(out, SAVE_ZMAGIC, 4);
+		memcpy(out + 4, &size, sizeof(size));
+
+		if (mz_compress2(out + SAVE_ZHEADER, &zsize, f->data, f->size,
+					(level > 9) ? 9 : level) != MZ_OK)
+		{
+			free(out);
+			SaveFree(f);
+			gi.error("Couldn't compress %s", filename);
+		}
+
+		outsize = SAVE_ZHEADER + zsize;
+	}
+
+	file = Q_fopen(filename, "wb");
+
+	if (!file)
+	{
+		if (out != f->data)
+		{
+			free(out);
+		}
+
+		SaveFree(f);
+		gi.error("Couldn't open %s", filename);
+	}
+
+	fwrite(out, outsize, 1, file);
+	fclose(file);
+
+	if (out != f->data)
+	{
+		free(out);
+	}
+
+	SaveFree(f);
+}
+
+/*
+ * Reads a savegame file into memory,
+ * decompressing it if necessary.
+ */
+static savefile_t *
+SaveReadFile(const char *filename)
+{
+	savefile_t *f;
+	FILE *file;
+	long len;
+
+	file = Q_fopen(filename, "rb");
+
+	if (!file)
+	{
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	f = SaveCreate();
+
+	if (len > 0)
+	{
+		f->data = SaveAlloc(NULL, len);
+
+		f->size = fread(f->data, 1, len, file);
+		f->maxsize = len;
+	}
+
+	fclose(file);
+
+	if ((f->size >= SAVE_ZHEADER) && !memcmp(f->data, SAVE_ZMAGIC, 4))
+	{
+		byte *data;
+		mz_ulong size;
+		int usize;
+
+		memcpy(&usize, f->data + 4, sizeof(usize));
+
+		if (usize <= 0)
+		{
+			SaveFree(f);
+			gi.error("%s is corrupt", filename);
+		}
+
+		data = SaveAlloc(NULL, usize);
+		size = usize;
+
+		if ((mz_uncompress(data, &size, f->data + SAVE_ZHEADER,
+					f->size - SAVE_ZHEADER) != MZ_OK) || (size != usize))
+		{
+			free(data);
+			SaveFree(f);
+			gi.error("%s is corrupt", filename);
+		}
+
+		free(f->data);
+		f->data = data;
+		f->size = f->maxsize = size;
+	}
+
+	return f;
+}
+
 /* ========================================================= */
 
 /*
@@ -389,7 +771,7 @@ FindMmoveByName(char *name)
  * below this block into files.
  */
 void
-WriteField1(FILE *f, field_t *field, byte *base)
+WriteField1(savefile_t *f, field_t *field, byte *base)
 {
 	void *p;
 	int len;
@@ -512,7 +894,7 @@ WriteField1(FILE *f, field_t *field, byte *base)
 }
 
 void
-WriteField2(FILE *f, field_t *field, byte *base)
+WriteField2(savefile_t *f, field_t *field, byte *base)
 {
 	int len;
 	void *p;
@@ -533,7 +915,7 @@ WriteField2(FILE *f, field_t *field, byte *base)
 			if (*(char **)p)
 			{
 				len = strlen(*(char **)p) + 1;
-				fwrite(*(char **)p, len, 1, f);
+				SaveWrite(f, *(char **)p, len);
 			}
 
 			break;
@@ -549,7 +931,7 @@ WriteField2(FILE *f, field_t *field, byte *base)
 				}
 
 				len = strlen(func->funcStr)+1;
-				fwrite (func->funcStr, len, 1, f);
+				SaveWrite(f, func->funcStr, len);
 			}
 
 			break;
@@ -564,7 +946,7 @@ WriteField2(FILE *f, field_t *field, byte *base)
 				}
 
 				len = strlen(mmove->mmoveStr)+1;
-				fwrite (mmove->mmoveStr, len, 1, f);
+				SaveWrite(f, mmove->mmoveStr, len);
 			}
 
 			break;
@@ -583,7 +965,7 @@ WriteField2(FILE *f, field_t *field, byte *base)
  * below
  */
 void
-ReadField(FILE *f, field_t *field, byte *base)
+ReadField(savefile_t *f, field_t *field, byte *base)
 {
 	void *p;
 	int len;
@@ -616,7 +998,7 @@ ReadField(FILE *f, field_t *field, byte *base)
 			else
 			{
 				*(char **)p = gi.TagMalloc(32 + len, TAG_LEVEL);
-				fread(*(char **)p, len, 1, f);
+				SaveRead(f, *(char **)p, len);
 			}
 
 			break;
@@ -674,7 +1056,7 @@ ReadField(FILE *f, field_t *field, byte *base)
 							(int)sizeof(funcStr));
 				}
 
-				fread (funcStr, len, 1, f);
+				SaveRead(f, funcStr, len);
 
 				if ( !(*(byte **)p = FindFunctionByName (funcStr)) )
 				{
@@ -698,7 +1080,7 @@ ReadField(FILE *f, field_t *field, byte *base)
 							(int)sizeof(funcStr));
 				}
 
-				fread (funcStr, len, 1, f);
+				SaveRead(f, funcStr, len);
 
 				if ( !(*(mmove_t **)p = FindMmoveByName (funcStr)) )
 				{
@@ -718,7 +1100,7 @@ ReadField(FILE *f, field_t *field, byte *base)
  * Write the client struct into a file.
  */
 void
-WriteClient(FILE *f, gclient_t *client)
+WriteClient(savefile_t *f, gclient_t *client)
 {
 	field_t *field;
 	gclient_t temp;
@@ -733,7 +1115,7 @@ WriteClient(FILE *f, gclient_t *client)
 	}
 
 	/* write the block */
-	fwrite(&temp, sizeof(temp), 1, f);
+	SaveWrite(f, &temp, sizeof(temp));
 
 	/* now write any allocated data following the edict */
 	for (field = clientfields; field->name; field++)
@@ -746,11 +1128,11 @@ WriteClient(FILE *f, gclient_t *client)
  * Read the client struct from a file
  */
 void
-ReadClient(FILE *f, gclient_t *client, short save_ver)
+ReadClient(savefile_t *f, gclient_t *client, short save_ver)
 {
 	field_t *field;
 
-	fread(client, sizeof(*client), 1, f);
+	SaveRead(f, client, sizeof(*client));
 
 	for (field = clientfields; field->name; field++)
 	{
@@ -782,7 +1164,7 @@ void
 WriteGame(const char *filename, qboolean autosave)
 {
 	savegameHeader_t sv;
-	FILE *f;
+	savefile_t *f;
 	int i;
 
 	if (!autosave)
@@ -790,12 +1172,7 @@ WriteGame(const char *filename, qboolean autosave)
 		SaveClientData();
 	}
 
-	f = Q_fopen(filename, "wb");
-
-	if (!f)
-	{
-		gi.error("Couldn't open %s", filename);
-	}
+	f = SaveCreate();
 
 	/* Savegame identification */
 	memset(&sv, 0, sizeof(sv));
@@ -805,10 +1182,10 @@ WriteGame(const char *filename, qboolean autosave)
 	Q_strlcpy(sv.os, YQ2OSTYPE, sizeof(sv.os) - 1);
 	Q_strlcpy(sv.arch, YQ2ARCH, sizeof(sv.arch) - 1);
 
-	fwrite(&sv, sizeof(sv), 1, f);
+	SaveWrite(f, &sv, sizeof(sv));
 
 	game.autosaved = autosave;
-	fwrite(&game, sizeof(game), 1, f);
+	SaveWrite(f, &game, sizeof(game));
 	game.autosaved = false;
 
 	for (i = 0; i < game.maxclients; i++)
@@ -816,7 +1193,7 @@ WriteGame(const char *filename, qboolean autosave)
 		WriteClient(f, &game.clients[i]);
 	}
 
-	fclose(f);
+	SaveWriteFile(f, filename);
 }
 
 /*
@@ -828,14 +1205,14 @@ void
 ReadGame(const char *filename)
 {
 	savegameHeader_t sv;
-	FILE *f;
+	savefile_t *f;
 	int i;
 
 	short save_ver = 0;
 
 	gi.FreeTags(TAG_GAME);
 
-	f = Q_fopen(filename, "rb");
+	f = SaveReadFile(filename);
 
 	if (!f)
 	{
@@ -843,7 +1220,7 @@ ReadGame(const char *filename)
 	}
 
 	/* Sanity checks */
-	fread(&sv, sizeof(sv), 1, f);
+	SaveRead(f, &sv, sizeof(sv));
 
 	static const struct {
 		const char* verstr;
@@ -868,19 +1245,19 @@ ReadGame(const char *filename)
 
 	if (save_ver == 0) // not found in mappings table
 	{
-		fclose(f);
+		SaveFree(f);
 		gi.error("Savegame from an incompatible version.\n");
 	}
 	else if (save_ver == 1)
 	{
 		if (strcmp(sv.game, GAMEVERSION) != 0)
 		{
-			fclose(f);
+			SaveFree(f);
 			gi.error("Savegame from another game.so.\n");
 		}
 		else if (strcmp(sv.os, OSTYPE_1) != 0)
 		{
-			fclose(f);
+			SaveFree(f);
 			gi.error("Savegame from another os.\n");
 		}
 
@@ -888,13 +1265,13 @@ ReadGame(const char *filename)
 		/* Windows was forced to i386 */
 		if (strcmp(sv.arch, "i386") != 0)
 		{
-			fclose(f);
+			SaveFree(f);
 			gi.error("Savegame from another architecture.\n");
 		}
 #else
 		if (strcmp(sv.arch, ARCH_1) != 0)
 		{
-			fclose(f);
+			SaveFree(f);
 			gi.error("Savegame from another architecture.\n");
 		}
 #endif
@@ -903,12 +1280,12 @@ ReadGame(const char *filename)
 	{
 		if (strcmp(sv.game, GAMEVERSION) != 0)
 		{
-			fclose(f);
+			SaveFree(f);
 			gi.error("Savegame from another game.so.\n");
 		}
 		else if (strcmp(sv.os, YQ2OSTYPE) != 0)
 		{
-			fclose(f);
+			SaveFree(f);
 			gi.error("Savegame from another os.\n");
 		}
 		else if (strcmp(sv.arch, YQ2ARCH) != 0)
@@ -921,7 +1298,7 @@ ReadGame(const char *filename)
 			if (save_ver >= 4 || strcmp(sv.arch, "AMD64") != 0)
 #endif
 			{
-				fclose(f);
+				SaveFree(f);
 				gi.error("Savegame from another architecture.\n");
 			}
 		}
@@ -929,8 +1306,9 @@ ReadGame(const char *filename)
 
 	g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
+	G_IndexInit();
 
-	fread(&game, sizeof(game), 1, f);
+	SaveRead(f, &game, sizeof(game));
 	game.clients = gi.TagMalloc(game.maxclients * sizeof(game.clients[0]),
 			TAG_GAME);
 
@@ -939,7 +1317,7 @@ ReadGame(const char *filename)
 		ReadClient(f, &game.clients[i], save_ver);
 	}
 
-	fclose(f);
+	SaveFree(f);
 }
 
 /* ========================================================== */
@@ -950,7 +1328,7 @@ ReadGame(const char *filename)
  * WriteLevel.
  */
 void
-WriteEdict(FILE *f, edict_t *ent)
+WriteEdict(savefile_t *f, edict_t *ent)
 {
 	field_t *field;
 	edict_t temp;
@@ -965,7 +1343,7 @@ WriteEdict(FILE *f, edict_t *ent)
 	}
 
 	/* write the block */
-	fwrite(&temp, sizeof(temp), 1, f);
+	SaveWrite(f, &temp, sizeof(temp));
 
 	/* now write any allocated data following the edict */
 	for (field = fields; field->name; field++)
@@ -980,7 +1358,7 @@ WriteEdict(FILE *f, edict_t *ent)
  * Called by WriteLevel.
  */
 void
-WriteLevelLocals(FILE *f)
+WriteLevelLocals(savefile_t *f)
 {
 	field_t *field;
 	level_locals_t temp;
@@ -995,7 +1373,7 @@ WriteLevelLocals(FILE *f)
 	}
 
 	/* write the block */
-	fwrite(&temp, sizeof(temp), 1, f);
+	SaveWrite(f, &temp, sizeof(temp));
 
 	/* now write any allocated data following the edict */
 	for (field = levelfields; field->name; field++)
@@ -1013,18 +1391,13 @@ WriteLevel(const char *filename)
 {
 	int i;
 	edict_t *ent;
-	FILE *f;
+	savefile_t *f;
 
-	f = Q_fopen(filename, "wb");
-
-	if (!f)
-	{
-		gi.error("Couldn't open %s", filename);
-	}
+	f = SaveCreate();
 
 	/* write out edict size for checking */
 	i = sizeof(edict_t);
-	fwrite(&i, sizeof(i), 1, f);
+	SaveWrite(f, &i, sizeof(i));
 
 	/* write out level_locals_t */
 	WriteLevelLocals(f);
@@ -1039,14 +1412,14 @@ WriteLevel(const char *filename)
 			continue;
 		}
 
-		fwrite(&i, sizeof(i), 1, f);
+		SaveWrite(f, &i, sizeof(i));
 		WriteEdict(f, ent);
 	}
 
 	i = -1;
-	fwrite(&i, sizeof(i), 1, f);
+	SaveWrite(f, &i, sizeof(i));
 
-	fclose(f);
+	SaveWriteFile(f, filename);
 }
 
 /* ========================================================== */
@@ -1058,11 +1431,11 @@ WriteLevel(const char *filename)
  * by ReadLevel.
  */
 void
-ReadEdict(FILE *f, edict_t *ent)
+ReadEdict(savefile_t *f, edict_t *ent)
 {
 	field_t *field;
 
-	fread(ent, sizeof(*ent), 1, f);
+	SaveRead(f, ent, sizeof(*ent));
 
 	for (field = fields; field->name; field++)
 	{
@@ -1077,11 +1450,11 @@ ReadEdict(FILE *f, edict_t *ent)
  * Called by ReadLevel.
  */
 void
-ReadLevelLocals(FILE *f)
+ReadLevelLocals(savefile_t *f)
 {
 	field_t *field;
 
-	fread(&level, sizeof(level), 1, f);
+	SaveRead(f, &level, sizeof(level));
 
 	for (field = levelfields; field->name; field++)
 	{
@@ -1102,11 +1475,11 @@ void
 ReadLevel(const char *filename)
 {
 	int entnum;
-	FILE *f;
+	savefile_t *f;
 	int i;
 	edict_t *ent;
 
-	f = Q_fopen(filename, "rb");
+	f = SaveReadFile(filename);
 
 	if (!f)
 	{
@@ -1120,13 +1493,14 @@ ReadLevel(const char *filename)
 	/* wipe all the entities */
 	memset(g_edicts, 0, game.maxentities * sizeof(g_edicts[0]));
 	globals.num_edicts = maxclients->value + 1;
+	G_IndexClear();
 
 	/* check edict size */
-	fread(&i, sizeof(i), 1, f);
+	SaveRead(f, &i, sizeof(i));
 
 	if (i != sizeof(edict_t))
 	{
-		fclose(f);
+		SaveFree(f);
 		gi.error("ReadLevel: mismatched edict size");
 	}
 
@@ -1136,9 +1510,9 @@ ReadLevel(const char *filename)
 	/* load all the entities */
 	while (1)
 	{
-		if (fread(&entnum, sizeof(entnum), 1, f) != 1)
+		if (SaveRead(f, &entnum, sizeof(entnum)) != 1)
 		{
-			fclose(f);
+			SaveFree(f);
 			gi.error("ReadLevel: failed to read entnum");
 		}
 
@@ -1160,7 +1534,7 @@ ReadLevel(const char *filename)
 		gi.linkentity(ent);
 	}
 
-	fclose(f);
+	SaveFree(f);
 
 	/* mark all clients as unconnected */
 	for (i = 0; i < maxclients->value; i++)
@@ -45,6 +45,17 @@ typedef struct
 	mmove_t *mmovePtr;
 } mmoveList_t;
 
+/*
+ * A savegame serialized in memory
+ */
+typedef struct
+{
+	byte *data;
+	size_t size;
+	size_t maxsize;
+	size_t readcount;
+} savefile_t;
+
 typedef struct
 {
     char ver[32];
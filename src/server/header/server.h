@@ -156,7 +156,9 @@ typedef struct
 typedef struct
 {
 	qboolean initialized;               /* sv_init has completed */
+	qboolean inframe;                   /* SV_Frame() is running */
 	int realtime;                       /* always increasing, no clamping, etc */
+	int realtime_usec;                  /* microseconds not yet added to realtime */
 
 	char mapcmd[MAX_SAVE_TOKEN_CHARS];  /* ie: *intro.cin+base */
 
@@ -193,12 +195,18 @@ extern cvar_t *sv_airaccelerate;            /* don't reload level state when ree
 											/* development tool */
 extern cvar_t *sv_enforcetime;
 extern cvar_t *sv_downloadserver;			/* Download server. */
+extern cvar_t *sv_threads;
+extern cvar_t *sv_threads_check;
+extern cvar_t *sv_areatree;
+extern cvar_t *sv_tracecache;
+extern cvar_t *sv_tracecache_hitrate;
 
 extern client_t *sv_client;
 extern edict_t *sv_player;
 
 void SV_FinalMessage(char *message, qboolean reconnect);
 void SV_DropClient(client_t *drop);
+void SV_TickStats_f(void);
 
 int SV_ModelIndex(const char *name);
 int SV_SoundIndex(const char *name);
@@ -244,9 +252,23 @@ void SV_ReadLevelFile(void);
 char *SV_StatusString(void);
 void SV_ConnectionlessPacket(void);
 
+/* per thread scratch space for building client frames */
+typedef struct
+{
+	YQ2_ALIGNAS_TYPE(int32_t) byte fatpvs[MAX_MAP_LEAFS / 8];
+	YQ2_ALIGNAS_TYPE(int32_t) byte pvs[MAX_MAP_LEAFS / 8];
+	byte phs[MAX_MAP_LEAFS / 8];
+} sv_visscratch_t;
+
 void SV_WriteFrameToClient(client_t *client, sizebuf_t *msg);
 void SV_RecordDemoMessage(void);
 void SV_BuildClientFrame(client_t *client);
+qboolean SV_BuildClientFrameList(client_t *client, sv_visscratch_t *scratch,
+		short *list, int *count);
+void SV_FixEntityNumbers(const short *list, int count);
+client_frame_t *SV_DeltaFrame(client_t *client);
+void SV_ReserveClientFrame(client_t *client, int count);
+void SV_CopyClientFrameEntities(client_t *client, const short *list);
 
 extern game_export_t *ge;
 
@@ -280,9 +302,28 @@ int SV_AreaEdicts(vec3_t mins, vec3_t maxs, edict_t **list,
 		int maxcount, int areatype);
 
 int SV_PointContents(vec3_t p);
+void SV_AreaStats_f(void);
 
 trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs,
 		vec3_t end, edict_t *passedict, int contentmask);
+void SV_Traces(const tracerequest_t *requests, trace_t *results, int count);
+void SV_TraceCacheFrame(void);
+
+/* sv_bench.c */
+typedef enum
+{
+	SVB_FRAME,
+	SVB_READPACKETS,
+	SVB_RUNGAMEFRAME,
+	SVB_SENDMESSAGES,
+	SVB_NUMPHASES
+} benchphase_t;
+
+void SV_BenchBegin(int phase);
+void SV_BenchEnd(int phase);
+void SV_BenchAbort(void);
+qboolean SV_BenchGetPacket(void);
+void SV_Bench_f(void);
 
 #endif
 
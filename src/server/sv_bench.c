@@ -0,0 +1,615 @@
+/*
+ * Copyright (C) 1997-2001 Id Software, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ * =======================================================================
+ *
+ * Server benchmark. Connects a number of fake clients to the running
+ * map and runs server frames back to back, while timing the phases of
+ * SV_Frame(). The fake clients live in this process, their packets are
+ * real protocol packets and enter the server through SV_ReadPackets().
+ * They have loopback addresses, so everything the server sends them
+ * goes through the loopback path. Since nothing ever gets lost on the
+ * way, the clients don't parse what they receive but acknowledge what
+ * the server sent them.
+ *
+ * =======================================================================
+ */
+
+#include "header/server.h"
+
+#define BENCH_MAXFRAMES 36000
+#define BENCH_CONNECTFRAMES 50
+#define BENCH_CONNECTRATE 2     /* new clients per frame */
+#define BENCH_WARMUPFRAMES 20
+#define BENCH_QPORT 0xb000
+
+typedef enum
+{
+	bot_idle,
+	bot_connecting,
+	bot_connected,
+	bot_spawned,
+	bot_dropped
+} botstate_t;
+
+typedef struct
+{
+	botstate_t state;
+	client_t *cl;
+
+	netadr_t adr;
+	int qport;
+
+	/* the fake side of the netchan */
+	int outgoing_sequence;
+	int incoming_sequence;
+	int incoming_reliable_sequence;
+	int lastframe;
+
+	/* the last three commands, resent
+	   with every packet like the client */
+	usercmd_t cmds[3];
+
+	/* movement script */
+	unsigned seed;
+	int nextturn;
+	float yaw;
+	int forwardmove;
+	int sidemove;
+	int upmove;
+	int buttons;
+
+	byte packet[MAX_MSGLEN];
+	int packetlen;
+} benchbot_t;
+
+static struct
+{
+	benchbot_t *bots;
+	int numbots;
+	int nextpacket;
+
+	/* phase timings are only taken while measuring */
+	qboolean measuring;
+	int numframes;
+	long long start[SVB_NUMPHASES];
+	int *samples[SVB_NUMPHASES];
+} bench;
+
+static const char *bench_phasenames[SVB_NUMPHASES] = {
+	"frame",
+	"readpackets",
+	"rungameframe",
+	"sendmessages"
+};
+
+void
+SV_BenchBegin(int phase)
+{
+	if (bench.measuring)
+	{
+		bench.start[phase] = Sys_Microseconds();
+	}
+}
+
+void
+SV_BenchEnd(int phase)
+{
+	if (bench.measuring && bench.start[phase])
+	{
+		bench.samples[phase][bench.numframes] =
+			(int)(Sys_Microseconds() - bench.start[phase]);
+		bench.start[phase] = 0;
+
+		if (phase == SVB_FRAME)
+		{
+			bench.numframes++;
+		}
+	}
+}
+
+/*
+ * Drops the timings of a frame that
+ * returned before doing any work.
+ */
+void
+SV_BenchAbort(void)
+{
+	if (bench.measuring)
+	{
+		bench.start[SVB_FRAME] = 0;
+	}
+}
+
+/*
+ * Hands the next queued packet of a fake
+ * client to SV_ReadPackets().
+ */
+qboolean
+SV_BenchGetPacket(void)
+{
+	benchbot_t *bot;
+
+	for ( ; bench.nextpacket < bench.numbots; bench.nextpacket++)
+	{
+		bot = &bench.bots[bench.nextpacket];
+
+		if (!bot->packetlen)
+		{
+			continue;
+		}
+
+		memcpy(net_message.data, bot->packet, bot->packetlen);
+		net_message.cursize = bot->packetlen;
+		net_from = bot->adr;
+		bot->packetlen = 0;
+
+		bench.nextpacket++;
+		return true;
+	}
+
+	return false;
+}
+
+static int
+SV_BenchRandom(benchbot_t *bot, int range)
+{
+	bot->seed = bot->seed * 1103515245 + 12345;
+
+	return (bot->seed >> 16) % range;
+}
+
+/*
+ * Every one to three seconds the bot turns up
+ * to 90 degrees, picks a strafe direction and
+ * decides whether to jump and fire.
+ */
+static void
+SV_BenchScript(benchbot_t *bot)
+{
+	usercmd_t *cmd;
+
+	if (--bot->nextturn <= 0)
+	{
+		bot->nextturn = 10 + SV_BenchRandom(bot, 20);
+		bot->yaw += SV_BenchRandom(bot, 181) - 90;
+		bot->forwardmove = 300;
+		bot->sidemove = (SV_BenchRandom(bot, 3) - 1) * 200;
+		bot->upmove = (SV_BenchRandom(bot, 8) == 0) ? 200 : 0;
+		bot->buttons = (SV_BenchRandom(bot, 3) == 0) ? BUTTON_ATTACK : 0;
+	}
+
+	bot->cmds[0] = bot->cmds[1];
+	bot->cmds[1] = bot->cmds[2];
+
+	cmd = &bot->cmds[2];
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->msec = 100;
+	cmd->angles[YAW] = ANGLE2SHORT(bot->yaw);
+	cmd->forwardmove = bot->forwardmove;
+	cmd->sidemove = bot->sidemove;
+	cmd->upmove = bot->upmove;
+	cmd->buttons = bot->buttons;
+	cmd->lightlevel = 128;
+}
+
+static void
+SV_BenchQueueConnect(benchbot_t *bot, int num)
+{
+	sizebuf_t buf;
+	char *s;
+
+	s = va("connect %i %i 0 \"\\name\\bench%i\\skin\\male/grunt"
+			"\\rate\\15000\\msg\\4\\hand\\0\"\n", PROTOCOL_VERSION,
+			bot->qport, num);
+
+	SZ_Init(&buf, bot->packet, sizeof(bot->packet));
+	MSG_WriteLong(&buf, -1);
+	SZ_Write(&buf, s, strlen(s));
+
+	bot->packetlen = buf.cursize;
+}
+
+static void
+SV_BenchQueuePacket(benchbot_t *bot)
+{
+	sizebuf_t buf;
+	qboolean reliable;
+	int checksumIndex;
+	usercmd_t nullcmd;
+
+	/* the string commands are sent reliable
+	   with the first packet after connecting */
+	reliable = (bot->state == bot_connected) &&
+		(bot->outgoing_sequence == 1);
+
+	SZ_Init(&buf, bot->packet, sizeof(bot->packet));
+
+	MSG_WriteLong(&buf, (bot->outgoing_sequence & ~(1U << 31)) |
+			((unsigned)reliable << 31));
+	MSG_WriteLong(&buf, (bot->incoming_sequence & ~(1U << 31)) |
+			((unsigned)bot->incoming_reliable_sequence << 31));
+	MSG_WriteShort(&buf, bot->qport);
+
+	if (reliable)
+	{
+		MSG_WriteByte(&buf, clc_stringcmd);
+		MSG_WriteString(&buf, "new");
+		MSG_WriteByte(&buf, clc_stringcmd);
+		MSG_WriteString(&buf, va("begin %i", svs.spawncount));
+	}
+
+	SV_BenchScript(bot);
+
+	MSG_WriteByte(&buf, clc_move);
+	checksumIndex = buf.cursize;
+	MSG_WriteByte(&buf, 0);
+	MSG_WriteLong(&buf, bot->lastframe);
+
+	memset(&nullcmd, 0, sizeof(nullcmd));
+	MSG_WriteDeltaUsercmd(&buf, &nullcmd, &bot->cmds[0]);
+	MSG_WriteDeltaUsercmd(&buf, &bot->cmds[0], &bot->cmds[1]);
+	MSG_WriteDeltaUsercmd(&buf, &bot->cmds[1], &bot->cmds[2]);
+
+	buf.data[checksumIndex] = COM_BlockSequenceCRCByte(
+			buf.data + checksumIndex + 1, buf.cursize - checksumIndex - 1,
+			bot->outgoing_sequence);
+
+	bot->outgoing_sequence++;
+	bot->packetlen = buf.cursize;
+}
+
+/*
+ * Connecting all clients at once would overflow
+ * their reliable messages with the connect and
+ * skin broadcasts of each other, so they trickle
+ * in like real players.
+ */
+static void
+SV_BenchQueuePackets(void)
+{
+	int i, connects;
+
+	for (i = 0, connects = 0; i < bench.numbots; i++)
+	{
+		switch (bench.bots[i].state)
+		{
+			case bot_idle:
+
+				if (connects < BENCH_CONNECTRATE)
+				{
+					SV_BenchQueueConnect(&bench.bots[i], i);
+					bench.bots[i].state = bot_connecting;
+					connects++;
+				}
+
+				break;
+
+			case bot_connected:
+			case bot_spawned:
+				SV_BenchQueuePacket(&bench.bots[i]);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	bench.nextpacket = 0;
+}
+
+/*
+ * Called after each frame. Instead of parsing what
+ * the server sent, the bots take the sequence numbers
+ * right out of the server side netchan.
+ */
+static void
+SV_BenchReceive(void)
+{
+	benchbot_t *bot;
+	client_t *cl;
+	int i, j;
+
+	for (i = 0; i < bench.numbots; i++)
+	{
+		bot = &bench.bots[i];
+
+		if (bot->state == bot_connecting)
+		{
+			for (j = 0, cl = svs.clients; j < maxclients->value; j++, cl++)
+			{
+				if ((cl->state >= cs_connected) &&
+					(cl->netchan.remote_address.type == NA_LOOPBACK) &&
+					(cl->netchan.qport == bot->qport))
+				{
+					bot->cl = cl;
+					bot->state = bot_connected;
+					break;
+				}
+			}
+
+			continue;
+		}
+
+		if ((bot->state == bot_idle) || (bot->state == bot_dropped))
+		{
+			continue;
+		}
+
+		cl = bot->cl;
+
+		if ((cl->state < cs_connected) || (cl->netchan.qport != bot->qport))
+		{
+			bot->state = bot_dropped;
+			continue;
+		}
+
+		bot->incoming_sequence = cl->netchan.outgoing_sequence - 1;
+		bot->incoming_reliable_sequence = cl->netchan.reliable_sequence;
+
+		if (cl->state == cs_spawned)
+		{
+			bot->state = bot_spawned;
+			bot->lastframe = sv.framenum;
+		}
+	}
+}
+
+static int
+SV_BenchCount(botstate_t state)
+{
+	int i, count;
+
+	for (i = 0, count = 0; i < bench.numbots; i++)
+	{
+		if (bench.bots[i].state == state)
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/*
+ * Runs one frame, as if 100 msec had passed.
+ */
+static qboolean
+SV_BenchFrame(void)
+{
+	int spawncount = svs.spawncount;
+
+	SV_BenchQueuePackets();
+	SV_Frame(100 * 1000);
+	SV_BenchReceive();
+
+	/* the map changed or the server was killed */
+	return (sv.state == ss_game) && (svs.spawncount == spawncount);
+}
+
+static int
+SV_BenchCompare(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+static void
+SV_BenchReport(int frametime)
+{
+	int i, j, n, monsters;
+	double mean;
+	int *s;
+
+	n = bench.numframes;
+
+	for (i = 1, monsters = 0; i < ge->num_edicts; i++)
+	{
+		edict_t *ent = EDICT_NUM(i);
+
+		if (ent->inuse && (ent->svflags & SVF_MONSTER))
+		{
+			monsters++;
+		}
+	}
+
+	Com_Printf("%i clients, %i frames, %i edicts, %i monsters\n",
+			SV_BenchCount(bot_spawned), n, ge->num_edicts, monsters);
+	Com_Printf("phase          mean    p50    p90    p99    max usec\n");
+
+	for (i = 0; i < SVB_NUMPHASES; i++)
+	{
+		s = bench.samples[i];
+		qsort(s, n, sizeof(s[0]), SV_BenchCompare);
+
+		for (j = 0, mean = 0; j < n; j++)
+		{
+			mean += s[j];
+		}
+
+		Com_Printf("%-12s %6.0f %6i %6i %6i %6i\n", bench_phasenames[i],
+				mean / n, s[n * 50 / 100], s[n * 90 / 100], s[n * 99 / 100],
+				s[n - 1]);
+	}
+
+	/* the frame samples are sorted now */
+	Com_Printf("p99 frame uses %.1f%% of the %i msec frame budget\n",
+			bench.samples[SVB_FRAME][n * 99 / 100] / (frametime * 10.0f),
+			frametime);
+}
+
+static void
+SV_BenchShutdown(void)
+{
+	int i;
+
+	for (i = 0; i < bench.numbots; i++)
+	{
+		if (((bench.bots[i].state == bot_connected) ||
+			 (bench.bots[i].state == bot_spawned)) &&
+			(bench.bots[i].cl->state >= cs_connected))
+		{
+			SV_DropClient(bench.bots[i].cl);
+		}
+	}
+
+	for (i = 0; i < SVB_NUMPHASES; i++)
+	{
+		if (bench.samples[i])
+		{
+			Z_Free(bench.samples[i]);
+		}
+	}
+
+	if (bench.bots)
+	{
+		Z_Free(bench.bots);
+	}
+
+	memset(&bench, 0, sizeof(bench));
+}
+
+/*
+ * sv_bench <clients> [frames]
+ */
+void
+SV_Bench_f(void)
+{
+	int numbots, numframes, numfree, i;
+	benchbot_t *bot;
+
+	if ((Cmd_Argc() < 2) || (Cmd_Argc() > 3))
+	{
+		Com_Printf("Usage: sv_bench <clients> [frames]\n");
+		return;
+	}
+
+	if (!dedicated->value)
+	{
+		Com_Printf("sv_bench only works on dedicated servers.\n");
+		return;
+	}
+
+	if (!svs.initialized || (sv.state != ss_game))
+	{
+		Com_Printf("No map running.\n");
+		return;
+	}
+
+	/* e.g. over rcon, the frames would nest */
+	if (svs.inframe)
+	{
+		Com_Printf("sv_bench can't run from within a server frame.\n");
+		return;
+	}
+
+	numbots = (int)strtol(Cmd_Argv(1), (char **)NULL, 10);
+	numframes = (Cmd_Argc() > 2) ? (int)strtol(Cmd_Argv(2), (char **)NULL, 10) : 300;
+
+	for (i = 0, numfree = 0; i < maxclients->value; i++)
+	{
+		if (svs.clients[i].state == cs_free)
+		{
+			numfree++;
+		}
+	}
+
+	if ((numbots < 0) || (numbots > numfree))
+	{
+		Com_Printf("Need 0 to %i clients, raise maxclients for more.\n", numfree);
+		return;
+	}
+
+	if (numframes < 10)
+	{
+		numframes = 10;
+	}
+	else if (numframes > BENCH_MAXFRAMES)
+	{
+		numframes = BENCH_MAXFRAMES;
+	}
+
+	bench.numbots = numbots;
+	bench.bots = Z_Malloc(numbots * sizeof(benchbot_t));
+
+	for (i = 0; i < SVB_NUMPHASES; i++)
+	{
+		bench.samples[i] = Z_Malloc(numframes * sizeof(int));
+	}
+
+	for (i = 0; i < numbots; i++)
+	{
+		bot = &bench.bots[i];
+
+		bot->qport = BENCH_QPORT + i;
+		bot->adr.type = NA_LOOPBACK;
+		bot->adr.port = BigShort(BENCH_QPORT + i);
+		bot->outgoing_sequence = 1;
+		bot->lastframe = -1;
+		bot->seed = i + 1;
+	}
+
+	/* connect and spawn the bots */
+	for (i = 0; SV_BenchCount(bot_spawned) < numbots; i++)
+	{
+		if (i == numbots / BENCH_CONNECTRATE + BENCH_CONNECTFRAMES)
+		{
+			Com_Printf("sv_bench: only %i of %i clients spawned, aborting.\n",
+					SV_BenchCount(bot_spawned), numbots);
+			SV_BenchShutdown();
+			return;
+		}
+
+		if (!SV_BenchFrame())
+		{
+			Com_Printf("sv_bench: map changed, aborting.\n");
+			SV_BenchShutdown();
+			return;
+		}
+	}
+
+	for (i = 0; i < BENCH_WARMUPFRAMES; i++)
+	{
+		if (!SV_BenchFrame())
+		{
+			Com_Printf("sv_bench: map changed, aborting.\n");
+			SV_BenchShutdown();
+			return;
+		}
+	}
+
+	/* and measure */
+	bench.measuring = true;
+
+	for (i = 0; i < numframes; i++)
+	{
+		if (!SV_BenchFrame())
+		{
+			break;
+		}
+	}
+
+	bench.measuring = false;
+
+	if (bench.numframes > 0)
+	{
+		SV_BenchReport(100);
+	}
+
+	SV_BenchShutdown();
+}
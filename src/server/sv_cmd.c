@@ -782,5 +782,9 @@ SV_InitOperatorCommands(void)
 	Cmd_AddCommand("killserver", SV_KillServer_f);
 
 	Cmd_AddCommand("sv", SV_ServerCommand_f);
+
+	Cmd_AddCommand("sv_areastats", SV_AreaStats_f);
+	Cmd_AddCommand("sv_bench", SV_Bench_f);
+	Cmd_AddCommand("sv_tickstats", SV_TickStats_f);
 }
 
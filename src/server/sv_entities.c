@@ -390,34 +390,40 @@ SV_WritePlayerstateToClient(client_frame_t *from, client_frame_t *to,
 	}
 }
 
-void
-SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
+/*
+ * Returns the frame the next frame of
+ * the client is delta compressed from.
+ */
+client_frame_t *
+SV_DeltaFrame(client_t *client)
 {
-	client_frame_t *frame, *oldframe;
-	int lastframe;
-
-	/* this is the frame we are creating */
-	frame = &client->frames[sv.framenum & UPDATE_MASK];
-
 	if (client->lastframe <= 0)
 	{
 		/* client is asking for a retransmit */
-		oldframe = NULL;
-		lastframe = -1;
+		return NULL;
 	}
 	else if (sv.framenum - client->lastframe >= (UPDATE_BACKUP - 3))
 	{
 		/* client hasn't gotten a good message through in a long time */
-		oldframe = NULL;
-		lastframe = -1;
-	}
-	else
-	{
-		/* we have a valid message to delta from */
-		oldframe = &client->frames[client->lastframe & UPDATE_MASK];
-		lastframe = client->lastframe;
+		return NULL;
 	}
 
+	/* we have a valid message to delta from */
+	return &client->frames[client->lastframe & UPDATE_MASK];
+}
+
+void
+SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
+{
+	client_frame_t *frame, *oldframe;
+	int lastframe;
+
+	/* this is the frame we are creating */
+	frame = &client->frames[sv.framenum & UPDATE_MASK];
+
+	oldframe = SV_DeltaFrame(client);
+	lastframe = oldframe ? client->lastframe : -1;
+
 	MSG_WriteByte(msg, svc_frame);
 	MSG_WriteLong(msg, sv.framenum);
 	MSG_WriteLong(msg, lastframe); /* what we are delta'ing from */
@@ -435,18 +441,40 @@ SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
 	SV_EmitPacketEntities(oldframe, frame, msg);
 }
 
+static const byte *
+SV_ClusterPVS(int cluster, sv_visscratch_t *scratch)
+{
+	if (scratch)
+	{
+		return CM_ClusterPVSBuffer(cluster, scratch->pvs);
+	}
+
+	return CM_ClusterPVS(cluster);
+}
+
+static const byte *
+SV_ClusterPHS(int cluster, sv_visscratch_t *scratch)
+{
+	if (scratch)
+	{
+		return CM_ClusterPHSBuffer(cluster, scratch->phs);
+	}
+
+	return CM_ClusterPHS(cluster);
+}
+
 /*
  * The client will interpolate the view position,
  * so we can't use a single PVS point
  */
 static void
-SV_FatPVS(vec3_t org)
+SV_FatPVS(vec3_t org, byte *fat, sv_visscratch_t *scratch)
 {
 	int leafs[64];
 	int i, j, count;
 	// DG: used to be called "longs" and long was used which isn't really correct on 64bit
 	int32_t numInt32s;
-	byte *src;
+	const byte *src;
 	vec3_t mins, maxs;
 
 	for (i = 0; i < 3; i++)
@@ -470,7 +498,7 @@ SV_FatPVS(vec3_t org)
 		leafs[i] = CM_LeafCluster(leafs[i]);
 	}
 
-	memcpy(fatpvs, CM_ClusterPVS(leafs[0]), numInt32s << 2);
+	memcpy(fat, SV_ClusterPVS(leafs[0], scratch), numInt32s << 2);
 
 	/* or in all the other leaf bits */
 	for (i = 1; i < count; i++)
@@ -488,39 +516,43 @@ SV_FatPVS(vec3_t org)
 			continue; /* already have the cluster we want */
 		}
 
-		src = CM_ClusterPVS(leafs[i]);
+		src = SV_ClusterPVS(leafs[i], scratch);
 
 		for (j = 0; j < numInt32s; j++)
 		{
-			((int32_t *)fatpvs)[j] |= ((int32_t *)src)[j];
+			((int32_t *)fat)[j] |= ((const int32_t *)src)[j];
 		}
 	}
 }
 
 /*
  * Decides which entities are going to be visible to the client, and
- * copies off the playerstat and areabits.
+ * copies off the playerstat and areabits. The numbers of the visible
+ * entities are stored in list, svs.client_entities isn't touched.
+ * With scratch given nothing but the client itself is written to and
+ * it's safe to call this for several clients in parallel.
  */
-void
-SV_BuildClientFrame(client_t *client)
+qboolean
+SV_BuildClientFrameList(client_t *client, sv_visscratch_t *scratch,
+		short *list, int *count)
 {
 	int e, i;
 	vec3_t org;
 	edict_t *ent;
 	edict_t *clent;
 	client_frame_t *frame;
-	entity_state_t *state;
 	int l;
 	int clientarea, clientcluster;
 	int leafnum;
-	byte *clientphs;
-	byte *bitvector;
+	byte *fat;
+	const byte *clientphs;
+	const byte *bitvector;
 
 	clent = client->edict;
 
 	if (!clent->client)
 	{
-		return; /* not in game yet */
+		return false; /* not in game yet */
 	}
 
 	/* this is the frame we are creating */
@@ -545,12 +577,12 @@ SV_BuildClientFrame(client_t *client)
 	/* grab the current player_state_t */
 	frame->ps = clent->client->ps;
 
-	SV_FatPVS(org);
-	clientphs = CM_ClusterPHS(clientcluster);
+	fat = scratch ? scratch->fatpvs : fatpvs;
+	SV_FatPVS(org, fat, scratch);
+	clientphs = SV_ClusterPHS(clientcluster, scratch);
 
 	/* build up the list of visible entities */
-	frame->num_entities = 0;
-	frame->first_entity = svs.next_client_entities;
+	*count = 0;
 
 	for (e = 1; e < ge->num_edicts; e++)
 	{
@@ -596,7 +628,7 @@ SV_BuildClientFrame(client_t *client)
 			}
 			else
 			{
-				bitvector = fatpvs;
+				bitvector = fat;
 
 				if (ent->num_clusters == -1)
 				{
@@ -643,15 +675,48 @@ SV_BuildClientFrame(client_t *client)
 			}
 		}
 
-		/* add it to the circular client_entities array */
-		state = &svs.client_entities[svs.next_client_entities %
-				svs.num_client_entities];
+		list[(*count)++] = e;
+	}
 
-		if (ent->s.number != e)
-		{
-			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
-			ent->s.number = e;
-		}
+	return true;
+}
+
+/*
+ * Reserves the range of the frame in the circular
+ * client_entities array. Must be called in client order.
+ */
+void
+SV_ReserveClientFrame(client_t *client, int count)
+{
+	client_frame_t *frame;
+
+	frame = &client->frames[sv.framenum & UPDATE_MASK];
+
+	frame->num_entities = count;
+	frame->first_entity = svs.next_client_entities;
+	svs.next_client_entities += count;
+}
+
+/*
+ * Copies the states of the listed entities into the
+ * range reserved by SV_ReserveClientFrame().
+ */
+void
+SV_CopyClientFrameEntities(client_t *client, const short *list)
+{
+	client_frame_t *frame;
+	entity_state_t *state;
+	edict_t *ent;
+	int i;
+
+	frame = &client->frames[sv.framenum & UPDATE_MASK];
+
+	for (i = 0; i < frame->num_entities; i++)
+	{
+		ent = EDICT_NUM(list[i]);
+
+		state = &svs.client_entities[(frame->first_entity + i) %
+				svs.num_client_entities];
 
 		*state = ent->s;
 
@@ -660,10 +725,45 @@ SV_BuildClientFrame(client_t *client)
 		{
 			state->solid = 0;
 		}
+	}
+}
+
+/*
+ * Fixes up the numbers of the listed entities. Writes to
+ * the edicts, so it must not run in parallel.
+ */
+void
+SV_FixEntityNumbers(const short *list, int count)
+{
+	edict_t *ent;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		ent = EDICT_NUM(list[i]);
+
+		if (ent->s.number != list[i])
+		{
+			Com_DPrintf("FIXING ENT->S.NUMBER!!!\n");
+			ent->s.number = list[i];
+		}
+	}
+}
+
+void
+SV_BuildClientFrame(client_t *client)
+{
+	static short list[MAX_EDICTS];
+	int count;
 
-		svs.next_client_entities++;
-		frame->num_entities++;
+	if (!SV_BuildClientFrameList(client, NULL, list, &count))
+	{
+		return;
 	}
+
+	SV_FixEntityNumbers(list, count);
+	SV_ReserveClientFrame(client, count);
+	SV_CopyClientFrameEntities(client, list);
 }
 
 /*
@@ -51,6 +51,11 @@ cvar_t *hostname;
 cvar_t *public_server; /* should heartbeats be sent */
 cvar_t *sv_entfile; /* External entity files. */
 cvar_t *sv_downloadserver; /* Download server. */
+cvar_t *sv_threads; /* worker threads for building client frames */
+cvar_t *sv_threads_check; /* compare threaded frames with the serial path */
+cvar_t *sv_areatree; /* depth of the area tree, 0 = automatic */
+cvar_t *sv_tracecache; /* remember traces until something moves */
+cvar_t *sv_tracecache_hitrate; /* percentage, updated every second */
 
 /*
  * Called when the player is totally leaving the server, either willingly
@@ -200,7 +205,8 @@ SV_ReadPackets(void)
 	client_t *cl;
 	int qport;
 
-	while (NET_GetPacket(NS_SERVER, &net_from, &net_message))
+	while (NET_GetPacket(NS_SERVER, &net_from, &net_message) ||
+		   SV_BenchGetPacket())
 	{
 		/* check for connectionless packet (0xffffffff) first */
 		if (*(int *)net_message.data == -1)
@@ -345,11 +351,17 @@ SV_RunGameFrame(void)
 	sv.framenum++;
 	sv.time = sv.framenum * 100;
 
+	SV_TraceCacheFrame();
+
 	/* don't run if paused */
 	if (!sv_paused->value || (maxclients->value > 1))
 	{
+		long long profstart = Prof_Begin();
+
 		ge->RunFrame();
 
+		Prof_End(PROF_G_RUNFRAME, profstart);
+
 		/* never get more than one tic behind */
 		if (sv.time < svs.realtime)
 		{
@@ -370,20 +382,114 @@ SV_RunGameFrame(void)
 #endif
 }
 
+/*
+ * How late the game frames start, in microseconds.
+ * Printed by sv_tickstats.
+ */
+static const int sv_ticklimits[] = {50, 100, 250, 500, 1000, 2000, 5000, 10000};
+
+static struct
+{
+	int counts[sizeof(sv_ticklimits) / sizeof(sv_ticklimits[0]) + 1];
+	int frames;
+	int max;
+	long long total;
+} sv_tickstats;
+
+static void
+SV_RecordTickLateness(int usec)
+{
+	int i;
+
+	for (i = 0; i < sizeof(sv_ticklimits) / sizeof(sv_ticklimits[0]); i++)
+	{
+		if (usec < sv_ticklimits[i])
+		{
+			break;
+		}
+	}
+
+	sv_tickstats.counts[i]++;
+	sv_tickstats.frames++;
+	sv_tickstats.total += usec;
+
+	if (usec > sv_tickstats.max)
+	{
+		sv_tickstats.max = usec;
+	}
+}
+
+void
+SV_TickStats_f(void)
+{
+	int i, num;
+
+	num = sizeof(sv_ticklimits) / sizeof(sv_ticklimits[0]);
+
+	if ((Cmd_Argc() == 2) && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		memset(&sv_tickstats, 0, sizeof(sv_tickstats));
+		return;
+	}
+
+	if (!sv_tickstats.frames)
+	{
+		Com_Printf("No frames run yet.\n");
+		return;
+	}
+
+	Com_Printf("Lateness of %i frames, mean %i, max %i usec:\n",
+			sv_tickstats.frames, (int)(sv_tickstats.total / sv_tickstats.frames),
+			sv_tickstats.max);
+
+	for (i = 0; i <= num; i++)
+	{
+		if (!sv_tickstats.counts[i])
+		{
+			continue;
+		}
+
+		if (i < num)
+		{
+			Com_Printf("  < %5i usec: %7i (%5.1f%%)\n", sv_ticklimits[i],
+					sv_tickstats.counts[i],
+					100.0f * sv_tickstats.counts[i] / sv_tickstats.frames);
+		}
+		else
+		{
+			Com_Printf(" >= %5i usec: %7i (%5.1f%%)\n", sv_ticklimits[num - 1],
+					sv_tickstats.counts[i],
+					100.0f * sv_tickstats.counts[i] / sv_tickstats.frames);
+		}
+	}
+}
+
 void
 SV_Frame(int usec)
 {
+	long long profstart;
+
 #ifndef DEDICATED_ONLY
 	time_before_game = time_after_game = 0;
 #endif
 
-	/* if server is not active, do nothing */
-	if (!svs.initialized)
+	/* if server is not active, do nothing. console
+	   commands read with the packets (rcon) may try
+	   to run a nested frame, ignore that */
+	if (!svs.initialized || svs.inframe)
 	{
 		return;
 	}
 
-	svs.realtime += usec / 1000;
+	/* carry the fraction over, otherwise the server
+	   falls behind when it's called more than once
+	   per millisecond */
+	svs.realtime_usec += usec;
+	svs.realtime += svs.realtime_usec / 1000;
+	svs.realtime_usec %= 1000;
+
+	svs.inframe = true;
+	SV_BenchBegin(SVB_FRAME);
 
 	/* keep the random time dependent */
 	randk();
@@ -392,7 +498,11 @@ SV_Frame(int usec)
 	SV_CheckTimeouts();
 
 	/* get packets from clients */
+	SV_BenchBegin(SVB_READPACKETS);
+	profstart = Prof_Begin();
 	SV_ReadPackets();
+	Prof_End(PROF_SV_READPACKETS, profstart);
+	SV_BenchEnd(SVB_READPACKETS);
 
 	/* move autonomous things around if enough time has passed */
 	if (!sv_timedemo->value && (svs.realtime < sv.time))
@@ -408,10 +518,18 @@ SV_Frame(int usec)
 			svs.realtime = sv.time - 100;
 		}
 
-		NET_Sleep(sv.time - svs.realtime);
+		NET_Sleep((sv.time - svs.realtime) * 1000 - svs.realtime_usec);
+
+		SV_BenchAbort();
+		svs.inframe = false;
 		return;
 	}
 
+	if (!sv_timedemo->value)
+	{
+		SV_RecordTickLateness((svs.realtime - sv.time) * 1000 + svs.realtime_usec);
+	}
+
 	/* update ping based on the last known frame from all clients */
 	SV_CalcPings();
 
@@ -419,10 +537,18 @@ SV_Frame(int usec)
 	SV_GiveMsec();
 
 	/* let everything in the world think and move */
+	SV_BenchBegin(SVB_RUNGAMEFRAME);
 	SV_RunGameFrame();
+	SV_BenchEnd(SVB_RUNGAMEFRAME);
 
 	/* send messages back to the clients that had packets read this frame */
+	SV_BenchBegin(SVB_SENDMESSAGES);
+	profstart = Prof_Begin();
+	NET_BeginSendBatch();
 	SV_SendClientMessages();
+	NET_FlushSendBatch();
+	Prof_End(PROF_SV_SENDMESSAGES, profstart);
+	SV_BenchEnd(SVB_SENDMESSAGES);
 
 	/* save the entire world state if recording a serverdemo */
 	SV_RecordDemoMessage();
@@ -432,6 +558,9 @@ SV_Frame(int usec)
 
 	/* clear teleport flags, etc for next frame */
 	SV_PrepWorldFrame();
+
+	SV_BenchEnd(SVB_FRAME);
+	svs.inframe = false;
 }
 
 /*
@@ -595,6 +724,11 @@ SV_Init(void)
 	allow_download_sounds = Cvar_Get("allow_download_sounds", "1", CVAR_ARCHIVE);
 	allow_download_maps = Cvar_Get("allow_download_maps", "1", CVAR_ARCHIVE);
 	sv_downloadserver = Cvar_Get ("sv_downloadserver", "", 0);
+	sv_threads = Cvar_Get("sv_threads", "0", CVAR_ARCHIVE);
+	sv_threads_check = Cvar_Get("sv_threads_check", "0", 0);
+	sv_areatree = Cvar_Get("sv_areatree", "0", CVAR_ARCHIVE);
+	sv_tracecache = Cvar_Get("sv_tracecache", "0", CVAR_ARCHIVE);
+	sv_tracecache_hitrate = Cvar_Get("sv_tracecache_hitrate", "0", CVAR_NOSET);
 
 	sv_noreload = Cvar_Get("sv_noreload", "0", 0);
 
@@ -140,7 +140,7 @@ void
 SV_Multicast(vec3_t origin, multicast_t to)
 {
 	client_t *client;
-	byte *mask;
+	const byte *mask;
 	int leafnum = 0, cluster;
 	int j;
 	qboolean reliable;
@@ -428,21 +428,13 @@ SV_StartSound(vec3_t origin, edict_t *entity, int channel, int soundindex,
 	}
 }
 
-static qboolean
-SV_SendClientDatagram(client_t *client)
+/*
+ * Appends the multicast datagram to an already
+ * built frame and sends it to the client.
+ */
+static void
+SV_TransmitClientDatagram(client_t *client, sizebuf_t *msg)
 {
-	byte msg_buf[MAX_MSGLEN];
-	sizebuf_t msg;
-
-	SV_BuildClientFrame(client);
-
-	SZ_Init(&msg, msg_buf, sizeof(msg_buf));
-	msg.allowoverflow = true;
-
-	/* send over all the relevant entity_state_t
-	   and the player_state_t */
-	SV_WriteFrameToClient(client, &msg);
-
 	/* copy the accumulated multicast datagram
 	   for this client out to the message
 	   it is necessary for this to be after the WriteEntities
@@ -453,23 +445,41 @@ SV_SendClientDatagram(client_t *client)
 	}
 	else
 	{
-		SZ_Write(&msg, client->datagram.data, client->datagram.cursize);
+		SZ_Write(msg, client->datagram.data, client->datagram.cursize);
 	}
 
 	SZ_Clear(&client->datagram);
 
-	if (msg.overflowed)
+	if (msg->overflowed)
 	{
 		/* must have room left for the packet header */
 		Com_Printf("WARNING: msg overflowed for %s\n", client->name);
-		SZ_Clear(&msg);
+		SZ_Clear(msg);
 	}
 
 	/* send the datagram */
-	Netchan_Transmit(&client->netchan, msg.cursize, msg.data);
+	Netchan_Transmit(&client->netchan, msg->cursize, msg->data);
 
 	/* record the size for rate estimation */
-	client->message_size[sv.framenum % RATE_MESSAGES] = msg.cursize;
+	client->message_size[sv.framenum % RATE_MESSAGES] = msg->cursize;
+}
+
+static qboolean
+SV_SendClientDatagram(client_t *client)
+{
+	byte msg_buf[MAX_MSGLEN];
+	sizebuf_t msg;
+
+	SV_BuildClientFrame(client);
+
+	SZ_Init(&msg, msg_buf, sizeof(msg_buf));
+	msg.allowoverflow = true;
+
+	/* send over all the relevant entity_state_t
+	   and the player_state_t */
+	SV_WriteFrameToClient(client, &msg);
+
+	SV_TransmitClientDatagram(client, &msg);
 
 	return true;
 }
@@ -519,6 +529,281 @@ SV_RateDrop(client_t *c)
 	return false;
 }
 
+/*
+ * Threaded frame building. Visibility and delta compression of the
+ * spawned clients run on the worker pool in two passes, everything
+ * touching shared state (the ranges in the circular client_entities
+ * array, edicts, the reliable streams, the network) stays on the
+ * main thread and runs in client order. A client dropped for an
+ * overflowed reliable stream changes the edicts and the reliable
+ * streams of all clients, so the frames of the clients before it
+ * are built and sent first, like the serial path does. Prints and
+ * errors of the jobs are replayed on the main thread, also in
+ * client order. Only the frames are built off the main thread,
+ * sv_threads_check compares them with serially built ones at the
+ * cost of building every frame twice.
+ */
+typedef struct
+{
+	client_t *client;
+	qboolean built;
+	int count;
+	int surpressCount;
+	comdeferred_t deferred;
+	sizebuf_t msg;
+	byte msg_buf[MAX_MSGLEN];
+	short entities[MAX_EDICTS];
+} sv_clientjob_t;
+
+static sv_clientjob_t *sv_clientjobs;
+static int sv_numclientjobs;
+static sv_visscratch_t *sv_visscratch;
+
+static void
+SV_BuildClientFrameJob(void *data, int index, int thread)
+{
+	sv_clientjob_t *job = (sv_clientjob_t *)data + index;
+
+	job->built = false;
+
+	Com_BeginDeferred(&job->deferred);
+
+	if (setjmp(job->deferred.abort))
+	{
+		return;
+	}
+
+	job->built = SV_BuildClientFrameList(job->client, &sv_visscratch[thread],
+			job->entities, &job->count);
+
+	Com_EndDeferred();
+}
+
+static void
+SV_WriteClientFrameJob(void *data, int index, int thread)
+{
+	sv_clientjob_t *job = (sv_clientjob_t *)data + index;
+
+	SZ_Init(&job->msg, job->msg_buf, sizeof(job->msg_buf));
+	job->msg.allowoverflow = true;
+
+	Com_BeginDeferred(&job->deferred);
+
+	if (setjmp(job->deferred.abort))
+	{
+		return;
+	}
+
+	if (job->built)
+	{
+		SV_CopyClientFrameEntities(job->client, job->entities);
+	}
+
+	SV_WriteFrameToClient(job->client, &job->msg);
+
+	Com_EndDeferred();
+}
+
+/*
+ * Checks if the frames reserved this frame wrapped the circular
+ * client_entities array over a frame that is still read to delta
+ * compress against. The copies of one client would then race with
+ * the reads of another.
+ */
+static qboolean
+SV_ClientFramesOverlap(sv_clientjob_t *jobs, int numjobs, int first_entity)
+{
+	client_frame_t *oldframe;
+	int i;
+
+	if (svs.next_client_entities - first_entity > svs.num_client_entities)
+	{
+		return true;
+	}
+
+	for (i = 0; i < numjobs; i++)
+	{
+		oldframe = SV_DeltaFrame(jobs[i].client);
+
+		if (oldframe && (svs.next_client_entities - oldframe->first_entity >
+				svs.num_client_entities))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Rebuilds the frames serially and compares them to the threaded
+ * results. The serial frames are kept, so a mismatch is reported
+ * but never sent.
+ */
+static void
+SV_CheckClientFrames(sv_clientjob_t *jobs, int numjobs, int next_client_entities)
+{
+	byte msg_buf[MAX_MSGLEN];
+	sizebuf_t msg;
+	int i;
+
+	svs.next_client_entities = next_client_entities;
+
+	for (i = 0; i < numjobs; i++)
+	{
+		jobs[i].client->surpressCount = jobs[i].surpressCount;
+
+		SV_BuildClientFrame(jobs[i].client);
+
+		SZ_Init(&msg, msg_buf, sizeof(msg_buf));
+		msg.allowoverflow = true;
+		SV_WriteFrameToClient(jobs[i].client, &msg);
+
+		if ((msg.cursize != jobs[i].msg.cursize) ||
+			(msg.overflowed != jobs[i].msg.overflowed) ||
+			memcmp(msg.data, jobs[i].msg.data, msg.cursize))
+		{
+			Com_Printf("WARNING: threaded frame %i differs for %s\n",
+					sv.framenum, jobs[i].client->name);
+
+			memcpy(jobs[i].msg_buf, msg_buf, msg.cursize);
+			jobs[i].msg.cursize = msg.cursize;
+			jobs[i].msg.overflowed = msg.overflowed;
+		}
+	}
+}
+
+/*
+ * Builds the frames of a batch of spawned clients
+ * on the worker pool and sends them in client order.
+ */
+static void
+SV_SendClientFrames(sv_clientjob_t *jobs, int numjobs)
+{
+	int i, next_client_entities;
+
+	if (!numjobs)
+	{
+		return;
+	}
+
+	next_client_entities = svs.next_client_entities;
+
+	Sys_RunParallel(SV_BuildClientFrameJob, jobs, numjobs);
+
+	for (i = 0; i < numjobs; i++)
+	{
+		Com_FlushDeferred(&jobs[i].deferred);
+
+		if (jobs[i].built)
+		{
+			SV_FixEntityNumbers(jobs[i].entities, jobs[i].count);
+			SV_ReserveClientFrame(jobs[i].client, jobs[i].count);
+		}
+	}
+
+	if (SV_ClientFramesOverlap(jobs, numjobs, next_client_entities))
+	{
+		/* in client order, like the serial path */
+		for (i = 0; i < numjobs; i++)
+		{
+			SV_WriteClientFrameJob(jobs, i, 0);
+		}
+	}
+	else
+	{
+		Sys_RunParallel(SV_WriteClientFrameJob, jobs, numjobs);
+	}
+
+	for (i = 0; i < numjobs; i++)
+	{
+		Com_FlushDeferred(&jobs[i].deferred);
+	}
+
+	if (sv_threads_check->value)
+	{
+		SV_CheckClientFrames(jobs, numjobs, next_client_entities);
+	}
+
+	for (i = 0; i < numjobs; i++)
+	{
+		SV_TransmitClientDatagram(jobs[i].client, &jobs[i].msg);
+	}
+}
+
+static void
+SV_SendClientMessagesThreaded(void)
+{
+	int i, numjobs;
+	client_t *c;
+
+	if (sv_numclientjobs != maxclients->value)
+	{
+		if (sv_clientjobs)
+		{
+			Z_Free(sv_clientjobs);
+		}
+
+		sv_numclientjobs = maxclients->value;
+		sv_clientjobs = Z_Malloc(sizeof(sv_clientjob_t) * sv_numclientjobs);
+	}
+
+	if (!sv_visscratch)
+	{
+		sv_visscratch = Z_Malloc(sizeof(sv_visscratch_t) * (SYS_MAX_WORKERS + 1));
+	}
+
+	numjobs = 0;
+
+	for (i = 0, c = svs.clients; i < maxclients->value; i++, c++)
+	{
+		if (!c->state)
+		{
+			continue;
+		}
+
+		/* if the reliable message
+		   overflowed, drop the
+		   client */
+		if (c->netchan.message.overflowed)
+		{
+			/* the clients before see the
+			   world from before the drop */
+			SV_SendClientFrames(sv_clientjobs, numjobs);
+			numjobs = 0;
+
+			SZ_Clear(&c->netchan.message);
+			SZ_Clear(&c->datagram);
+			SV_BroadcastPrintf(PRINT_HIGH, "%s overflowed\n", c->name);
+			SV_DropClient(c);
+		}
+
+		if (c->state == cs_spawned)
+		{
+			/* don't overrun bandwidth */
+			if (SV_RateDrop(c))
+			{
+				continue;
+			}
+
+			sv_clientjobs[numjobs].client = c;
+			sv_clientjobs[numjobs].surpressCount = c->surpressCount;
+			numjobs++;
+		}
+		else
+		{
+			/* just update reliable	if needed */
+			if (c->netchan.message.cursize ||
+				(curtime - c->netchan.last_sent > 1000))
+			{
+				Netchan_Transmit(&c->netchan, 0, NULL);
+			}
+		}
+	}
+
+	SV_SendClientFrames(sv_clientjobs, numjobs);
+}
+
 void
 SV_SendClientMessages(void)
 {
@@ -572,6 +857,19 @@ SV_SendClientMessages(void)
 		}
 	}
 
+	if (sv_threads->modified)
+	{
+		sv_threads->modified = false;
+		Sys_StartWorkers(SYS_WORKERS_SERVER, sv_threads->value);
+	}
+
+	/* the workers may also have been started by the renderer */
+	if ((sv.state == ss_game) && (sv_threads->value > 0) && Sys_NumWorkers())
+	{
+		SV_SendClientMessagesThreaded();
+		return;
+	}
+
 	/* send a message to each connected client */
 	for (i = 0, c = svs.clients; i < maxclients->value; i++, c++)
 	{
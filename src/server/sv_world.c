@@ -26,13 +26,23 @@
 
 #include "header/server.h"
 
-#define AREA_DEPTH 4
-#define AREA_NODES 32
+#define AREA_DEPTH 4 /* vanilla */
+#define AREA_MAX_DEPTH 10
+#define AREA_NODES ((2 << AREA_MAX_DEPTH) - 1)
+#define AREA_MIN_SIZE 512 /* automatic depth stops here */
+#define AREA_LOOSE 32 /* overlap of the children */
 #define MAX_TOTAL_ENT_LEAFS 128
 
 #define STRUCT_FROM_LINK(l, t, m) ((t *)((byte *)l - (byte *)&(((t *)NULL)->m)))
 #define EDICT_FROM_AREA(l) STRUCT_FROM_LINK(l, edict_t, area)
 
+/*
+ * Entities are linked into the deepest node that fully
+ * contains their box. The children of a node overlap by
+ * AREA_LOOSE units around the split, so small entities
+ * straddling it still sink down instead of piling up in
+ * the upper nodes, which are checked by every query.
+ */
 typedef struct areanode_s
 {
 	int axis; /* -1 = leaf node */
@@ -44,12 +54,42 @@ typedef struct areanode_s
 
 areanode_t sv_areanodes[AREA_NODES];
 int sv_numareanodes;
+int sv_areadepth;
+
+/* for sv_areastats */
+static struct
+{
+	int queries;
+	int candidates; /* edicts tested */
+	int results; /* edicts returned */
+} area_stats;
 
 float *area_mins, *area_maxs;
 edict_t **area_list;
 int area_count, area_maxcount;
 int area_type;
 
+/*
+ * Traces are remembered until the next server frame or until
+ * an edict that traces can hit is linked or unlinked. Monster
+ * AI tends to repeat the same traces several times per frame.
+ */
+#define TRACE_CACHE_SIZE 1024 /* must be a power of 2 */
+
+typedef struct
+{
+	unsigned generation; /* valid if sv_tracegeneration */
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	edict_t *passedict;
+	int contentmask;
+	trace_t trace;
+} tracecache_t;
+
+static tracecache_t sv_tracecache_entries[TRACE_CACHE_SIZE];
+static unsigned sv_tracegeneration = 1;
+static int sv_tracelookups, sv_tracehits;
+
 static int SV_HullForEntity(edict_t *ent);
 
 /* ClearLink is used for new headnodes */
@@ -79,7 +119,7 @@ InsertLinkBefore(link_t *l, link_t *before)
  * Builds a uniformly subdivided tree for the given world size
  */
 static areanode_t *
-SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
+SV_CreateAreaNode(int depth, int maxdepth, vec3_t mins, vec3_t maxs)
 {
 	areanode_t *anode;
 	vec3_t size;
@@ -91,15 +131,25 @@ SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
 	ClearLink(&anode->trigger_edicts);
 	ClearLink(&anode->solid_edicts);
 
-	if (depth == AREA_DEPTH)
+	VectorSubtract(maxs, mins, size);
+
+	/* with an automatic depth split until the
+	   nodes get smaller than AREA_MIN_SIZE */
+	if ((depth == maxdepth) ||
+		(!sv_areatree->value && (size[0] < AREA_MIN_SIZE) &&
+		 (size[1] < AREA_MIN_SIZE)))
 	{
 		anode->axis = -1;
 		anode->children[0] = anode->children[1] = NULL;
+
+		if (depth > sv_areadepth)
+		{
+			sv_areadepth = depth;
+		}
+
 		return anode;
 	}
 
-	VectorSubtract(maxs, mins, size);
-
 	if (size[0] > size[1])
 	{
 		anode->axis = 0;
@@ -117,21 +167,158 @@ SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
 
 	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
 
-	anode->children[0] = SV_CreateAreaNode(depth + 1, mins2, maxs2);
-	anode->children[1] = SV_CreateAreaNode(depth + 1, mins1, maxs1);
+	anode->children[0] = SV_CreateAreaNode(depth + 1, maxdepth, mins2, maxs2);
+	anode->children[1] = SV_CreateAreaNode(depth + 1, maxdepth, mins1, maxs1);
 
 	return anode;
 }
 
+static void
+SV_InvalidateTraces(void)
+{
+	sv_tracegeneration++;
+
+	/* skip 0, never used entries have it */
+	if (!sv_tracegeneration)
+	{
+		sv_tracegeneration++;
+	}
+}
+
+/*
+ * Called at the start of every server frame.
+ */
+void
+SV_TraceCacheFrame(void)
+{
+	SV_InvalidateTraces();
+
+	if (!(sv.framenum % 10))
+	{
+		Cvar_ForceSet("sv_tracecache_hitrate", va("%i", sv_tracelookups ?
+				(int)(100.0f * sv_tracehits / sv_tracelookups) : 0));
+
+		sv_tracelookups = sv_tracehits = 0;
+	}
+}
+
+static tracecache_t *
+SV_TraceCacheSlot(const vec3_t start, const vec3_t mins, const vec3_t maxs,
+		const vec3_t end, const edict_t *passedict, int contentmask)
+{
+	const float *keys[4] = {start, end, mins, maxs};
+	unsigned hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < 4; i++)
+	{
+		const byte *b = (const byte *)keys[i];
+		int j;
+
+		for (j = 0; j < sizeof(vec3_t); j++)
+		{
+			hash ^= b[j];
+			hash *= 16777619u;
+		}
+	}
+
+	hash ^= (unsigned)((size_t)passedict >> 4);
+	hash *= 16777619u;
+	hash ^= (unsigned)contentmask;
+	hash *= 16777619u;
+
+	return &sv_tracecache_entries[hash & (TRACE_CACHE_SIZE - 1)];
+}
+
+static qboolean
+SV_TraceCacheMatch(const tracecache_t *entry, const vec3_t start,
+		const vec3_t mins, const vec3_t maxs, const vec3_t end,
+		const edict_t *passedict, int contentmask)
+{
+	return (entry->generation == sv_tracegeneration) &&
+		(entry->passedict == passedict) &&
+		(entry->contentmask == contentmask) &&
+		VectorCompare(entry->start, start) && VectorCompare(entry->end, end) &&
+		VectorCompare(entry->mins, mins) && VectorCompare(entry->maxs, maxs);
+}
+
 void
 SV_ClearWorld(void)
 {
+	int maxdepth;
+
+	/* 0 picks the depth from the world size */
+	maxdepth = sv_areatree->value ? (int)sv_areatree->value : AREA_MAX_DEPTH;
+	maxdepth = (maxdepth < 1) ? 1 : ((maxdepth > AREA_MAX_DEPTH) ? AREA_MAX_DEPTH : maxdepth);
+
 	memset(sv_areanodes, 0, sizeof(sv_areanodes));
+	memset(&area_stats, 0, sizeof(area_stats));
+	SV_InvalidateTraces();
 	sv_numareanodes = 0;
+	sv_areadepth = 0;
+
 	if (sv.models[1])
 	{
-		SV_CreateAreaNode(0, sv.models[1]->mins, sv.models[1]->maxs);
+		SV_CreateAreaNode(0, maxdepth, sv.models[1]->mins, sv.models[1]->maxs);
+	}
+}
+
+/*
+ * Prints how many edicts are checked per
+ * SV_AreaEdicts() call and resets the counters.
+ */
+void
+SV_AreaStats_f(void)
+{
+	int i, solid, trigger, top;
+	link_t *l;
+
+	if (!sv_numareanodes)
+	{
+		Com_Printf("No map loaded.\n");
+		return;
+	}
+
+	solid = trigger = top = 0;
+
+	for (i = 0; i < sv_numareanodes; i++)
+	{
+		int count = 0;
+
+		for (l = sv_areanodes[i].solid_edicts.next;
+			 l != &sv_areanodes[i].solid_edicts; l = l->next)
+		{
+			count++;
+		}
+
+		solid += count;
+
+		for (l = sv_areanodes[i].trigger_edicts.next;
+			 l != &sv_areanodes[i].trigger_edicts; l = l->next)
+		{
+			count++;
+			trigger++;
+		}
+
+		if (count > top)
+		{
+			top = count;
+		}
+	}
+
+	Com_Printf("%i area nodes, depth %i, %i solid and %i trigger edicts linked, "
+			"at most %i in one node\n", sv_numareanodes, sv_areadepth, solid,
+			trigger, top);
+
+	if (area_stats.queries)
+	{
+		Com_Printf("%i queries, %.1f candidates and %.1f results per query\n",
+				area_stats.queries,
+				(float)area_stats.candidates / area_stats.queries,
+				(float)area_stats.results / area_stats.queries);
 	}
+
+	memset(&area_stats, 0, sizeof(area_stats));
 }
 
 void
@@ -142,6 +329,8 @@ SV_UnlinkEdict(edict_t *ent)
 		return; /* not linked in anywhere */
 	}
 
+	SV_InvalidateTraces();
+
 	RemoveLink(&ent->area);
 	ent->area.prev = ent->area.next = NULL;
 }
@@ -368,6 +557,12 @@ SV_LinkEdict(edict_t *ent)
 		return;
 	}
 
+	/* triggers can't be hit by traces */
+	if (ent->solid != SOLID_TRIGGER)
+	{
+		SV_InvalidateTraces();
+	}
+
 	/* find the first node that the ent's box crosses */
 	node = sv_areanodes;
 
@@ -378,11 +573,11 @@ SV_LinkEdict(edict_t *ent)
 			break;
 		}
 
-		if (ent->absmin[node->axis] > node->dist)
+		if (ent->absmin[node->axis] > node->dist - AREA_LOOSE)
 		{
 			node = node->children[0];
 		}
-		else if (ent->absmax[node->axis] < node->dist)
+		else if (ent->absmax[node->axis] < node->dist + AREA_LOOSE)
 		{
 			node = node->children[1];
 		}
@@ -423,6 +618,7 @@ SV_AreaEdicts_r(areanode_t *node)
 	{
 		next = l->next;
 		check = (EDICT_FROM_AREA(l));
+		area_stats.candidates++;
 
 		if (check->solid == SOLID_NOT)
 		{
@@ -455,12 +651,12 @@ SV_AreaEdicts_r(areanode_t *node)
 	}
 
 	/* recurse down both sides */
-	if (area_maxs[node->axis] > node->dist)
+	if (area_maxs[node->axis] > node->dist - AREA_LOOSE)
 	{
 		SV_AreaEdicts_r(node->children[0]);
 	}
 
-	if (area_mins[node->axis] < node->dist)
+	if (area_mins[node->axis] < node->dist + AREA_LOOSE)
 	{
 		SV_AreaEdicts_r(node->children[1]);
 	}
@@ -479,6 +675,9 @@ SV_AreaEdicts(vec3_t mins, vec3_t maxs, edict_t **list,
 
 	SV_AreaEdicts_r(sv_areanodes);
 
+	area_stats.queries++;
+	area_stats.results += area_count;
+
 	area_mins = 0;
 	area_maxs = 0;
 	area_list = 0;
@@ -557,18 +756,19 @@ SV_HullForEntity(edict_t *ent)
 	return CM_HeadnodeForBox(ent->mins, ent->maxs);
 }
 
+/*
+ * The touchlist may hold edicts outside of the
+ * move's bounding box, they're skipped.
+ */
 static void
-SV_ClipMoveToEntities(moveclip_t *clip)
+SV_ClipMoveToEntities(moveclip_t *clip, edict_t **touchlist, int num)
 {
-	int i, num;
-	edict_t *touchlist[MAX_EDICTS], *touch;
+	int i;
+	edict_t *touch;
 	trace_t trace;
 	int headnode;
 	float *angles;
 
-	num = SV_AreaEdicts(clip->boxmins, clip->boxmaxs, touchlist,
-			MAX_EDICTS, AREA_SOLID);
-
 	/* be careful, it is possible to have an entity in this
 	   list removed before we get to it (killtriggered) */
 	for (i = 0; i < num; i++)
@@ -580,6 +780,16 @@ SV_ClipMoveToEntities(moveclip_t *clip)
 			continue;
 		}
 
+		if ((touch->absmin[0] > clip->boxmaxs[0]) ||
+			(touch->absmin[1] > clip->boxmaxs[1]) ||
+			(touch->absmin[2] > clip->boxmaxs[2]) ||
+			(touch->absmax[0] < clip->boxmins[0]) ||
+			(touch->absmax[1] < clip->boxmins[1]) ||
+			(touch->absmax[2] < clip->boxmins[2]))
+		{
+			continue;
+		}
+
 		if (touch == clip->passedict)
 		{
 			continue;
@@ -670,6 +880,43 @@ SV_TraceBounds(vec3_t start, vec3_t mins, vec3_t maxs,
 	}
 }
 
+/*
+ * Clips the move against the world. Returns false if the world
+ * blocks it right away, otherwise the rest of clip is set up
+ * for SV_ClipMoveToEntities().
+ */
+static qboolean
+SV_ClipMoveToWorld(moveclip_t *clip, vec3_t start, vec3_t mins, vec3_t maxs,
+		vec3_t end, edict_t *passedict, int contentmask)
+{
+	memset(clip, 0, sizeof(moveclip_t));
+
+	/* clip to world */
+	clip->trace = CM_BoxTrace(start, end, mins, maxs, 0, contentmask);
+	clip->trace.ent = ge->edicts;
+
+	if (clip->trace.fraction == 0)
+	{
+		return false; /* blocked by the world */
+	}
+
+	clip->contentmask = contentmask;
+	clip->start = start;
+	clip->end = end;
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->passedict = passedict;
+
+	VectorCopy(mins, clip->mins2);
+	VectorCopy(maxs, clip->maxs2);
+
+	/* create the bounding box of the entire move */
+	SV_TraceBounds(start, clip->mins2, clip->maxs2,
+			end, clip->boxmins, clip->boxmaxs);
+
+	return true;
+}
+
 /*
  * Moves the given mins/maxs volume through the world from start to end.
  * Passedict and edicts owned by passedict are explicitly not checked.
@@ -678,7 +925,10 @@ trace_t
 SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
 		edict_t *passedict, int contentmask)
 {
+	edict_t *touchlist[MAX_EDICTS];
+	tracecache_t *entry = NULL;
 	moveclip_t clip;
+	int num;
 
 	if (!mins)
 	{
@@ -690,34 +940,128 @@ SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end,
 		maxs = vec3_origin;
 	}
 
-	memset(&clip, 0, sizeof(moveclip_t));
+	if (sv_tracecache->value)
+	{
+		sv_tracelookups++;
+		entry = SV_TraceCacheSlot(start, mins, maxs, end, passedict, contentmask);
 
-	/* clip to world */
-	clip.trace = CM_BoxTrace(start, end, mins, maxs, 0, contentmask);
-	clip.trace.ent = ge->edicts;
+		if (SV_TraceCacheMatch(entry, start, mins, maxs, end, passedict, contentmask))
+		{
+			sv_tracehits++;
+			return entry->trace;
+		}
+	}
 
-	if (clip.trace.fraction == 0)
+	if (SV_ClipMoveToWorld(&clip, start, mins, maxs, end, passedict, contentmask))
 	{
-		return clip.trace; /* blocked by the world */
+		/* clip to other solid entities */
+		num = SV_AreaEdicts(clip.boxmins, clip.boxmaxs, touchlist,
+				MAX_EDICTS, AREA_SOLID);
+		SV_ClipMoveToEntities(&clip, touchlist, num);
 	}
 
-	clip.contentmask = contentmask;
-	clip.start = start;
-	clip.end = end;
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.passedict = passedict;
+	if (entry)
+	{
+		entry->generation = sv_tracegeneration;
+		VectorCopy(start, entry->start);
+		VectorCopy(end, entry->end);
+		VectorCopy(mins, entry->mins);
+		VectorCopy(maxs, entry->maxs);
+		entry->passedict = passedict;
+		entry->contentmask = contentmask;
+		entry->trace = clip.trace;
+	}
 
-	VectorCopy(mins, clip.mins2);
-	VectorCopy(maxs, clip.maxs2);
+	return clip.trace;
+}
 
-	/* create the bounding box of the entire move */
-	SV_TraceBounds(start, clip.mins2, clip.maxs2,
-			end, clip.boxmins, clip.boxmaxs);
+/*
+ * Traces a batch of moves. The edicts are collected once for
+ * the bounding box of all moves, larger batches are split.
+ * Results are identical to calling SV_Trace() for each move.
+ */
+#define TRACE_BATCH_SIZE 64
 
-	/* clip to other solid entities */
-	SV_ClipMoveToEntities(&clip);
+static moveclip_t sv_batchclips[TRACE_BATCH_SIZE];
+static qboolean sv_batchclipping[TRACE_BATCH_SIZE];
 
-	return clip.trace;
+static void
+SV_TraceBatch(const tracerequest_t *requests, trace_t *results, int count)
+{
+	edict_t *touchlist[MAX_EDICTS];
+	vec3_t boxmins, boxmaxs;
+	int i, num;
+	qboolean any;
+
+	any = false;
+
+	ClearBounds(boxmins, boxmaxs);
+
+	for (i = 0; i < count; i++)
+	{
+		const tracerequest_t *r = &requests[i];
+
+		sv_batchclipping[i] = SV_ClipMoveToWorld(&sv_batchclips[i], r->start,
+				r->mins ? r->mins : vec3_origin, r->maxs ? r->maxs : vec3_origin,
+				r->end, r->passent, r->contentmask);
+
+		if (sv_batchclipping[i])
+		{
+			AddPointToBounds(sv_batchclips[i].boxmins, boxmins, boxmaxs);
+			AddPointToBounds(sv_batchclips[i].boxmaxs, boxmins, boxmaxs);
+			any = true;
+		}
+	}
+
+	num = 0;
+
+	if (any)
+	{
+		num = SV_AreaEdicts(boxmins, boxmaxs, touchlist, MAX_EDICTS, AREA_SOLID);
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (sv_batchclipping[i])
+		{
+			SV_ClipMoveToEntities(&sv_batchclips[i], touchlist, num);
+		}
+
+		results[i] = sv_batchclips[i].trace;
+	}
 }
 
+void
+SV_Traces(const tracerequest_t *requests, trace_t *results, int count)
+{
+	int i;
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	/* small batches don't pay off */
+	if (count < 4)
+	{
+		for (i = 0; i < count; i++)
+		{
+			results[i] = SV_Trace(requests[i].start, requests[i].mins,
+					requests[i].maxs, requests[i].end, requests[i].passent,
+					requests[i].contentmask);
+		}
+
+		return;
+	}
+
+	while (count > TRACE_BATCH_SIZE)
+	{
+		SV_TraceBatch(requests, results, TRACE_BATCH_SIZE);
+
+		requests += TRACE_BATCH_SIZE;
+		results += TRACE_BATCH_SIZE;
+		count -= TRACE_BATCH_SIZE;
+	}
+
+	SV_TraceBatch(requests, results, count);
+}